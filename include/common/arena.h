@@ -0,0 +1,123 @@
+/******************************************************************************
+ * Copyright (C) 2024 by Hatem Alamir
+ *
+ * Redistribution, modification or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are 
+ * permitted to modify this and use it to learn about the field of embedded
+ * software. Hatem Alamir is not liable for any misuse of this material.
+ *
+ *****************************************************************************/
+/**
+ * @file arena.h
+ * @brief Bump allocator for short-lived scratch memory
+ *
+ * An arena hands out consecutive chunks of one block by moving an offset
+ * forward. Nothing is freed individually: a batch of work takes a mark before
+ * it starts and rewinds to it when it is done, or resets the whole arena. All
+ * operations are O(1).
+ *
+ * @author Hatem Alamir
+ * @date December 16 2024
+ *
+ */
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+/** Alignment used when the caller passes 0 */
+#define ARENA_DEFAULT_ALIGN (sizeof(void*))
+
+typedef struct arena {
+    uint8_t* base;
+    size_t size;
+    size_t offset;
+    int owned;      /* block came from reserve_bytes() in arena_create() */
+} arena_t;
+
+/** Saved position of an arena, see arena_mark() */
+typedef size_t arena_mark_t;
+
+/**
+ * @brief Sets up an arena over a caller-provided block
+ *
+ * @param arena arena to initialize
+ * @param block memory to hand out, e.g. a static or stack buffer
+ * @param size size of the block in bytes
+ *
+ * @return This function does not return any value.
+ */
+void arena_init(arena_t* arena, void* block, size_t size);
+
+/**
+ * @brief Sets up an arena over a block from reserve_bytes()
+ *
+ * @param arena arena to initialize
+ * @param size size of the block in bytes
+ *
+ * @return 0 on success, -1 if the block could not be reserved
+ */
+int arena_create(arena_t* arena, size_t size);
+
+/**
+ * @brief Releases the block of an arena made by arena_create()
+ *
+ * Arenas set up with arena_init() are only emptied; their block belongs to
+ * the caller.
+ *
+ * @param arena arena to release
+ *
+ * @return This function does not return any value.
+ */
+void arena_destroy(arena_t* arena);
+
+/**
+ * @brief Allocates an aligned chunk from an arena
+ *
+ * @param arena arena to allocate from
+ * @param bytes size of the chunk
+ * @param align power of two alignment, or 0 for ARENA_DEFAULT_ALIGN
+ *
+ * @return pointer to the chunk, or NULL if the arena does not have room
+ */
+void* arena_alloc(arena_t* arena, size_t bytes, size_t align);
+
+/**
+ * @brief Returns the current position of an arena
+ *
+ * @param arena arena to query
+ *
+ * @return mark to pass to arena_rewind()
+ */
+arena_mark_t arena_mark(const arena_t* arena);
+
+/**
+ * @brief Releases every chunk allocated since a mark was taken
+ *
+ * @param arena arena to rewind
+ * @param mark value returned by arena_mark() on the same arena
+ *
+ * @return This function does not return any value.
+ */
+void arena_rewind(arena_t* arena, arena_mark_t mark);
+
+/**
+ * @brief Releases every chunk of an arena
+ *
+ * @param arena arena to reset
+ *
+ * @return This function does not return any value.
+ */
+void arena_reset(arena_t* arena);
+
+/**
+ * @brief Returns how many bytes are left, before alignment padding
+ *
+ * @param arena arena to query
+ *
+ * @return free bytes at the end of the arena
+ */
+size_t arena_remaining(const arena_t* arena);
+
+#endif /* __ARENA_H__ */
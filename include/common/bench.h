@@ -0,0 +1,258 @@
+/******************************************************************************
+ * Copyright (C) 2024 by Hatem Alamir
+ *
+ * Redistribution, modification or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are 
+ * permitted to modify this and use it to learn about the field of embedded
+ * software. Hatem Alamir is not liable for any misuse of this material.
+ *
+ *****************************************************************************/
+/**
+ * @file bench.h
+ * @brief Throughput benchmarks for the HOST build
+ *
+ * This header declares the benchmark driver and the individual benchmarks. They
+ * are only built with `make all BENCH=1` and print their results as plain
+ * tables through PRINTF.
+ *
+ * @author Hatem Alamir
+ * @date December 8 2024
+ *
+ */
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+/**
+ * @brief function to run all benchmarks
+ *
+ * This function calls every benchmark in this module one after the other.
+ *
+ * @return void
+ */
+void bench(void);
+
+/**
+ * @brief Benchmark of my_memmove against the C library memmove
+ *
+ * This function sweeps the move length from 16 bytes to 64 MiB and prints the
+ * throughput in GB/s of my_memmove and libc memmove, for disjoint buffers and
+ * for an overlapping move in each direction.
+ *
+ * @return void
+ */
+void bench_memmove(void);
+
+/**
+ * @brief Benchmark of each instruction set tier of the memory primitives
+ *
+ * This function pins every tier the CPU supports in turn and prints the GB/s
+ * of my_memcopy, my_memmove, my_memset and my_reverse at an L1, an L2 and a
+ * DRAM sized buffer.
+ *
+ * @return void
+ */
+void bench_memory_isa(void);
+
+/**
+ * @brief Benchmark of my_reverse against the byte-pair loop it replaced
+ *
+ * This function reverses buffers of every power of two from 2 bytes to 16 MiB
+ * in place and prints the throughput of the old byte loop and of my_reverse on
+ * each instruction set tier the CPU supports.
+ *
+ * @return void
+ */
+void bench_reverse(void);
+
+/**
+ * @brief Benchmark of batched small copies against one call per copy
+ *
+ * This function makes 1M copies of 8 to 64 bytes from random sources, from a
+ * 256 KiB and from a 64 MiB source buffer, packed into frames of 4096 copies.
+ * It prints the time per copy of calling my_memcopy or memcpy for each one and
+ * of passing each frame to my_memcopy_v, on each instruction set tier.
+ *
+ * @return void
+ */
+void bench_memcopy_v(void);
+
+/**
+ * @brief Benchmark of the search and compare functions against the C library
+ *
+ * This function times my_memchr, my_memrchr, my_memcmp and my_memmem against
+ * memchr, memrchr, memcmp and memmem on buffers from 16 bytes to 1 MiB, with
+ * the match (or the first difference) 1/16 of the way in and at the far end.
+ *
+ * @return void
+ */
+void bench_search(void);
+
+/**
+ * @brief Benchmark of channel splitting and merging against get/set_value
+ *
+ * This function splits 64 KiB and 64 MiB of interleaved data into 2, 3, 4
+ * and 8 channels with get_strided and merges them back with set_strided on
+ * each instruction set tier, and gathers and scatters through random indexes,
+ * against the same work done with one get_value or set_value call per byte.
+ *
+ * @return void
+ */
+void bench_strided(void);
+
+/**
+ * @brief Benchmark of my_transpose_u8 against the element by element loop
+ *
+ * This function transposes square byte matrices from 256 to 8192 rows, i.e.
+ * from 64 KiB to 64 MiB, well past the L2 size of common CPUs, and prints the
+ * throughput of the naive loop and of my_transpose_u8 on each instruction set
+ * tier the CPU supports.
+ *
+ * @return void
+ */
+void bench_transpose(void);
+
+/**
+ * @brief Benchmark of the non-temporal fill on a following stats pass
+ *
+ * This function fills a buffer larger than the last level cache with regular
+ * and then with non-temporal stores, and each time measures a find_mean pass
+ * over a working set that was hot before the fill. Cache misses come from
+ * perf_event_open and are reported as n/a where it is not permitted.
+ *
+ * @return void
+ */
+void bench_memset_stream(void);
+
+/**
+ * @brief Benchmark of the 32-bit pattern fill
+ *
+ * This function fills 4 KiB, 256 KiB and 16 MiB with my_memset32 on each
+ * instruction set tier, against a plain element loop. The 16 MiB fill is past
+ * the default stream threshold and uses non-temporal stores.
+ *
+ * @return void
+ */
+void bench_memset_pattern(void);
+
+/**
+ * @brief Benchmark of the checksum module
+ *
+ * This function runs each checksum over 4 KiB, 256 KiB and 16 MiB buffers,
+ * against a byte-at-a-time CRC32 table loop, and CRC32C also pinned to its
+ * table code. The fused copy and CRC32C is compared with my_memcopy followed
+ * by checksum_crc32c.
+ *
+ * @return void
+ */
+void bench_checksum(void);
+
+/**
+ * @brief Benchmark of the delta and run-length codec
+ *
+ * This function encodes 16 MiB of the ramp the course1 tests use, a sensor
+ * trace that holds each reading for several samples, a steady level with rare
+ * spikes and noise. For each it prints the compression ratio, the encode
+ * speed, the decode speed on the scalar and the best tier, the in-place
+ * decode speed, and whether the data came back intact.
+ *
+ * @return void
+ */
+void bench_compress(void);
+
+/**
+ * @brief Benchmark of the sorts against the old bubble sort and qsort
+ *
+ * This function sorts random bytes with the bubble sort sort_array used to
+ * be (up to 32768 elements), with qsort and with sort_array, and random
+ * 16-bit and 32-bit keys with the radix sorts, from 8 to 100M elements in
+ * steps of 8, and prints the time per element.
+ *
+ * @return void
+ */
+void bench_sort(void);
+
+/**
+ * @brief Benchmark of the histogram statistics against sorting a copy
+ *
+ * This function takes the median, mean, maximum and minimum of steady and
+ * noisy samples from 4 KiB to 16 MiB, by sorting a copy and reading
+ * positions, by counting into one histogram, and with stats_histogram_build's
+ * partial histograms, and prints the time per sample.
+ *
+ * @return void
+ */
+void bench_stats(void);
+
+/**
+ * @brief Benchmark of stats_summary against three separate passes
+ *
+ * This function takes the minimum, maximum and sum of random bytes from
+ * 16 KiB to 32 MiB with a loop per statistic, the way find_minimum,
+ * find_maximum and find_mean used to, and with stats_summary on every
+ * instruction set tier, and prints the throughput.
+ *
+ * @return void
+ */
+void bench_summary(void);
+
+/**
+ * @brief Benchmark of find_median_select against sorting first
+ *
+ * This function takes the median of random, ascending, descending and organ
+ * pipe 32-bit keys, the last an adversary for the median of three pivot, from
+ * 1000 to 16M keys, by sorting a copy with qsort or sort_array_u32 and
+ * reading the middle, and with find_median_select on a copy, and prints the
+ * time per key.
+ *
+ * @return void
+ */
+void bench_select(void);
+
+/**
+ * @brief Benchmark of a huge page backed buffer against a regular one
+ *
+ * This function reserves 512 MiB with reserve_words and then with
+ * reserve_words_aligned, and for each times the first-touch fill, a find_mean
+ * pass and random byte reads. It prints the dTLB read misses of the reads,
+ * n/a where perf_event_open is not permitted, and how much of the buffer the
+ * kernel put on huge pages according to /proc/self/smaps.
+ *
+ * @return void
+ */
+void bench_huge_pages(void);
+
+/**
+ * @brief Benchmark of reserve_words/free_words against malloc/free
+ *
+ * This function reserves batches of randomly sized blocks and frees them in a
+ * shuffled order, and prints the average cost of a reserve/free pair for a
+ * range of maximum request sizes within the pool size classes.
+ *
+ * @return void
+ */
+void bench_reserve_words(void);
+
+/**
+ * @brief Multi-threaded reserve/free churn
+ *
+ * This function runs the same random churn on 1, 2, 4, ... threads up to the
+ * number of online CPUs (at least 4), and prints the combined operations per
+ * second of reserve_words with and without the pool's thread caches and of
+ * malloc. Every block is stamped and checked, and bad stamps are reported.
+ *
+ * @return void
+ */
+void bench_reserve_threads(void);
+
+/**
+ * @brief Randomized alloc/free churn on the TLSF heap against malloc
+ *
+ * This function times every single allocation and release of a random churn
+ * and prints the average and worst-case latency of each allocator, then the
+ * TLSF fragmentation with every other block of a full heap freed.
+ *
+ * @return void
+ */
+void bench_tlsf_churn(void);
+
+#endif /* __BENCH_H__ */
@@ -0,0 +1,132 @@
+/******************************************************************************
+ * Copyright (C) 2024 by Hatem Alamir
+ *
+ * Redistribution, modification or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of embedded
+ * software. Hatem Alamir is not liable for any misuse of this material.
+ *
+ *****************************************************************************/
+/**
+ * @file checksum.h
+ * @brief Checksums over memory buffers
+ *
+ * CRC32 (IEEE 802.3, as in zlib and Ethernet), CRC32C (Castagnoli, as in
+ * iSCSI and ext4) and Fletcher-64. Every function takes the value returned for
+ * the preceding data, 0 to start, so a buffer can be checked in pieces. The
+ * combine functions merge the values of two adjacent chunks computed
+ * separately, e.g. by different threads, without touching the data again.
+ *
+ * The CRCs use slicing-by-8 tables, built on first use. On x86 HOST builds
+ * CRC32C uses the SSE4.2 crc32 instruction on three interleaved streams,
+ * merged with a carry-less multiply, unless the memory module is pinned to
+ * the scalar tier (see memory_select_isa()).
+ *
+ * @author Hatem Alamir
+ * @date December 20 2024
+ *
+ */
+#ifndef __CHECKSUM_H__
+#define __CHECKSUM_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Number of CRC tables, 8 for slicing-by-8 or 1 for a byte at a time. Each
+ * CRC needs 1 KiB of RAM per table, so MSP432 builds default to one.
+ */
+#ifndef CHECKSUM_SLICES
+#if defined (MSP432)
+#define CHECKSUM_SLICES (1)
+#else
+#define CHECKSUM_SLICES (8)
+#endif
+#endif
+
+/**
+ * @brief Computes the CRC32 of a buffer
+ *
+ * @param src pointer to the data
+ * @param length number of bytes
+ * @param crc CRC32 of the data before src, or 0
+ *
+ * @return CRC32 of the data up to src + length
+ */
+uint32_t checksum_crc32(const uint8_t* src, size_t length, uint32_t crc);
+
+/**
+ * @brief Computes the CRC32C of a buffer
+ *
+ * @param src pointer to the data
+ * @param length number of bytes
+ * @param crc CRC32C of the data before src, or 0
+ *
+ * @return CRC32C of the data up to src + length
+ */
+uint32_t checksum_crc32c(const uint8_t* src, size_t length, uint32_t crc);
+
+/**
+ * @brief Copies a buffer and computes its CRC32C in the same pass
+ *
+ * Same as my_memcopy() followed by checksum_crc32c() on the destination, but
+ * every byte is loaded once. The buffers must not overlap.
+ *
+ * @param src pointer to source data
+ * @param dst pointer to destination
+ * @param length number of bytes to copy
+ * @param crc CRC32C of the data before src, or 0
+ *
+ * @return CRC32C of the data up to src + length
+ */
+uint32_t checksum_copy_crc32c(const uint8_t* src, uint8_t* dst, size_t length,
+                              uint32_t crc);
+
+/**
+ * @brief Computes the Fletcher-64 checksum of a buffer
+ *
+ * The data is summed as little-endian 32-bit words modulo 2^32 - 1, the last
+ * word padded with zero bytes. The first sum is in the low half of the
+ * result, the second in the high half. Only a piece whose length is a
+ * multiple of 4 can be continued or combined with what follows it.
+ *
+ * @param src pointer to the data
+ * @param length number of bytes
+ * @param sum checksum of the data before src, or 0
+ *
+ * @return checksum of the data up to src + length
+ */
+uint64_t checksum_fletcher64(const uint8_t* src, size_t length, uint64_t sum);
+
+/**
+ * @brief Merges the CRC32s of two adjacent chunks
+ *
+ * Costs O(log length2) and does not read the data.
+ *
+ * @param crc1 CRC32 of the first chunk
+ * @param crc2 CRC32 of the second chunk, started from 0
+ * @param length2 length of the second chunk in bytes
+ *
+ * @return CRC32 of the two chunks back to back
+ */
+uint32_t checksum_crc32_combine(uint32_t crc1, uint32_t crc2, size_t length2);
+
+/**
+ * @brief Merges the CRC32Cs of two adjacent chunks, see
+ * checksum_crc32_combine()
+ */
+uint32_t checksum_crc32c_combine(uint32_t crc1, uint32_t crc2, size_t length2);
+
+/**
+ * @brief Merges the Fletcher-64 checksums of two adjacent chunks
+ *
+ * @param sum1 checksum of the first chunk, whose length is a multiple of 4
+ * @param sum2 checksum of the second chunk, started from 0
+ * @param length2 length of the second chunk in bytes
+ *
+ * @return checksum of the two chunks back to back
+ */
+uint64_t checksum_fletcher64_combine(uint64_t sum1, uint64_t sum2,
+                                     size_t length2);
+
+#endif /* __CHECKSUM_H__ */
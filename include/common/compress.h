@@ -0,0 +1,161 @@
+/******************************************************************************
+ * Copyright (C) 2024 by Hatem Alamir
+ *
+ * Redistribution, modification or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of embedded
+ * software. Hatem Alamir is not liable for any misuse of this material.
+ *
+ *****************************************************************************/
+/**
+ * @file compress.h
+ * @brief Delta and run-length codec for byte sample buffers
+ *
+ * Each sample is replaced by its difference from the one before (the first
+ * from 0), and the differences are run-length coded. A steady or slowly
+ * ramping signal becomes a few runs, noise stays close to its own size. The
+ * encoded data is a sequence of tokens:
+ *
+ *   0x00..0x7F  literal, the next header + 1 bytes are differences
+ *   0x80..0xFE  run of header - 0x80 + 3 equal differences, given by the
+ *               next byte
+ *   0xFF        run of 130 + n equal differences, n in the LEB128 varint
+ *               that follows, then the difference
+ *
+ * The data carries no header or length of its own. It never grows by more
+ * than one byte in 128, plus one token.
+ *
+ * @author Hatem Alamir
+ * @date December 22 2024
+ *
+ */
+#ifndef __COMPRESS_H__
+#define __COMPRESS_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Most bytes one step of the streaming encoder writes. memory_compress_update()
+ * stops while less room than this is left, and memory_compress_finish() needs
+ * this much.
+ */
+#define MEMORY_COMPRESS_TOKEN_MAX (144)
+
+/**
+ * Worst-case encoded size of length bytes, for sizing the output of
+ * memory_compress()
+ */
+#define MEMORY_COMPRESS_BOUND(length) \
+    ((length) + (length) / 128 + MEMORY_COMPRESS_TOKEN_MAX)
+
+/**
+ * Room to leave past the decoded data when decoding in place, for an encoded
+ * length (see memory_decompress_in_place())
+ */
+#define MEMORY_DECOMPRESS_MARGIN(encoded) ((encoded) / 128 + 16)
+
+/**
+ * State of a streaming encode. Everything is private to the encoder.
+ */
+typedef struct compress_stream {
+    uint8_t prev;          /* last sample taken */
+    uint8_t run_value;     /* difference repeated by the pending run */
+    size_t run_length;     /* length of the pending run, 0 for none */
+    size_t literal_length; /* differences waiting in literal */
+    uint8_t literal[128];
+} compress_stream_t;
+
+/**
+ * @brief Starts a streaming encode
+ *
+ * @param stream state to set up
+ */
+void memory_compress_init(compress_stream_t* stream);
+
+/**
+ * @brief Encodes as much of a buffer as fits in the output
+ *
+ * Samples are taken until all are consumed or less than
+ * MEMORY_COMPRESS_TOKEN_MAX bytes of dst are left. Runs and short literals
+ * can stay pending in the stream across calls, so the output lags the input.
+ *
+ * @param stream state from memory_compress_init()
+ * @param src samples to encode
+ * @param length number of samples
+ * @param dst where the encoded bytes go
+ * @param capacity room in dst
+ * @param consumed receives the number of samples taken from src
+ *
+ * @return number of bytes written to dst
+ */
+size_t memory_compress_update(compress_stream_t* stream, const uint8_t* src,
+                              size_t length, uint8_t* dst, size_t capacity,
+                              size_t* consumed);
+
+/**
+ * @brief Writes out whatever the stream still holds
+ *
+ * The stream can be reused for the next buffer afterwards, continuing from
+ * its last sample.
+ *
+ * @param stream state from memory_compress_init()
+ * @param dst where the encoded bytes go
+ * @param capacity room in dst, at least MEMORY_COMPRESS_TOKEN_MAX
+ *
+ * @return number of bytes written, 0 (and nothing flushed) if capacity is
+ * too small
+ */
+size_t memory_compress_finish(compress_stream_t* stream, uint8_t* dst,
+                              size_t capacity);
+
+/**
+ * @brief Encodes a buffer in one call
+ *
+ * @param src samples to encode
+ * @param length number of samples
+ * @param dst where the encoded bytes go, MEMORY_COMPRESS_BOUND(length) is
+ * always enough
+ * @param capacity room in dst
+ *
+ * @return encoded length, or 0 if it does not fit in capacity
+ */
+size_t memory_compress(const uint8_t* src, size_t length, uint8_t* dst,
+                       size_t capacity);
+
+/**
+ * @brief Decodes a buffer
+ *
+ * The buffers must not overlap; see memory_decompress_in_place() for that.
+ * Long runs of a repeated sample are written with my_memset(), and on x86
+ * HOST builds literals are summed 16 at a time with SSE2 unless the memory
+ * module is pinned to the scalar tier (see memory_select_isa()).
+ *
+ * @param src encoded data
+ * @param length number of encoded bytes
+ * @param dst where the samples go
+ * @param capacity room in dst
+ *
+ * @return number of samples, or 0 if the data is malformed or does not fit
+ */
+size_t memory_decompress(const uint8_t* src, size_t length, uint8_t* dst,
+                         size_t capacity);
+
+/**
+ * @brief Decodes a buffer over itself
+ *
+ * The encoded data sits at the end of buf and the samples are written from
+ * its start, so no second buffer is needed. That works whenever buf has
+ * MEMORY_DECOMPRESS_MARGIN(length) bytes more than the decoded size, and
+ * fails cleanly, never overwriting data it has not read, if it has not.
+ *
+ * @param buf buffer holding the encoded data in its last length bytes
+ * @param size size of buf
+ * @param length number of encoded bytes
+ *
+ * @return number of samples, now at the start of buf, or 0 if the data is
+ * malformed or does not fit
+ */
+size_t memory_decompress_in_place(uint8_t* buf, size_t size, size_t length);
+
+#endif /* __COMPRESS_H__ */
@@ -30,9 +30,47 @@
 #define MEM_ZERO_LENGTH (16)
 
 #define TEST_MEMMOVE_LENGTH (16)
+#define TEST_SWEEP_SIZE_B   (256)
+#define TEST_POOL_BLOCKS    (24)
+#define TEST_CACHE_BLOCKS   (96)
+#define TEST_CACHE_SIZE_B   (32)
+#define TEST_BSWAP_SIZE_B   (1024)
+#define TEST_SEARCH_SIZE_B  (512)
+#define TEST_STRIDED_SIZE_B (1024)
+#define TEST_GATHER_COUNT   (64)
+#define TEST_MATRIX_DIM     (72)
+#define TEST_COPYV_DESCS    (81)
+#define TEST_COPYV_SRC_B    (1024)
+#define TEST_COPYV_DST_B    (4096)
+#define TEST_PATTERN_SIZE_B (1024)
+#define TEST_CHECKSUM_SIZE_B (4096)
+#define TEST_SPAN_SIZE_B    (256)
+#if defined (MSP432)
+/* with room for the 4 KiB alignment gap in the 16 KiB target heap */
+#define TEST_ALIGNED_HEAP_B (2048)
+/* no nodes there, so this only has to exercise the fallback */
+#define TEST_NUMA_SIZE_B    (4096)
+/* three buffers of this many words are 12 KiB of the 16 KiB heap */
+#define TEST_SORT_SIZE      (1024)
+#else
+#define TEST_ALIGNED_HEAP_B (16384)
+#define TEST_NUMA_SIZE_B    (65536)
+#define TEST_SORT_SIZE      (4096)
+#endif
+#define TEST_ALIGNED_SHIFTS (6)
+#define TEST_COMPRESS_SIZE_B (4096)
+#define TEST_SUMMARY_SIZE_B (512)
+/* past the 2^32 / 255 samples an unsigned int sum can hold */
+#define TEST_SUMMARY_BIG_B  (17UL << 20)
+#define TEST_MATRIX_PITCH   (TEST_MATRIX_DIM + 3)
+#define TEST_MATRIX_SIZE_B  (TEST_MATRIX_PITCH * (TEST_MATRIX_DIM + 2))
+#define TEST_TLSF_SIZE_B    (4096)
+#define TEST_TLSF_BLOCKS    (12)
+/* a histogram, the number string before it and their alignment slack */
+#define TEST_ARENA_SIZE_B   (sizeof(stats_histogram_t) + 64)
 #define TEST_ERROR          (1)
 #define TEST_NO_ERROR       (0)
-#define TESTCOUNT           (8)
+#define TESTCOUNT           (30)
 
 /**
  * @brief function to run course1 materials
@@ -100,6 +138,90 @@ int8_t test_memmove2();
  */
 int8_t test_memmove3();
 
+/**
+ * @brief function to test memmove across lengths and alignments
+ * 
+ * This function moves every length up to half of a TEST_SWEEP_SIZE_B buffer,
+ * at a range of source/destination offsets that overlap in both directions,
+ * and compares each result against a byte-by-byte reference. It exercises
+ * the head, word, vector and tail paths of the move engine.
+ *
+ * @return void
+ */
+int8_t test_memmove4();
+
+/**
+ * @brief function to test every instruction set tier of the memory kernels
+ * 
+ * This function pins each tier the CPU supports in turn and checks memmove,
+ * memcopy, memset and reverse against byte-by-byte references at a range of
+ * lengths and offsets, then reverse alone up to lengths that exercise the
+ * widest tier's unrolled loop. The default tier is restored afterwards.
+ *
+ * @return void
+ */
+int8_t test_memory_isa();
+
+/**
+ * @brief function to test the non-temporal memset and memzero path
+ * 
+ * This function drops the stream threshold to one byte so that every memset
+ * and memzero takes the non-temporal path, and checks the result at a range of
+ * lengths and offsets on each instruction set tier.
+ *
+ * @return void
+ */
+int8_t test_memset_stream();
+
+/**
+ * @brief function to test the pool behind reserve_words and free_words
+ * 
+ * This function reserves blocks in every pool size class, fills each with its
+ * own pattern and checks no block overwrote another. It then frees them and
+ * checks a request of the same size recycles the last freed block, and that a
+ * request above the largest class is served outside the pool.
+ *
+ * @return void
+ */
+int8_t test_reserve_pool();
+
+/**
+ * @brief function to test reserve/free churn through the pool thread caches
+ * 
+ * This function reserves more blocks of one class than a thread cache keeps,
+ * stamps each with its index, frees them all so full batches move out of the
+ * cache, then reserves them again. A block handed out twice would lose its
+ * stamp. On HOST it finally flushes the calling thread's cache.
+ *
+ * @return void
+ */
+int8_t test_thread_cache();
+
+/**
+ * @brief function to test the TLSF heap
+ * 
+ * This function runs a TLSF allocator over a small local region, allocates
+ * blocks of varied sizes, checks they do not overlap, frees them in an
+ * interleaved order and checks they all merge back into one free block. It
+ * then checks that reserve_bytes serves a request above the pool classes.
+ *
+ * @return void
+ */
+int8_t test_tlsf();
+
+/**
+ * @brief function to test the scratch arena
+ * 
+ * This function allocates aligned chunks from an arena over a local buffer,
+ * checks marks and rewinds hand the same memory out again, and runs a number
+ * conversion and the statistics printout with the arena as scratch space,
+ * checking the histogram was built there, the arena mark is restored and the
+ * input array keeps its order.
+ *
+ * @return void
+ */
+int8_t test_arena();
+
 /**
  * @brief function to test the memcopy functionality
  * 
@@ -130,5 +252,201 @@ int8_t test_memset();
  */
 int8_t test_reverse();
 
+/**
+ * @brief function to test the byte-swap and word-reverse array functions
+ * 
+ * This function pins each instruction set tier in turn and runs
+ * my_bswap16_array, my_bswap32_array and my_reverse_words, in place and as
+ * copies, at every length up to several vectors and at unaligned offsets. Each
+ * byte of the buffer is checked against the byte it should have come from.
+ *
+ * @return void
+ */
+int8_t test_bswap();
+
+/**
+ * @brief function to test the search and compare functions
+ * 
+ * This function pins each instruction set tier in turn and, over a range of
+ * lengths, checks my_memchr and my_memrchr tell a first and a last occurrence
+ * apart, that my_memcmp orders buffers differing at one byte, and that
+ * my_memmem skips near misses sharing a needle's first and last bytes.
+ *
+ * @return void
+ */
+int8_t test_search();
+
+/**
+ * @brief function to test the strided and indexed accessors
+ *
+ * This function pins each instruction set tier in turn and checks
+ * get_strided and set_strided for strides with and without vector kernels,
+ * over a range of counts, leaving the bytes between the elements and past the
+ * last one untouched. gather and scatter are checked with repeated indexes.
+ *
+ * @return void
+ */
+int8_t test_strided();
+
+/**
+ * @brief function to test the 2D copy and the byte matrix transpose
+ *
+ * This function pins each instruction set tier in turn and transposes
+ * windows of a larger matrix, with widths and heights on both sides of the
+ * block and tile sizes, checking every byte of the destination including the
+ * frame around the window. The same windows are copied with my_memcopy_2d
+ * between different pitches.
+ *
+ * @return void
+ */
+int8_t test_transpose();
+
+/**
+ * @brief function to test the batched copy
+ *
+ * This function pins each instruction set tier in turn and runs one batch of
+ * copies with lengths on both sides of the inline size limit of every tier,
+ * packed one guard byte apart. The last copy of the batch reads what an
+ * earlier one wrote, to check the descriptors run in order.
+ *
+ * @return void
+ */
+int8_t test_memcopy_v();
+
+/**
+ * @brief function to test the 16/32/64-bit pattern fills
+ *
+ * This function pins each instruction set tier in turn and fills runs of each
+ * element width at every byte alignment, with cached and non-temporal stores,
+ * checking every element and the bytes on both sides of the run.
+ *
+ * @return void
+ */
+int8_t test_memset_pattern();
+
+/**
+ * @brief function to test the checksum module
+ *
+ * This function checks the published check values of each checksum, then
+ * pins each instruction set tier in turn and compares the CRCs against a
+ * bit-at-a-time reference over a range of lengths. Each buffer is also
+ * checked in two pieces, continued and combined, and copied with the fused
+ * copy and CRC32C.
+ *
+ * @return void
+ */
+int8_t test_checksum();
+
+/**
+ * @brief function to test byte spans and the span forms of the APIs
+ *
+ * This function checks that sub-ranges and splits are clamped to their
+ * parent, that the memory and data span functions stay inside the spans they
+ * are given, and that the stats of a sub-range leave it in its order.
+ *
+ * @return void
+ */
+int8_t test_span();
+
+/**
+ * @brief function to test aligned reservations
+ *
+ * This function reserves pool, heap and (on HOST) huge page sized blocks at
+ * every alignment from 16 to 4096 bytes and fills them, checks the default
+ * and invalid alignments, and checks that tlsf_memalign() gives the skipped
+ * space back so the heap merges to one block once everything is freed.
+ *
+ * @return void
+ */
+int8_t test_reserve_aligned();
+
+/**
+ * @brief function to test NUMA placement and the parallel zero
+ *
+ * This function reserves buffers for the local node, interleaved, on node 0
+ * and on a node that does not exist, checks they are usable and on an
+ * existing node, and zeroes odd sub-ranges of a buffer with 0 to 5 threads
+ * without touching the bytes around them. It passes on single-node machines.
+ *
+ * @return void
+ */
+int8_t test_numa();
+
+/**
+ * @brief function to test the delta and run-length codec
+ *
+ * This function round-trips a ramp, a sensor-like trace, noise and a
+ * constant on every instruction set tier, checks the size bounds, that
+ * truncated data and short outputs are refused, that a streaming encode in
+ * uneven pieces gives the same bytes as one call, and decodes in place.
+ *
+ * @return void
+ */
+int8_t test_compress();
+
+/**
+ * @brief function to test the sorts
+ *
+ * This function sorts random, constant, ascending and low-byte-only data of
+ * lengths around the insertion cutoff and up to TEST_SORT_SIZE with
+ * sort_array, sort_array_u16 and sort_array_u32, and checks that each result
+ * is in descending order and holds the same values.
+ *
+ * @return void
+ */
+int8_t test_sort();
+
+/**
+ * @brief function to test the histogram statistics
+ *
+ * This function builds histograms of random, constant and long-run data, in
+ * one call and in uneven chunks, and checks the minimum, maximum, mean, mode,
+ * median and every percentile against a sorted copy. It also checks that
+ * find_median, find_maximum, find_minimum and print_statistics take unsorted
+ * data and leave it as it was, and that empty histograms are refused.
+ *
+ * @return void
+ */
+int8_t test_histogram();
+
+/**
+ * @brief function to test stats_summary
+ *
+ * This function checks stats_summary against a plain loop on every
+ * instruction set tier, for every length up to TEST_SUMMARY_SIZE_B at
+ * several alignments, with the extremes planted at varying positions. It
+ * also checks that empty input is refused without touching errno, and on
+ * HOST that the sum of TEST_SUMMARY_BIG_B bytes of 255 does not overflow.
+ * On MSP432, where every length from 8 up takes the Cortex-M4 DSP path, it
+ * also times TEST_SUMMARY_SIZE_B bytes with the DWT cycle counter, through
+ * stats_summary and through the plain loop, and leaves the two counts in
+ * test_summary_cycles for a debugger to read, since PRINTF prints nothing
+ * there.
+ *
+ * @return void
+ */
+int8_t test_summary();
+
+#if defined (MSP432)
+/**
+ * Cycles test_summary() measured: [0] stats_summary, [1] the plain loop
+ */
+extern volatile uint32_t test_summary_cycles[2];
+#endif
+
+/**
+ * @brief function to test find_kth and find_median_select
+ *
+ * This function selects the first, last, middle and a random rank of
+ * random, constant, ascending and organ pipe keys of 1, 2 and 4 bytes, for
+ * lengths around the insertion cutoff and up to TEST_SORT_SIZE, and checks
+ * them against a sorted copy. Selecting on a scratch copy must leave the keys
+ * in their order, in place they must end up partitioned around the rank.
+ * Out of range ranks, unsupported widths and empty arrays are refused.
+ *
+ * @return void
+ */
+int8_t test_select();
+
 #endif /* __COURSE1_H__ */
 
@@ -23,6 +23,8 @@
 #define __DATA_H__
 
 #include<stdint.h>
+#include "arena.h"
+#include "span.h"
 
 /**
  * @brief Conversion from integer to string 
@@ -52,6 +54,22 @@
  */
 uint8_t my_itoa(int32_t data, uint8_t * ptr, uint32_t base);
 
+/**
+ * @brief Conversion from integer to a newly allocated string
+ *
+ * Same conversion as my_itoa(), into a buffer large enough for any 32-bit
+ * value in any supported base. The buffer is taken from the scratch arena when
+ * one is given, and goes away when the arena is rewound or reset. Without an
+ * arena it comes from reserve_bytes() and must be released with free_bytes().
+ *
+ * @param data Signed integer to covert string
+ * @param base Base to be used for coversion, 2 to 16
+ * @param scratch Arena to allocate from, or NULL
+ *
+ * @return the converted string, or NULL if no buffer could be allocated
+ */
+uint8_t* my_itoa_alloc(int32_t data, uint32_t base, arena_t* scratch);
+
 /**
  * @brief Conversion from an ASCII represented string into an integer 
  *
@@ -72,4 +90,28 @@ uint8_t my_itoa(int32_t data, uint8_t * ptr, uint32_t base);
  */
 int32_t my_atoi(uint8_t * ptr, uint8_t digits, uint32_t base);
 
+/**
+ * @brief Span form of my_itoa()
+ *
+ * The string, null terminator included, is only written if it fits in dst.
+ *
+ * @param data Signed integer to covert string
+ * @param dst Space to write out the coverted string
+ * @param base Base to be used for coversion, 2 to 16
+ *
+ * @return the characters written, without the terminator, or an empty span if
+ * dst is too short
+ */
+byte_span_t my_itoa_span(int32_t data, byte_span_t dst, uint32_t base);
+
+/**
+ * @brief Span form of my_atoi()
+ *
+ * @param src the characters to convert; a trailing null terminator is ignored
+ * @param base Base to be used for coversion, 2 to 16
+ *
+ * @return The converted 32-bit signed integer
+ */
+int32_t my_atoi_span(byte_span_t src, uint32_t base);
+
 #endif /* __DATA_H__ */
@@ -0,0 +1,42 @@
+/******************************************************************************
+ * Copyright (C) 2024 by Hatem Alamir
+ *
+ * Redistribution, modification or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are 
+ * permitted to modify this and use it to learn about the field of embedded
+ * software. Hatem Alamir is not liable for any misuse of this material.
+ *
+ *****************************************************************************/
+/**
+ * @file mem_lock.h
+ * @brief Minimal spinlock shared by the allocators
+ *
+ * On HOST this is a test-and-test-and-set lock on the GCC atomic builtins. On
+ * MSP432 there is a single thread of execution and the allocators are not
+ * called from interrupt handlers, so the lock compiles to nothing.
+ *
+ * @author Hatem Alamir
+ * @date December 14 2024
+ *
+ */
+#ifndef __MEM_LOCK_H__
+#define __MEM_LOCK_H__
+
+typedef volatile int mem_lock_t;
+
+#if defined (HOST)
+static inline void mem_lock(mem_lock_t* lock) {
+    while(__atomic_test_and_set(lock, __ATOMIC_ACQUIRE))
+        while(__atomic_load_n(lock, __ATOMIC_RELAXED))
+            ;
+}
+
+static inline void mem_unlock(mem_lock_t* lock) {
+    __atomic_clear(lock, __ATOMIC_RELEASE);
+}
+#else
+static inline void mem_lock(mem_lock_t* lock) { (void)lock; }
+static inline void mem_unlock(mem_lock_t* lock) { (void)lock; }
+#endif
+
+#endif /* __MEM_LOCK_H__ */
@@ -0,0 +1,151 @@
+/******************************************************************************
+ * Copyright (C) 2024 by Hatem Alamir
+ *
+ * Redistribution, modification or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are 
+ * permitted to modify this and use it to learn about the field of embedded
+ * software. Hatem Alamir is not liable for any misuse of this material.
+ *
+ *****************************************************************************/
+/**
+ * @file mem_pool.h
+ * @brief Fixed-block pool allocator with power-of-two size classes
+ *
+ * The pool serves reserve_words() and free_words() from a static arena. The
+ * arena is split into pages; a page is handed to one size class the first time
+ * that class runs dry and is carved into equal blocks. Freed blocks go on the
+ * free list of their class. Both allocation and release are O(1) and never
+ * call malloc.
+ *
+ * The arena, page and class sizes can be overridden at build time. The pool
+ * is serialized with a spinlock on HOST (see mem_lock.h); on MSP432 it must not
+ * be used from interrupt handlers.
+ *
+ * On HOST each thread also caches free blocks per class, so the lock is only
+ * taken once per MEM_POOL_TCACHE_BATCH allocations. Full batches a thread frees
+ * but does not reuse go to a lock-free depot that other threads refill from.
+ * Build with -DMEM_POOL_NO_TCACHE to leave the caches out.
+ *
+ * @author Hatem Alamir
+ * @date December 12 2024
+ *
+ */
+#ifndef __MEM_POOL_H__
+#define __MEM_POOL_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#if defined (MSP432)
+#ifndef MEM_POOL_ARENA_SIZE
+#define MEM_POOL_ARENA_SIZE (16UL << 10)
+#endif
+#ifndef MEM_POOL_PAGE_SIZE
+#define MEM_POOL_PAGE_SIZE  (512UL)
+#endif
+#ifndef MEM_POOL_MIN_SHIFT
+#define MEM_POOL_MIN_SHIFT  (3)
+#endif
+#ifndef MEM_POOL_MAX_SHIFT
+#define MEM_POOL_MAX_SHIFT  (8)
+#endif
+#else
+#ifndef MEM_POOL_ARENA_SIZE
+#define MEM_POOL_ARENA_SIZE (8UL << 20)
+#endif
+#ifndef MEM_POOL_PAGE_SIZE
+#define MEM_POOL_PAGE_SIZE  (4096UL)
+#endif
+#ifndef MEM_POOL_MIN_SHIFT
+#define MEM_POOL_MIN_SHIFT  (4)
+#endif
+#ifndef MEM_POOL_MAX_SHIFT
+#define MEM_POOL_MAX_SHIFT  (11)
+#endif
+#endif
+
+/** Smallest and largest block sizes, in bytes */
+#define MEM_POOL_MIN_BLOCK   (1UL << MEM_POOL_MIN_SHIFT)
+#define MEM_POOL_MAX_BLOCK   (1UL << MEM_POOL_MAX_SHIFT)
+/** Number of size classes, one per power of two between the two */
+#define MEM_POOL_CLASS_COUNT (MEM_POOL_MAX_SHIFT - MEM_POOL_MIN_SHIFT + 1)
+
+#if defined (HOST) && !defined (MEM_POOL_NO_TCACHE)
+#define MEM_POOL_TCACHE
+/** Blocks moved between a thread cache and the shared pool at once */
+#ifndef MEM_POOL_TCACHE_BATCH
+#define MEM_POOL_TCACHE_BATCH (32)
+#endif
+#endif
+
+/**
+ * @brief Allocates a block from the pool
+ *
+ * The request is rounded up to the next size class. Requests larger than
+ * MEM_POOL_MAX_BLOCK, or made when the class is empty and no page is left, fail
+ * so the caller can fall back to another allocator.
+ *
+ * @param bytes number of bytes needed
+ *
+ * @return pointer to a block aligned to min(block size, page size), or NULL
+ */
+void* mem_pool_alloc(size_t bytes);
+
+/**
+ * @brief Returns a block to its size class
+ *
+ * @param ptr block obtained from mem_pool_alloc(); must be owned by the pool
+ */
+void mem_pool_free(void* ptr);
+
+/**
+ * @brief Tells whether a pointer lies in the pool arena
+ *
+ * @param ptr any pointer, NULL included
+ *
+ * @return 1 if ptr was (or could have been) handed out by the pool, 0 otherwise
+ */
+int mem_pool_owns(const void* ptr);
+
+/**
+ * @brief Returns the size of the block a pool pointer belongs to
+ *
+ * @param ptr block obtained from mem_pool_alloc()
+ *
+ * @return block size in bytes
+ */
+size_t mem_pool_usable_size(const void* ptr);
+
+/**
+ * @brief Returns the block size of the class that serves a request
+ *
+ * @param bytes number of bytes requested
+ *
+ * @return block size in bytes, or 0 if the request is too large for the pool
+ */
+size_t mem_pool_block_size(size_t bytes);
+
+#if defined (MEM_POOL_TCACHE)
+/**
+ * @brief Returns the calling thread's cached blocks to the shared pool
+ *
+ * This runs automatically when a thread that used the pool exits. Call it
+ * before a long idle period to let other threads reuse the blocks.
+ */
+void mem_pool_thread_flush(void);
+
+/**
+ * @brief Turns the thread caches on or off for every thread
+ *
+ * With the caches off every call takes the pool lock, which is only useful to
+ * measure what the caches buy. Blocks already cached stay where they are until
+ * the caches are turned back on or flushed.
+ *
+ * @param enable non-zero to use the caches
+ *
+ * @return the previous setting
+ */
+int mem_pool_thread_cache(int enable);
+#endif
+
+#endif /* __MEM_POOL_H__ */
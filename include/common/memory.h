@@ -27,6 +27,84 @@
 
 #include<stdint.h>
 #include<stddef.h>
+#include "span.h"
+
+/**
+ * @brief Instruction set tiers the memory primitives can run on
+ *
+ * On x86 HOST builds my_memcopy, my_memmove, the my_memset family,
+ * my_memzero, my_reverse, the word-reverse and byte-swap array functions, the
+ * search and compare functions, get_strided/set_strided, my_memcopy_v and
+ * my_transpose_u8 are bound at load time to the kernels of the best tier the
+ * CPU supports. The
+ * MEMORY_FORCE_ISA environment variable (scalar, sse2, avx2 or avx512) pins a
+ * lower tier. Every other build only has the scalar tier, which
+ * works in 64-bit words.
+ */
+typedef enum {
+    MEMORY_ISA_SCALAR = 0,
+    MEMORY_ISA_SSE2,
+    MEMORY_ISA_AVX2,
+    MEMORY_ISA_AVX512,
+    MEMORY_ISA_COUNT
+} memory_isa_t;
+
+/**
+ * Default size in bytes from which the my_memset family and my_memzero switch
+ * to non-temporal (cache bypassing) stores. Can be overridden at build time with
+ * -DMEMORY_STREAM_THRESHOLD=<bytes> or at run time with
+ * memory_set_stream_threshold().
+ */
+#ifndef MEMORY_STREAM_THRESHOLD
+#define MEMORY_STREAM_THRESHOLD (8UL << 20)
+#endif
+
+/**
+ * Size in bytes of the TLSF heap behind reserve_bytes() and reserve_words().
+ * On MSP432 this sizes the .heap section of the linker script.
+ */
+#ifndef MEMORY_HEAP_SIZE
+#if defined (MSP432)
+#define MEMORY_HEAP_SIZE (16UL << 10)
+#else
+#define MEMORY_HEAP_SIZE (32UL << 20)
+#endif
+#endif
+
+/**
+ * Alignment in bytes reserve_words_aligned() uses when asked for 0, the size
+ * of a data cache line.
+ */
+#define MEMORY_CACHE_LINE (64UL)
+
+/**
+ * Size in bytes of a huge page, and the granule of the mappings behind large
+ * aligned reservations on Linux HOST builds.
+ */
+#define MEMORY_HUGE_PAGE_SIZE (2UL << 20)
+
+/**
+ * Size in bytes from which reserve_words_aligned() maps the buffer on its own,
+ * backed by huge pages where the kernel has them. Linux HOST builds only.
+ */
+#ifndef MEMORY_HUGE_THRESHOLD
+#define MEMORY_HUGE_THRESHOLD (4UL << 20)
+#endif
+
+/**
+ * Number of huge page mappings that can be live at a time. Past that, large
+ * aligned reservations come from the heap instead.
+ */
+#ifndef MEMORY_MAX_MAPPINGS
+#define MEMORY_MAX_MAPPINGS (32)
+#endif
+
+/**
+ * Placements for reserve_words_node() besides a node number: wherever the
+ * pages are first touched, or spread page by page over all nodes.
+ */
+#define MEMORY_NODE_LOCAL      (-1)
+#define MEMORY_NODE_INTERLEAVE (-2)
 
 /**
  * @brief Sets a value of a data array 
@@ -96,13 +174,86 @@ void set_all(char * ptr, char value, unsigned int size);
  */
 void clear_all(char * ptr, unsigned int size);
 
+/**
+ * @brief Reads every stride-th element of a data array
+ *
+ * Given a pointer to a char data set, this will copy the elements at
+ * indexes 0, stride, 2 * stride, ... into consecutive elements of dst,
+ * e.g. one channel out of interleaved samples. Strides of 2, 3 and 4 are
+ * split a vector at a time with byte packs and shuffles.
+ *
+ * @param ptr Pointer to data array
+ * @param stride Distance between the elements to read
+ * @param dst Pointer to count elements receiving the values, not overlapping
+ * the data array
+ * @param count Number of elements to read
+ *
+ * @return void.
+ */
+void get_strided(char * ptr, unsigned int stride, char * dst,
+                 unsigned int count);
+
+/**
+ * @brief Writes every stride-th element of a data array
+ *
+ * The reverse of get_strided(): consecutive elements of src are written to
+ * indexes 0, stride, 2 * stride, ... of the data set. The elements in between
+ * keep their values, but may be rewritten with them, so they must not be
+ * written concurrently by another thread.
+ *
+ * @param ptr Pointer to data array
+ * @param stride Distance between the elements to write
+ * @param src Pointer to count values, not overlapping the data array
+ * @param count Number of elements to write
+ *
+ * @return void.
+ */
+void set_strided(char * ptr, unsigned int stride, char * src,
+                 unsigned int count);
+
+/**
+ * @brief Reads the elements of a data array at a list of indexes
+ *
+ * dst[i] receives ptr[indices[i]] for each of the count indexes.
+ *
+ * @param ptr Pointer to data array
+ * @param indices Indexes into the data array to read
+ * @param dst Pointer to count elements receiving the values, not overlapping
+ * the data array
+ * @param count Number of indexes
+ *
+ * @return void.
+ */
+void gather(char * ptr, const unsigned int * indices, char * dst,
+            unsigned int count);
+
+/**
+ * @brief Writes the elements of a data array at a list of indexes
+ *
+ * ptr[indices[i]] receives src[i] for each of the count indexes. When an
+ * index repeats, the last value written to it remains.
+ *
+ * @param ptr Pointer to data array
+ * @param indices Indexes into the data array to write
+ * @param src Pointer to count values, not overlapping the data array
+ * @param count Number of indexes
+ *
+ * @return void.
+ */
+void scatter(char * ptr, const unsigned int * indices, char * src,
+             unsigned int count);
+
 /**
  * @brief Moves a number of bytest from one location to another.
  *
  * This function takes two byte pointers (one source and one destination) and a
  * length of bytes to move from the source location to the destination.
  * Overlap of source and destination is handled so that no data corruption
- * occurs.
+ * occurs: the copy direction is chosen once, up front, from the relative
+ * position of the two buffers.
+ * The bulk of the move is done in aligned 64-bit words, or in the widest
+ * vectors the CPU supports (see memory_isa_t). The unaligned head and tail are
+ * covered by overlapping accesses loaded before anything is stored.
  * All operations are performed using pointer arithmatic, not array indexing.
  *
  * @param src pointer to first byte to move
@@ -122,6 +273,8 @@ uint8_t* my_memmove(uint8_t * src, uint8_t* dst, size_t length);
  * should still occur, but will likely corrupt your data.
  * All operations are performed using pointer arithmatic, not array indexing.
  *
+ * Unlike my_memmove, the copy always runs front to back.
+ *
  * @param src pointer to first byte to move
  * @param dst pointer to first byte in destination
  * @param length how many bytes to move
@@ -130,6 +283,78 @@ uint8_t* my_memmove(uint8_t * src, uint8_t* dst, size_t length);
  */
 uint8_t* my_memcopy(uint8_t * src, uint8_t* dst, size_t length);
 
+/**
+ * One copy of a my_memcopy_v() batch
+ */
+struct copy_desc {
+    const uint8_t* src;
+    uint8_t* dst;
+    size_t length;
+};
+
+/**
+ * @brief Runs a batch of copies in one call
+ *
+ * Equivalent to calling my_memcopy() on each descriptor in array order, so a
+ * copy may read what an earlier one in the batch wrote. Copies of up to two
+ * vectors (16 bytes on the scalar tier, 128 with AVX-512) are done inline by
+ * fixed-size head and tail accesses for their size class, without a call
+ * each; with AVX-512, copies of up to 64 bytes are one masked load and store
+ * with no branch on the length. The sources of upcoming descriptors are
+ * prefetched. This is the way to issue thousands of small copies, where
+ * per-call overhead would dominate.
+ * As with my_memcopy(), the source and destination of one descriptor must
+ * not overlap.
+ *
+ * @param descs array of copies to perform
+ * @param count number of descriptors
+ *
+ * @return void.
+ */
+void my_memcopy_v(const struct copy_desc * descs, size_t count);
+
+/**
+ * @brief Copies a rectangle of bytes between two row-major matrices
+ *
+ * Each of the height rows of width bytes is copied with the my_memcopy
+ * kernel. A pitch is the distance in bytes from the start of one row to the
+ * start of the next, so the rectangle can be a window into a larger matrix.
+ * Source and destination must not overlap.
+ *
+ * @param src pointer to the first byte of the source rectangle
+ * @param src_pitch distance between source rows
+ * @param dst pointer to the first byte of the destination rectangle
+ * @param dst_pitch distance between destination rows
+ * @param width bytes per row
+ * @param height number of rows
+ *
+ * @return pointer to first byte in destination
+ */
+uint8_t* my_memcopy_2d(uint8_t * src, size_t src_pitch, uint8_t * dst,
+                       size_t dst_pitch, size_t width, size_t height);
+
+/**
+ * @brief Transposes a row-major byte matrix
+ *
+ * The source is height rows of width bytes; the destination receives width
+ * rows of height bytes, with dst[c * dst_pitch + r] = src[r * src_pitch + c].
+ * Blocks of 8x8 bytes (scalar) or 16 rows of a vector (SIMD tiers) are
+ * transposed in registers and walked in 64x64 tiles, which keeps matrices
+ * larger than the caches from thrashing the destination lines.
+ * Source and destination must not overlap.
+ *
+ * @param src pointer to the first byte of the source matrix
+ * @param src_pitch distance in bytes between source rows
+ * @param dst pointer to the first byte of the destination matrix
+ * @param dst_pitch distance in bytes between destination rows
+ * @param width columns of the source, rows of the destination
+ * @param height rows of the source, columns of the destination
+ *
+ * @return pointer to first byte in destination
+ */
+uint8_t* my_transpose_u8(uint8_t * src, size_t src_pitch, uint8_t * dst,
+                         size_t dst_pitch, size_t width, size_t height);
+
 /**
  * @brief Sets a number of bytest to a given value.
  *
@@ -137,6 +362,8 @@ uint8_t* my_memcopy(uint8_t * src, uint8_t* dst, size_t length);
  * and set all locations of that memory to a given value.
  * All operations are performed using pointer arithmatic, not array indexing.
  * This function does NOT reuse the set_all() function in this same module.
+ * From the stream threshold up (see memory_set_stream_threshold()) the fill
+ * uses non-temporal stores, which leave the cache contents alone.
  *
  * @param src pointer to source memory location
  * @param length how many bytes to set
@@ -146,6 +373,24 @@ uint8_t* my_memcopy(uint8_t * src, uint8_t* dst, size_t length);
  */
 uint8_t* my_memset(uint8_t * src, size_t length, uint8_t value);
 
+/**
+ * @brief Fills an array of 16, 32 or 64-bit elements with one value
+ *
+ * The value is broadcast into full vector registers (a 64-bit word pair on
+ * the M4) and stored like my_memset(): unaligned head and tail, aligned body.
+ * src may sit at any byte address, the stores are rotated to stay in phase
+ * with it. From the stream threshold up the body uses non-temporal stores.
+ *
+ * @param src pointer to the first element
+ * @param count how many elements to set
+ * @param value value stored in every element
+ *
+ * @return pointer to source
+ */
+uint16_t* my_memset16(uint16_t * src, size_t count, uint16_t value);
+uint32_t* my_memset32(uint32_t * src, size_t count, uint32_t value);
+uint64_t* my_memset64(uint64_t * src, size_t count, uint64_t value);
+
 /**
  * @brief Sets a number of bytest to zero.
  *
@@ -153,6 +398,7 @@ uint8_t* my_memset(uint8_t * src, size_t length, uint8_t value);
  * and set all locations of that memory to zero.
  * All operations are performed using pointer arithmatic, not array indexing.
  * This function does NOT reuse the clear_all() function in this same module.
+ * Large buffers are zeroed with non-temporal stores, like my_memset().
  *
  * @param src pointer to source memory location
  * @param length how many bytes to zero out
@@ -162,12 +408,35 @@ uint8_t* my_memset(uint8_t * src, size_t length, uint8_t value);
  */
 uint8_t* my_memzero(uint8_t * src, size_t length);
 
+/**
+ * @brief Zeroes a buffer from several threads, for first-touch placement
+ *
+ * The buffer is cut on page boundaries (huge page boundaries when each part
+ * spans one) into one part per thread, and thread i zeroes part i. On a
+ * multi-node HOST, thread i asks for its pages on node i * nodes / threads,
+ * so workers that later read the same parts should run on those nodes. This
+ * only places pages that are not yet touched, e.g. a fresh
+ * reserve_words_node() buffer with MEMORY_NODE_LOCAL; a buffer placed on a
+ * node keeps that placement. With one node, one thread, or on MSP432, it is
+ * my_memzero().
+ *
+ * @param src pointer to source memory location
+ * @param length how many bytes to zero out
+ * @param threads number of threads, at most 64
+ *
+ * @return pointer to source
+ */
+uint8_t* my_memzero_parallel(uint8_t * src, size_t length, unsigned threads);
+
 /**
  * @brief Reverses the order of a sequence of bytes.
  *
  * This function takes a pointer to a memory location and a length in bytes and
  * reverse the order of all of the bytes.
  * All operations are performed using pointer arithmatic, not array indexing.
+ * Whole vectors are swapped from both ends and byte-reversed in registers
+ * (byte shuffles on x86 hosts, REV on the M4); the middle is finished with
+ * overlapping accesses rather than a byte loop.
  *
  * @param src pointer to source memory location
  * @param length how many bytes to reverse
@@ -176,12 +445,209 @@ uint8_t* my_memzero(uint8_t * src, size_t length);
  */
 uint8_t* my_reverse(uint8_t * src, size_t length);
 
+/**
+ * @brief Reverses the order of a sequence of 32-bit words in place.
+ *
+ * The bytes within each word keep their order. The buffer need not be
+ * aligned.
+ *
+ * @param src pointer to the first word
+ * @param count how many words to reverse
+ *
+ * @return pointer to source
+ */
+uint8_t* my_reverse_words(uint8_t * src, size_t count);
+
+/**
+ * @brief Copies a sequence of 32-bit words into another buffer in reverse
+ * order.
+ *
+ * @param src pointer to the first source word
+ * @param dst pointer to the destination, which must not overlap the source
+ * @param count how many words to copy
+ *
+ * @return pointer to destination
+ */
+uint8_t* my_reverse_words_copy(uint8_t * src, uint8_t * dst, size_t count);
+
+/**
+ * @brief Swaps the byte order of every element of a 16-bit array in place.
+ *
+ * This converts big-endian samples to the native order of a little-endian
+ * CPU and back. The array need not be aligned.
+ *
+ * @param src pointer to the first element
+ * @param count number of elements
+ *
+ * @return pointer to source
+ */
+uint8_t* my_bswap16_array(uint8_t * src, size_t count);
+
+/**
+ * @brief Copies a 16-bit array and swaps the byte order of every element in
+ * the same pass.
+ *
+ * @param src pointer to the first source element
+ * @param dst pointer to the destination, either equal to src or not
+ * overlapping it
+ * @param count number of elements
+ *
+ * @return pointer to destination
+ */
+uint8_t* my_bswap16_array_copy(uint8_t * src, uint8_t * dst, size_t count);
+
+/**
+ * @brief Swaps the byte order of every element of a 32-bit array in place.
+ *
+ * @param src pointer to the first element
+ * @param count number of elements
+ *
+ * @return pointer to source
+ */
+uint8_t* my_bswap32_array(uint8_t * src, size_t count);
+
+/**
+ * @brief Copies a 32-bit array and swaps the byte order of every element in
+ * the same pass.
+ *
+ * @param src pointer to the first source element
+ * @param dst pointer to the destination, either equal to src or not
+ * overlapping it
+ * @param count number of elements
+ *
+ * @return pointer to destination
+ */
+uint8_t* my_bswap32_array_copy(uint8_t * src, uint8_t * dst, size_t count);
+
+/**
+ * @brief Compares two byte sequences.
+ *
+ * @param a pointer to the first sequence
+ * @param b pointer to the second sequence
+ * @param length how many bytes to compare
+ *
+ * @return 0 if the sequences are equal, otherwise the difference a[i] - b[i]
+ * of the first pair of bytes that differ
+ */
+int my_memcmp(const uint8_t * a, const uint8_t * b, size_t length);
+
+/**
+ * @brief Finds the first occurrence of a byte value.
+ *
+ * No byte past src + length is read.
+ *
+ * @param src pointer to the bytes to search
+ * @param value byte to look for
+ * @param length how many bytes to search
+ *
+ * @return pointer to the first matching byte, or NULL if there is none
+ */
+uint8_t* my_memchr(const uint8_t * src, uint8_t value, size_t length);
+
+/**
+ * @brief Finds the last occurrence of a byte value.
+ *
+ * @param src pointer to the bytes to search
+ * @param value byte to look for
+ * @param length how many bytes to search
+ *
+ * @return pointer to the last matching byte, or NULL if there is none
+ */
+uint8_t* my_memrchr(const uint8_t * src, uint8_t value, size_t length);
+
+/**
+ * @brief Finds the first occurrence of a byte sequence inside another.
+ *
+ * Positions where the first and last byte of the needle both match are found
+ * a vector at a time, and only those are compared in full.
+ *
+ * @param haystack pointer to the bytes to search
+ * @param haystack_length how many bytes to search
+ * @param needle pointer to the sequence to look for
+ * @param needle_length length of the sequence; an empty needle matches at the
+ * start of the haystack
+ *
+ * @return pointer to the start of the first match, or NULL if there is none
+ */
+uint8_t* my_memmem(const uint8_t * haystack, size_t haystack_length,
+                   const uint8_t * needle, size_t needle_length);
+
+/**
+ * @brief Span form of my_memmove(): moves src to the front of dst
+ *
+ * At most dst.length bytes are moved; the spans may overlap.
+ *
+ * @param src bytes to move
+ * @param dst destination
+ *
+ * @return the part of dst that was written
+ */
+byte_span_t my_memmove_span(byte_span_t src, byte_span_t dst);
+
+/**
+ * @brief Span form of my_memcopy(), truncated to dst like my_memmove_span()
+ */
+byte_span_t my_memcopy_span(byte_span_t src, byte_span_t dst);
+
+/**
+ * @brief Span forms of my_memset(), my_memzero() and my_reverse()
+ *
+ * @return span
+ */
+byte_span_t my_memset_span(byte_span_t span, uint8_t value);
+byte_span_t my_memzero_span(byte_span_t span);
+byte_span_t my_reverse_span(byte_span_t span);
+
+/**
+ * @brief Compares two spans in lexicographic order
+ *
+ * @param a first span
+ * @param b second span
+ *
+ * @return the my_memcmp() result over the shorter length if that is not 0,
+ * otherwise negative, 0 or positive as a is shorter, as long as or longer than b
+ */
+int my_memcmp_span(byte_span_t a, byte_span_t b);
+
+/**
+ * @brief Span forms of my_memchr() and my_memmem()
+ *
+ * @return the rest of the searched span from the first match on, or an empty
+ * span with a NULL data pointer if there is none
+ */
+byte_span_t my_memchr_span(byte_span_t span, uint8_t value);
+byte_span_t my_memmem_span(byte_span_t haystack, byte_span_t needle);
+
+/**
+ * @brief Allocates a number of bytes in dynamic memory
+ *
+ * Requests up to MEM_POOL_MAX_BLOCK bytes are served from the fixed-block pool
+ * (see mem_pool.h). Larger requests, or requests made once the pool is
+ * exhausted, go to a TLSF heap of MEMORY_HEAP_SIZE bytes (see tlsf.h). Both
+ * have a bounded worst case. Only on HOST, and only once the heap is full too,
+ * the request falls back to malloc.
+ *
+ * @param bytes how many bytes to allocate
+ *
+ * @return pointer to memory aligned to at least 8 bytes, or a Null Pointer if
+ * not successful
+ */
+void* reserve_bytes(size_t bytes);
+
+/**
+ * @brief Frees memory obtained from reserve_bytes() or any of the
+ * reserve_words() functions
+ *
+ * The block is returned to whichever allocator it came from. NULL is ignored.
+ *
+ * @param src pointer to dynamically allocated memory.
+ */
+void free_bytes(void* src);
+
 /**
  * @brief Allocates a number of words in dynamic memory
  *
- * This should take a pointer to a memory location and a length in bytes and
- * reverse the order of all of the bytes.
- * All operations are performed using pointer arithmatic, not array indexing.
+ * Same as reserve_bytes() for length * 4 bytes.
  *
  * @param length how many words to allocate
  *
@@ -190,16 +656,141 @@ uint8_t* my_reverse(uint8_t * src, size_t length);
  */
 int32_t * reserve_words(size_t length);
 
+/**
+ * @brief Allocates a number of words aligned to a boundary
+ *
+ * Same as reserve_words(), but the block starts on a multiple of alignment,
+ * so arrays handed to the vector kernels do not straddle cache lines. On Linux
+ * HOST builds blocks of MEMORY_HUGE_THRESHOLD bytes and more are mapped
+ * directly and backed by huge pages: explicit ones (MAP_HUGETLB) if any are
+ * reserved, transparent ones (MADV_HUGEPAGE) otherwise, and regular pages if
+ * neither is available. Free with free_words() or free_bytes().
+ *
+ * @param length how many words to allocate
+ * @param alignment power of two in bytes, 0 for MEMORY_CACHE_LINE
+ *
+ * @return pointer to memory aligned to alignment, or a Null Pointer if not
+ * successful or if alignment is not a power of two
+ */
+int32_t * reserve_words_aligned(size_t length, size_t alignment);
+
+/**
+ * @brief Allocates a number of words on a NUMA node
+ *
+ * On Linux HOST builds the block is mapped on its own like a large
+ * reserve_words_aligned() block, whatever its size, and its pages are placed
+ * with mbind() before anything touches them: preferably on node, or
+ * interleaved over all nodes. Placement is a hint. On a single-node machine,
+ * a kernel without NUMA support or a node that is not there, the block is
+ * placed on first touch as usual, and on other builds this is
+ * reserve_words_aligned(length, 0). Free with free_words() or free_bytes().
+ *
+ * @param length how many words to allocate
+ * @param node node number, MEMORY_NODE_LOCAL or MEMORY_NODE_INTERLEAVE
+ *
+ * @return pointer to memory aligned to MEMORY_CACHE_LINE, or a Null Pointer
+ * if not successful
+ */
+int32_t * reserve_words_node(size_t length, int node);
+
+/**
+ * @brief Returns the number of NUMA nodes this process may allocate from
+ *
+ * Highest allowed node plus one, from get_mempolicy(). 1 where that is not
+ * available, including on MSP432.
+ *
+ * @return node count, at least 1
+ */
+int memory_node_count(void);
+
+/**
+ * @brief Returns the NUMA node holding a byte, faulting its page in
+ *
+ * @param src address inside a mapped buffer
+ *
+ * @return node number, or -1 if it cannot be told
+ */
+int memory_node_of(const void * src);
+
 /**
  * @brief Frees a dynamic memory allocation
  *
  * Should free a dynamic memory allocation by providing the pointer src to the
- * function.
- * All operations are performed using pointer arithmatic, not array indexing.
+ * function. Same as free_bytes().
  *
  * @param src pointer to dynamically allocated memory.
  *
  */
 void free_words(uint32_t * src);
 
+/**
+ * @brief Returns the best instruction set tier the running CPU supports
+ *
+ * @return MEMORY_ISA_SCALAR on builds without runtime dispatch
+ */
+memory_isa_t memory_best_isa(void);
+
+/**
+ * @brief Binds the memory primitives to the kernels of a given tier
+ *
+ * Meant for benchmarks and tests that want to pin each variant. A tier above
+ * what the CPU supports is clamped to memory_best_isa(). This is not
+ * synchronized with concurrent calls to the primitives.
+ *
+ * @param isa requested instruction set tier
+ *
+ * @return the tier that was actually selected
+ */
+memory_isa_t memory_select_isa(memory_isa_t isa);
+
+/**
+ * @brief Returns the instruction set tier currently in use
+ *
+ * @return active tier
+ */
+memory_isa_t memory_active_isa(void);
+
+/**
+ * @brief Sets the fill size from which non-temporal stores are used
+ *
+ * Fills of at least this many bytes by the my_memset family and my_memzero
+ * bypass the caches. Only x86 HOST builds have non-temporal stores; elsewhere
+ * the value is recorded but has no effect.
+ *
+ * @param bytes new threshold, 0 to never use non-temporal stores
+ *
+ * @return the previous threshold
+ */
+size_t memory_set_stream_threshold(size_t bytes);
+
+/**
+ * @brief Returns the printable name of an instruction set tier
+ *
+ * The names are the values accepted by MEMORY_FORCE_ISA.
+ *
+ * @param isa instruction set tier
+ *
+ * @return constant string with the tier name
+ */
+const char* memory_isa_name(memory_isa_t isa);
+
+/**
+ * @brief Prints allocation telemetry through PRINTF
+ *
+ * Only built with -DMEMORY_TELEMETRY (make TELEMETRY=1). Reports the live
+ * bytes, the high-water mark, reserve and free counts per pool size class,
+ * TLSF heap and C library fallback, and the average and worst cycles spent in
+ * reserve_bytes() and free_bytes() (TSC on x86 hosts, DWT CYCCNT on MSP432),
+ * failed reserves included. Sizes are block footprints, not requested sizes.
+ * Without the flag this is an empty macro and the allocation paths carry no
+ * instrumentation at all.
+ *
+ * @return void
+ */
+#ifdef MEMORY_TELEMETRY
+void memory_stats_dump(void);
+#else
+#define memory_stats_dump() ((void)0)
+#endif
+
 #endif /* __MEMORY_H__ */
@@ -0,0 +1,102 @@
+/******************************************************************************
+ * Copyright (C) 2024 by Hatem Alamir
+ *
+ * Redistribution, modification or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of embedded
+ * software. Hatem Alamir is not liable for any misuse of this material.
+ *
+ *****************************************************************************/
+/**
+ * @file span.h
+ * @brief Non-owning views of byte buffers
+ *
+ * A byte_span is a pointer and a length passed by value. It borrows the bytes
+ * it points at: taking, narrowing or splitting a span never copies or
+ * allocates, and the owner of the buffer must keep it alive while spans of it
+ * are in use. Sub-ranges are clamped to the parent span, so a view can never
+ * reach outside the buffer it was taken from. The memory, data and stats
+ * modules have *_span forms of their entry points.
+ *
+ * @author Hatem Alamir
+ * @date December 21 2024
+ *
+ */
+#ifndef __SPAN_H__
+#define __SPAN_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef struct byte_span {
+    uint8_t* data;
+    size_t length;
+} byte_span_t;
+
+/**
+ * @brief Makes a span over length bytes from data
+ */
+static inline byte_span_t span_make(uint8_t* data, size_t length) {
+    byte_span_t span = { data, length };
+    return span;
+}
+
+/**
+ * @brief Tells whether a span has no bytes
+ */
+static inline int span_is_empty(byte_span_t span) {
+    return span.length == 0;
+}
+
+/**
+ * @brief Narrows a span to length bytes from offset
+ *
+ * Both are clamped, so the result is always inside span, and empty when
+ * offset is past its end.
+ *
+ * @param span span to take the bytes from
+ * @param offset first byte of the result, relative to span
+ * @param length number of bytes, SIZE_MAX for the rest of span
+ *
+ * @return the narrowed span
+ */
+static inline byte_span_t span_sub(byte_span_t span, size_t offset,
+                                   size_t length) {
+    if(offset > span.length)
+        offset = span.length;
+    if(length > span.length - offset)
+        length = span.length - offset;
+    return span_make(span.data + offset, length);
+}
+
+/**
+ * @brief Cuts a span in two at a byte offset, clamped to its length
+ *
+ * @param span span to cut
+ * @param at length of the head
+ * @param head receives the bytes before at
+ * @param tail receives the bytes from at on
+ */
+static inline void span_split(byte_span_t span, size_t at, byte_span_t* head,
+                              byte_span_t* tail) {
+    *head = span_sub(span, 0, at);
+    *tail = span_sub(span, head->length, SIZE_MAX);
+}
+
+/**
+ * @brief Takes up to count bytes off the front of a span
+ *
+ * Meant for walking an ingest buffer record by record.
+ *
+ * @param span span to consume, moved past the bytes taken
+ * @param count number of bytes wanted
+ *
+ * @return the bytes taken, fewer than count if span ran out
+ */
+static inline byte_span_t span_advance(byte_span_t* span, size_t count) {
+    byte_span_t head;
+    span_split(*span, count, &head, span);
+    return head;
+}
+
+#endif /* __SPAN_H__ */
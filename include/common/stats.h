@@ -23,6 +23,39 @@
 #ifndef __STATS_H__
 #define __STATS_H__
 
+#include <stdint.h>
+#include <stddef.h>
+#include "arena.h"
+#include "span.h"
+
+/**
+ * Length below which the sorts use insertion sort instead of counting or
+ * radix passes
+ */
+#ifndef STATS_SORT_CUTOFF
+#define STATS_SORT_CUTOFF (64)
+#endif
+
+/**
+ * Count of each byte value in a set of samples. Every order statistic of byte
+ * samples can be read off these 256 counts, so the samples themselves never
+ * need to be sorted or copied.
+ */
+typedef struct stats_histogram {
+    uint32_t counts[256];
+    size_t length;          /* number of samples counted */
+} stats_histogram_t;
+
+/**
+ * Minimum, maximum, sum and count of a set of samples, from stats_summary()
+ */
+typedef struct stats_result {
+    uint8_t minimum;
+    uint8_t maximum;
+    uint64_t sum;           /* 64 bits: no overflow below 2^56 samples */
+    size_t count;
+} stats_result_t;
+
 /**
  * @brief A function that prints the statistics of an array including minimum,
  * maximum, mean, and median
@@ -30,9 +63,8 @@
  * This function takes an input array of data and length, it calculates some
  * useful statistics like minimum, maximum, mean, and median, by calling other
  * specialized functions, format the output of each to be easily and pleasantly
- * readable, and print the results to the screen.  *WARNING*: This function
- * chantes the order of the array since it sorts the array first to speed up
- * calculating some statistics.
+ * readable, and print the results to the screen. The array is read once, into
+ * a histogram, and is left untouched.
  *
  * @param arr The input array for which to calculate and print stats
  * @param length The length of the array 
@@ -41,6 +73,22 @@
  */
 void print_statistics(unsigned char* arr, const unsigned int length);
 
+/**
+ * @brief Prints the statistics of an array, with the histogram in an arena
+ *
+ * Same output as print_statistics(). When an arena is given the histogram is
+ * allocated from it, and the arena rewound before returning; otherwise it
+ * takes 1 KiB of stack. Either way the input is neither copied nor reordered.
+ *
+ * @param arr The input array for which to calculate and print stats
+ * @param length The length of the array 
+ * @param scratch Arena for the histogram, or NULL to use the stack
+ *
+ * @return This function does not return any value 
+ */
+void print_statistics_ex(unsigned char* arr, const unsigned int length,
+                         arena_t* scratch);
+
 /**
  * @brief Given an array of data and a length, prints the array to the screen
  *
@@ -59,13 +107,12 @@ void print_array(const unsigned char* arr, const unsigned int length);
 /**
  * @brief Given an array of data and a length, returns the median value 
  *
- * This function calculates and returns the median of an array. The input array
- * is assumed to be sorted. That way the median is simply the element in the
- * middle. If the array lenght is an even number, the median is interpolated as
- * the average of the two elements in the middle, floored to the nearest
- * integer.
+ * This function calculates and returns the median of an array, in any order,
+ * from its histogram (see stats_histogram_median()). If the array lenght is an
+ * even number, the median is interpolated as the average of the two elements
+ * in the middle, floored to the nearest integer.
  *
- * @param arr DESCENDINGLY SORTED array for which to calculate the median
+ * @param arr The input array for which to calculate the median
  * @param length The length of the array 
  *
  * @return unsigned char representing the median of the array
@@ -77,6 +124,7 @@ unsigned char find_median(unsigned char* arr, const unsigned int length);
  *
  * This function calculates and returns the mean of an array. The mean is the
  * mathematical average, which is the sum of elements divided by their number.
+ * It is read from stats_summary(), so the sum does not overflow.
  *
  * @param arr The input array for which to calculate the mean
  * @param length The length of the array 
@@ -88,11 +136,10 @@ unsigned char find_mean(unsigned char* arr, const unsigned int length);
 /**
  * @brief Given an array of data and a length, returns the maximum
  *
- * This function calculates and returns the maximum value in an array. The
- * elements of the array are assumed to be sorted in a descending order. That
- * way the maximum is simply the first element of the array, index: 0.
+ * This function calculates and returns the maximum value in an array, in any
+ * order, from stats_summary().
  *
- * @param arr DESCENDINGLY SORTED array for which to calculate the maximum
+ * @param arr The input array for which to calculate the maximum
  * @param length The length of the array 
  *
  * @return unsigned char representing the maximum of the array
@@ -102,30 +149,46 @@ unsigned char find_maximum(unsigned char* arr, const unsigned int length);
 /**
  * @brief Given an array of data and a length, returns the minimum
  *
- * This function calculates and returns the minimum value in an array. The
- * elements of the array are assumed to be sorted in a descending order. That
- * way the minimum is just the last element of the array, index: length - 1.
- * 
+ * This function calculates and returns the minimum value in an array, in any
+ * order, from stats_summary().
  *
- * @param arr DESCENDINGLY SORTED array for which to calculate the minimum
+ * @param arr The input array for which to calculate the minimum
  * @param length The length of the array 
  *
  * @return unsigned char representing the minimum of the array
  */
 unsigned char find_minimum(unsigned char* arr, const unsigned int length);
 
+/**
+ * @brief Minimum, maximum, sum and count of an array in one pass
+ *
+ * On x86 HOST builds the array is read 32 or 64 bytes at a time with the SSE2
+ * or AVX2 minimum, maximum and sum of absolute differences instructions,
+ * following the memory module's tier (see memory_select_isa()). On MSP432 the
+ * Cortex-M4 DSP instructions take four samples at a time from word loads:
+ * USADA8 sums them, USUB8 and SEL keep the lane minimum and maximum. Unlike the
+ * find_* functions it reports errors by its return value and leaves errno
+ * alone.
+ *
+ * @param arr The input array, only read
+ * @param length The length of the array
+ * @param result receives the summary; for an empty array everything is 0
+ *
+ * @return 0 on success, -1 if the array is empty or a pointer is NULL
+ */
+int stats_summary(const uint8_t* arr, size_t length,
+                  struct stats_result* result);
+
 /**
  * @brief Given an array of data and a length, sorts the array from largest to
  * smallest
  *
  * This function sorts an array in  descending order, the zeroth Element should
  * be the largest value, and the last element (n-1) should be the smallest
- * value. Bubble sort algorithm is used. It's not the most efficient, but for
- * the purposes of this assignment (also saving space) it should suffice. The
- * array is sorted in-place, no extra space is used (well, only one unsigned
- * char for swapping).
- *  
- * 
+ * value. Short arrays are insertion sorted. Longer ones are counting sorted in
+ * O(n): one pass counts each of the 256 values, and the array is rewritten as
+ * a run of each value from 255 down. The array is sorted in-place; the counts
+ * take 1 KiB of stack per partial histogram (4 on HOST, 1 on MSP432).
  *
  * @param arr array to be sorted
  * @param length The length of the array 
@@ -134,4 +197,152 @@ unsigned char find_minimum(unsigned char* arr, const unsigned int length);
  */
 void sort_array(unsigned char* arr, const unsigned int length);
 
+/**
+ * @brief Sorts an array of 16-bit values from largest to smallest
+ *
+ * LSD radix sort, one pass per byte of the key, skipping passes in which all
+ * keys have the same byte. Below STATS_SORT_CUTOFF elements it is an
+ * insertion sort and scratch is not used.
+ *
+ * @param arr array to be sorted
+ * @param length number of elements
+ * @param scratch room for length elements, or NULL to take it from
+ * reserve_bytes() for the call
+ *
+ * @return This function does not return any value. errno is set to ENOMEM,
+ * and the array left as it was, if scratch could not be reserved.
+ */
+void sort_array_u16(uint16_t* arr, size_t length, uint16_t* scratch);
+
+/**
+ * @brief Sorts an array of 32-bit values from largest to smallest, see
+ * sort_array_u16()
+ */
+void sort_array_u32(uint32_t* arr, size_t length, uint32_t* scratch);
+
+/**
+ * @brief Finds the key at a rank of an array of 8, 16 or 32-bit keys
+ *
+ * Introselect: quickselect, falling back to a median of medians pivot when
+ * the input keeps producing lopsided partitions, so it is O(n) in the worst
+ * case as well as on average, with no need to sort. Ranks are positions in
+ * descending order, as sort_array() would leave the array: 0 is the maximum
+ * and length - 1 the minimum. Selecting reorders the keys, either arr itself
+ * or a copy in scratch, at the caller's choice.
+ *
+ * @param arr keys of width bytes each
+ * @param length number of keys
+ * @param width 1, 2 or 4
+ * @param k rank wanted, below length
+ * @param scratch room for length keys to select in, leaving arr untouched,
+ * or NULL to select in arr
+ * @param value receives the key
+ *
+ * @return 0 on success, -1 if arr or value is NULL, k is out of range or
+ * width is not supported
+ */
+int find_kth(void* arr, size_t length, size_t width, size_t k, void* scratch,
+             uint32_t* value);
+
+/**
+ * @brief Finds the median of an array of 8, 16 or 32-bit keys, see find_kth()
+ *
+ * Same definition as find_median(): for an even length, the average of the
+ * two middle keys, floored.
+ *
+ * @return 0 on success, -1 on the same errors as find_kth() or if the array
+ * is empty
+ */
+int find_median_select(void* arr, size_t length, size_t width, void* scratch,
+                       uint32_t* value);
+
+/**
+ * @brief Empties a histogram
+ *
+ * @param hist histogram to clear
+ */
+void stats_histogram_reset(stats_histogram_t* hist);
+
+/**
+ * @brief Counts more samples into a histogram
+ *
+ * Meant for streaming: a buffer can be counted chunk by chunk as it arrives,
+ * with the same result as counting it whole. Long chunks are counted into
+ * several partial histograms that are merged at the end (4 on HOST, 1 KiB of
+ * stack each), so runs of one value do not stall on a single counter.
+ *
+ * The counts are 32 bits, so a histogram holds at most UINT32_MAX samples.
+ * A chunk that would take it past that is refused whole.
+ *
+ * @param hist histogram to add to
+ * @param arr samples, only read
+ * @param length number of samples
+ *
+ * @return 0, or -1 with the histogram unchanged if it would overflow
+ */
+int stats_histogram_add(stats_histogram_t* hist, const unsigned char* arr,
+                        size_t length);
+
+/**
+ * @brief Resets a histogram and counts a buffer into it
+ *
+ * @return 0, or -1 with the histogram left empty if the buffer holds more
+ * than UINT32_MAX samples
+ */
+int stats_histogram_build(stats_histogram_t* hist, const unsigned char* arr,
+                          size_t length);
+
+/**
+ * @brief Statistics of the samples counted in a histogram
+ *
+ * The median of an even number of samples is the floored average of the two
+ * in the middle, the mean is floored too, and the mode is the smallest of the
+ * most frequent values. For an empty histogram they set errno to EINVAL and
+ * return 0.
+ */
+unsigned char stats_histogram_minimum(const stats_histogram_t* hist);
+unsigned char stats_histogram_maximum(const stats_histogram_t* hist);
+unsigned char stats_histogram_mean(const stats_histogram_t* hist);
+unsigned char stats_histogram_median(const stats_histogram_t* hist);
+unsigned char stats_histogram_mode(const stats_histogram_t* hist);
+
+/**
+ * @brief Returns a percentile of the samples counted in a histogram
+ *
+ * Nearest rank: the smallest sample with at least percent of the samples at
+ * or below it. 0 gives the minimum, 50 the lower median and 100 the maximum.
+ *
+ * @param hist histogram to read
+ * @param percent 0 to 100
+ *
+ * @return the percentile, or 0 with errno set to EINVAL if the histogram is
+ * empty or percent is over 100
+ */
+unsigned char stats_histogram_percentile(const stats_histogram_t* hist,
+                                         unsigned int percent);
+
+/**
+ * @brief Prints the statistics of a span, see print_statistics_ex()
+ *
+ * A span longer than UINT_MAX bytes, which print_statistics_ex() cannot
+ * count, only prints an error.
+ *
+ * @param samples The input span for which to calculate and print stats
+ * @param scratch Arena for the histogram, or NULL
+ *
+ * @return This function does not return any value
+ */
+void print_statistics_span(byte_span_t samples, arena_t* scratch);
+
+/**
+ * @brief Span forms of print_array(), find_mean() and sort_array()
+ *
+ * find_mean_span() takes spans of any length. print_array_span() only prints
+ * an error for spans longer than UINT_MAX bytes, and sort_array_span()
+ * returns -1 for them, leaving the span as it was, and 0 once sorted.
+ */
+void print_array_span(byte_span_t samples);
+unsigned char find_mean_span(byte_span_t samples);
+int sort_array_span(byte_span_t samples);
+
 #endif /* __STATS_H__ */
@@ -0,0 +1,148 @@
+/******************************************************************************
+ * Copyright (C) 2024 by Hatem Alamir
+ *
+ * Redistribution, modification or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of embedded
+ * software. Hatem Alamir is not liable for any misuse of this material.
+ *
+ *****************************************************************************/
+/**
+ * @file tlsf.h
+ * @brief Two-Level Segregated Fit allocator
+ *
+ * TLSF (Masmano et al., 2004) keeps free blocks in lists indexed by a first
+ * level (power of two of the size) and a second level (linear subdivision of
+ * that power of two). Two bitmaps locate a non-empty list with find-first-set
+ * instructions, so allocation and release run in constant time regardless of
+ * heap state, and freed blocks are merged with their physical neighbours
+ * immediately. The allocator manages one caller-provided region and does no
+ * locking of its own.
+ *
+ * @author Hatem Alamir
+ * @date December 14 2024
+ *
+ */
+#ifndef __TLSF_H__
+#define __TLSF_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+/** Second level subdivisions per power of two, as a log2 */
+#define TLSF_SL_SHIFT   (4)
+#define TLSF_SL_COUNT   (1U << TLSF_SL_SHIFT)
+/** Payload alignment; also the size of a block header */
+#define TLSF_ALIGN      (2 * sizeof(void*))
+/** Blocks below 2^TLSF_FL_SHIFT all share first level 0 */
+#if defined (MSP432)
+#define TLSF_FL_SHIFT   (TLSF_SL_SHIFT + 3)
+#define TLSF_FL_MAX     (17)
+#else
+#define TLSF_FL_SHIFT   (TLSF_SL_SHIFT + 4)
+#define TLSF_FL_MAX     (32)
+#endif
+#define TLSF_FL_COUNT   (TLSF_FL_MAX - TLSF_FL_SHIFT + 1)
+
+struct tlsf_block;
+
+/**
+ * Allocator state. It is kept apart from the managed region so one region can
+ * be handed over whole, as with the linker heap section.
+ */
+typedef struct tlsf {
+    uint32_t fl_bitmap;
+    uint32_t sl_bitmap[TLSF_FL_COUNT];
+    struct tlsf_block* free_lists[TLSF_FL_COUNT][TLSF_SL_COUNT];
+    uint8_t* start;
+    uint8_t* end;
+} tlsf_t;
+
+/**
+ * Snapshot of a TLSF heap, see tlsf_stats()
+ */
+struct tlsf_stats {
+    size_t used_bytes;     /* payload bytes in allocated blocks */
+    size_t free_bytes;     /* payload bytes in free blocks */
+    size_t largest_free;   /* payload of the largest free block */
+    size_t used_blocks;
+    size_t free_blocks;
+};
+
+/**
+ * @brief Sets up an allocator over a memory region
+ *
+ * The region is trimmed to TLSF_ALIGN and to the largest block the first
+ * level index can describe.
+ *
+ * @param tlsf allocator state to initialize
+ * @param mem start of the region
+ * @param bytes size of the region
+ *
+ * @return 0 on success, -1 if the region is too small to hold one block
+ */
+int tlsf_init(tlsf_t* tlsf, void* mem, size_t bytes);
+
+/**
+ * @brief Allocates a block of at least the requested size
+ *
+ * @param tlsf allocator state
+ * @param bytes number of bytes needed
+ *
+ * @return pointer aligned to TLSF_ALIGN, or NULL if no free block is large
+ * enough
+ */
+void* tlsf_malloc(tlsf_t* tlsf, size_t bytes);
+
+/**
+ * @brief Allocates a block whose payload starts on a given boundary
+ *
+ * The space skipped to reach the boundary is given back as a free block, so
+ * only the search asks for the extra room. Release with tlsf_free().
+ *
+ * @param tlsf allocator state
+ * @param align power of two alignment; up to TLSF_ALIGN this is tlsf_malloc()
+ * @param bytes number of bytes needed
+ *
+ * @return pointer aligned to align, or NULL if no free block is large enough
+ */
+void* tlsf_memalign(tlsf_t* tlsf, size_t align, size_t bytes);
+
+/**
+ * @brief Releases a block and merges it with free neighbours
+ *
+ * @param tlsf allocator state
+ * @param ptr block obtained from tlsf_malloc() on the same allocator, or NULL
+ */
+void tlsf_free(tlsf_t* tlsf, void* ptr);
+
+/**
+ * @brief Tells whether a pointer lies in the region managed by an allocator
+ *
+ * @param tlsf allocator state
+ * @param ptr any pointer
+ *
+ * @return 1 if ptr is inside the region, 0 otherwise
+ */
+int tlsf_owns(const tlsf_t* tlsf, const void* ptr);
+
+/**
+ * @brief Returns the usable size of an allocated block
+ *
+ * @param ptr block obtained from tlsf_malloc()
+ *
+ * @return payload size in bytes, at least what was requested
+ */
+size_t tlsf_block_size(const void* ptr);
+
+/**
+ * @brief Walks the heap and reports usage and fragmentation
+ *
+ * This is O(number of blocks) and meant for diagnostics and benchmarks.
+ *
+ * @param tlsf allocator state
+ * @param stats filled with the totals
+ */
+void tlsf_stats(const tlsf_t* tlsf, struct tlsf_stats* stats);
+
+#endif /* __TLSF_H__ */
@@ -13,10 +13,15 @@
 #*****************************************************************************
 
 # Add your Source files to this variable
-SOURCES = src/course1.c \
+SOURCES = src/arena.c \
+		  src/checksum.c \
+		  src/compress.c \
+		  src/course1.c \
 		  src/data.c \
 		  src/main.c \
 		  src/memory.c \
+		  src/mem_pool.c \
+		  src/tlsf.c \
 		  src/stats.c
 # Add your include paths to this variable
 INCLUDES = -Iinclude/common
@@ -29,3 +34,8 @@ ifeq ($(PLATFORM),MSP432)
 	INCLUDES += -Iinclude/msp432 -Iinclude/CMSIS
 endif
 
+
+# Benchmark driver, HOST only
+ifeq ($(BENCH),1)
+	SOURCES += src/bench.c
+endif
@@ -0,0 +1,73 @@
+/******************************************************************************
+ * Copyright (C) 2024 by Hatem Alamir
+ *
+ * Redistribution, modification or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are 
+ * permitted to modify this and use it to learn about the field of embedded
+ * software. Hatem Alamir is not liable for any misuse of this material.
+ *
+ *****************************************************************************/
+/**
+ * @file arena.c
+ * @brief Bump allocator for short-lived scratch memory
+ *
+ * @author Hatem Alamir
+ * @date December 16 2024
+ *
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include "arena.h"
+#include "memory.h"
+
+void arena_init(arena_t* arena, void* block, size_t size) {
+    arena->base = (uint8_t*)block;
+    arena->size = block ? size : 0;
+    arena->offset = 0;
+    arena->owned = 0;
+}
+
+int arena_create(arena_t* arena, size_t size) {
+    arena_init(arena, reserve_bytes(size), size);
+    arena->owned = arena->base != NULL;
+    return arena->owned ? 0 : -1;
+}
+
+void arena_destroy(arena_t* arena) {
+    if(arena->owned)
+        free_bytes(arena->base);
+    arena_init(arena, NULL, 0);
+}
+
+void* arena_alloc(arena_t* arena, size_t bytes, size_t align) {
+    if(align == 0)
+        align = ARENA_DEFAULT_ALIGN;
+    /* Align the address rather than the offset; the block itself may not be
+     * aligned as strictly as the request. */
+    uintptr_t at = (uintptr_t)(arena->base + arena->offset);
+    size_t pad = (size_t)(((at + align - 1) & ~(uintptr_t)(align - 1)) - at);
+    if(pad > arena->size - arena->offset ||
+       bytes > arena->size - arena->offset - pad)
+        return NULL;
+    void* chunk = arena->base + arena->offset + pad;
+    arena->offset += pad + bytes;
+    return chunk;
+}
+
+arena_mark_t arena_mark(const arena_t* arena) {
+    return arena->offset;
+}
+
+void arena_rewind(arena_t* arena, arena_mark_t mark) {
+    if(mark <= arena->offset)
+        arena->offset = mark;
+}
+
+void arena_reset(arena_t* arena) {
+    arena->offset = 0;
+}
+
+size_t arena_remaining(const arena_t* arena) {
+    return arena->size - arena->offset;
+}
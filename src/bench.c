@@ -0,0 +1,1764 @@
+/******************************************************************************
+ * Copyright (C) 2024 by Hatem Alamir
+ *
+ * Redistribution, modification or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are 
+ * permitted to modify this and use it to learn about the field of embedded
+ * software. Hatem Alamir is not liable for any misuse of this material.
+ *
+ *****************************************************************************/
+/**
+ * @file bench.c
+ * @brief Throughput benchmarks for the HOST build
+ *
+ * Each benchmark repeats an operation until enough bytes have been processed
+ * for a stable reading, and prints the throughput next to the C library
+ * equivalent where there is one.
+ *
+ * @author Hatem Alamir
+ * @date December 8 2024
+ *
+ */
+#define _GNU_SOURCE
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "bench.h"
+#include "memory.h"
+#include "checksum.h"
+#include "compress.h"
+#include "mem_pool.h"
+#include "tlsf.h"
+#include "stats.h"
+#include "platform.h"
+
+/* Bytes processed per measurement, so small sizes are repeated enough times */
+#define BENCH_BYTES_PER_RUN (1UL << 30)
+#define BENCH_MIN_SIZE_B    (16UL)
+#define BENCH_MAX_SIZE_B    (64UL << 20)
+/* Offset between source and destination for the overlapping moves */
+#define BENCH_OVERLAP_B     (40UL)
+
+/* Buffer filled between the stats passes, larger than any last level cache we
+ * run on, and the working set read by the stats passes */
+#define BENCH_FILL_SIZE_B   (192UL << 20)
+#define BENCH_STATS_SIZE_B  (16UL << 20)
+
+/* Live blocks per batch and batches per measurement of the allocator bench */
+#define BENCH_ALLOC_BATCH   (1024)
+#define BENCH_ALLOC_ROUNDS  (2000)
+
+/* Randomized alloc/free churn: live slots, operations and heap region */
+#define BENCH_CHURN_SLOTS   (4096)
+#define BENCH_CHURN_OPS     (2000000)
+#define BENCH_CHURN_HEAP_B  (64UL << 20)
+#define BENCH_CHURN_MAX_B   (16UL << 10)
+/* bench_reverse(): 2 B to 16 MiB, doubling */
+#define BENCH_REVERSE_MIN_B (2UL)
+#define BENCH_REVERSE_MAX_B (16UL << 20)
+#define BENCH_REVERSE_BYTES (128UL << 20)
+/* bench_search(): hits 1/16 of the way in (early) or at the far end (late) */
+#define BENCH_SEARCH_BYTES  (256UL << 20)
+#define BENCH_SEARCH_MAX_B  (1UL << 20)
+#define BENCH_NEEDLE_B      (8)
+/* bench_reserve_threads(): per-thread churn, up to max(CPUs, 4) threads */
+#define BENCH_STRIDED_BYTES (256UL << 20)
+#define BENCH_STRIDED_MIN_B (64UL << 10)
+#define BENCH_STRIDED_MAX_B (64UL << 20)
+
+#define BENCH_TRANSPOSE_MIN (256UL)
+#define BENCH_TRANSPOSE_MAX (8192UL)
+#define BENCH_TRANSPOSE_BYTES (512UL << 20)
+
+#define BENCH_COPYV_COUNT   (1UL << 20)
+#define BENCH_COPYV_MIN_B   (8)
+#define BENCH_COPYV_MAX_B   (64)
+#define BENCH_COPYV_HOT_B   (256UL << 10)
+#define BENCH_COPYV_COLD_B  (64UL << 20)
+#define BENCH_COPYV_FRAME   (4096)
+#define BENCH_COPYV_ROUNDS  (8)
+
+#define BENCH_PATTERN_BYTES (512UL << 20)
+#define BENCH_PATTERN_MAX_B (16UL << 20)
+
+#define BENCH_CHECKSUM_BYTES (256UL << 20)
+#define BENCH_CHECKSUM_MAX_B (16UL << 20)
+
+/* bench_compress(): bytes decoded per measurement and size of each dataset */
+#define BENCH_COMPRESS_BYTES (256UL << 20)
+#define BENCH_COMPRESS_SIZE_B (16UL << 20)
+
+/* bench_sort(): 8 to 100M elements, at least this many sorted per
+ * measurement, and the largest size the quadratic reference is run at */
+#define BENCH_SORT_MIN      (8UL)
+#define BENCH_SORT_MAX      (100000000UL)
+#define BENCH_SORT_ELEMS    (16UL << 20)
+#define BENCH_BUBBLE_MAX    (32768UL)
+
+/* bench_stats(): smallest and largest buffer, and samples per measurement */
+#define BENCH_STATS_MIN_B   (4UL << 10)
+#define BENCH_STATS_MAX_B   (16UL << 20)
+#define BENCH_STATS_ELEMS   (64UL << 20)
+
+/* bench_select(): smallest and largest number of keys */
+#define BENCH_SELECT_MIN    (1000UL)
+#define BENCH_SELECT_MAX    (16384000UL)
+
+/* bench_summary(): buffer sizes, from L1 to DRAM */
+#define BENCH_SUMMARY_MIN_B (16UL << 10)
+#define BENCH_SUMMARY_MAX_B (32UL << 20)
+
+/* bench_huge_pages(): buffer size and random reads per pass */
+#define BENCH_HUGE_SIZE_B   (512UL << 20)
+#define BENCH_HUGE_READS    (16UL << 20)
+
+#define BENCH_THREAD_SLOTS  (256)
+#define BENCH_THREAD_OPS    (1000000)
+#define BENCH_THREAD_MAX_B  (256)
+#define BENCH_THREADS_MIN   (4)
+#define BENCH_THREADS_MAX   (64)
+
+/* Keeps the compiler from dropping the benchmarked calls */
+static volatile uint8_t bench_sink;
+
+/**
+ * @brief Returns a monotonic timestamp in nanoseconds
+ */
+static uint64_t bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief Converts a byte count moved in a number of nanoseconds to GB/s
+ */
+static double bench_gbps(uint64_t bytes, uint64_t ns) {
+    return ns ? (double)bytes / (double)ns : 0.0;
+}
+
+static size_t bench_reps(size_t size) {
+    size_t reps = BENCH_BYTES_PER_RUN / size;
+    return reps ? reps : 1;
+}
+
+typedef void* (*libc_move_fn)(void*, const void*, size_t);
+
+static double bench_libc_move(libc_move_fn fn, uint8_t* src, uint8_t* dst,
+                              size_t size) {
+    size_t reps = bench_reps(size);
+    uint64_t start = bench_now_ns();
+    for(size_t r = 0; r < reps; r++) {
+        fn(dst, src, size);
+        bench_sink = dst[r % size];
+    }
+    return bench_gbps((uint64_t)reps * size, bench_now_ns() - start);
+}
+
+static double bench_my_move(uint8_t* src, uint8_t* dst, size_t size) {
+    size_t reps = bench_reps(size);
+    uint64_t start = bench_now_ns();
+    for(size_t r = 0; r < reps; r++) {
+        my_memmove(src, dst, size);
+        bench_sink = dst[r % size];
+    }
+    return bench_gbps((uint64_t)reps * size, bench_now_ns() - start);
+}
+
+void bench_memmove(void) {
+    uint8_t* src = malloc(BENCH_MAX_SIZE_B + BENCH_OVERLAP_B);
+    uint8_t* dst = malloc(BENCH_MAX_SIZE_B + BENCH_OVERLAP_B);
+    if(!src || !dst) {
+        PRINTF("bench_memmove: out of memory\n");
+        free(src);
+        free(dst);
+        return;
+    }
+    memset(src, 0x5A, BENCH_MAX_SIZE_B + BENCH_OVERLAP_B);
+    memset(dst, 0xA5, BENCH_MAX_SIZE_B + BENCH_OVERLAP_B);
+
+    PRINTF("\nbench_memmove() - GB/s, %s kernels\n",
+           memory_isa_name(memory_active_isa()));
+    PRINTF("%10s | %9s %9s | %9s %9s | %9s %9s\n", "bytes",
+           "disjoint", "libc", "fwd-ovl", "libc", "bwd-ovl", "libc");
+    for(size_t size = BENCH_MIN_SIZE_B; size <= BENCH_MAX_SIZE_B; size *= 4) {
+        PRINTF("%10zu | %9.2f %9.2f | %9.2f %9.2f | %9.2f %9.2f\n", size,
+               bench_my_move(src, dst, size),
+               bench_libc_move(memmove, src, dst, size),
+               bench_my_move(src + BENCH_OVERLAP_B, src, size),
+               bench_libc_move(memmove, src + BENCH_OVERLAP_B, src, size),
+               bench_my_move(src, src + BENCH_OVERLAP_B, size),
+               bench_libc_move(memmove, src, src + BENCH_OVERLAP_B, size));
+    }
+
+    free(src);
+    free(dst);
+}
+
+enum bench_op { BENCH_COPY, BENCH_MOVE, BENCH_SET, BENCH_REVERSE };
+
+static double bench_op(enum bench_op op, uint8_t* buf, size_t size) {
+    size_t reps = bench_reps(size);
+    uint64_t start = bench_now_ns();
+    for(size_t r = 0; r < reps; r++) {
+        switch(op) {
+        case BENCH_COPY:
+            my_memcopy(buf, buf + size + BENCH_OVERLAP_B, size);
+            break;
+        case BENCH_MOVE:
+            my_memmove(buf, buf + BENCH_OVERLAP_B, size);
+            break;
+        case BENCH_SET:
+            my_memset(buf, size, (uint8_t)r);
+            break;
+        case BENCH_REVERSE:
+            my_reverse(buf, size);
+            break;
+        }
+        bench_sink = buf[r % size];
+    }
+    return bench_gbps((uint64_t)reps * size, bench_now_ns() - start);
+}
+
+void bench_memory_isa(void) {
+    static const size_t sizes[] = { 16UL << 10, 512UL << 10, 32UL << 20 };
+    size_t max = sizes[sizeof(sizes) / sizeof(sizes[0]) - 1];
+    uint8_t* buf = malloc(2 * (max + BENCH_OVERLAP_B));
+    memory_isa_t saved = memory_active_isa();
+    if(!buf) {
+        PRINTF("bench_memory_isa: out of memory\n");
+        return;
+    }
+    memset(buf, 0x5A, 2 * (max + BENCH_OVERLAP_B));
+
+    PRINTF("\nbench_memory_isa() - GB/s\n");
+    PRINTF("%7s %10s | %9s %9s %9s %9s\n", "isa", "bytes",
+           "memcopy", "memmove", "memset", "reverse");
+    for(memory_isa_t isa = MEMORY_ISA_SCALAR; isa <= memory_best_isa(); isa++) {
+        memory_select_isa(isa);
+        for(size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+            PRINTF("%7s %10zu | %9.2f %9.2f %9.2f %9.2f\n",
+                   memory_isa_name(isa), sizes[i],
+                   bench_op(BENCH_COPY, buf, sizes[i]),
+                   bench_op(BENCH_MOVE, buf, sizes[i]),
+                   bench_op(BENCH_SET, buf, sizes[i]),
+                   bench_op(BENCH_REVERSE, buf, sizes[i]));
+        }
+    }
+    memory_select_isa(saved);
+    free(buf);
+}
+
+/**
+ * @brief The byte-pair loop my_reverse used to run, kept as the baseline. It
+ * is not vectorized, so it measures that loop and not the compiler.
+ */
+__attribute__((noinline, optimize("no-tree-vectorize")))
+static void bench_reverse_bytes(uint8_t* src, size_t length) {
+    uint8_t* tail = src + length;
+    while(tail - src > 1) {
+        uint8_t temp = *src;
+        *src++ = *--tail;
+        *tail = temp;
+    }
+}
+
+static double bench_reverse_run(int baseline, uint8_t* buf, size_t size) {
+    size_t reps = BENCH_REVERSE_BYTES / size;
+    uint64_t start = bench_now_ns();
+    for(size_t r = 0; r < reps; r++) {
+        if(baseline)
+            bench_reverse_bytes(buf, size);
+        else
+            my_reverse(buf, size);
+        bench_sink = buf[r % size];
+    }
+    return bench_gbps((uint64_t)reps * size, bench_now_ns() - start);
+}
+
+void bench_reverse(void) {
+    uint8_t* buf = malloc(BENCH_REVERSE_MAX_B);
+    memory_isa_t saved = memory_active_isa();
+    if(!buf) {
+        PRINTF("bench_reverse: out of memory\n");
+        return;
+    }
+    memset(buf, 0x5A, BENCH_REVERSE_MAX_B);
+
+    PRINTF("\nbench_reverse() - GB/s\n");
+    PRINTF("%10s | %9s", "bytes", "byte loop");
+    for(memory_isa_t isa = MEMORY_ISA_SCALAR; isa <= memory_best_isa(); isa++)
+        PRINTF(" %9s", memory_isa_name(isa));
+    PRINTF("\n");
+    for(size_t size = BENCH_REVERSE_MIN_B; size <= BENCH_REVERSE_MAX_B;
+        size *= 2) {
+        PRINTF("%10zu | %9.2f", size, bench_reverse_run(1, buf, size));
+        for(memory_isa_t isa = MEMORY_ISA_SCALAR; isa <= memory_best_isa();
+            isa++) {
+            memory_select_isa(isa);
+            PRINTF(" %9.2f", bench_reverse_run(0, buf, size));
+        }
+        PRINTF("\n");
+    }
+    memory_select_isa(saved);
+    free(buf);
+}
+
+enum bench_search_op { BENCH_MEMCHR, BENCH_MEMRCHR, BENCH_MEMCMP, BENCH_MEMMEM };
+
+static const char* const bench_search_names[] = {
+    "memchr", "memrchr", "memcmp", "memmem"
+};
+
+/**
+ * @brief Times one search over size bytes; returns nanoseconds per call
+ */
+static double bench_search_run(enum bench_search_op op, int libc,
+                               const uint8_t* buf, const uint8_t* ref,
+                               size_t size, const uint8_t* needle) {
+    size_t reps = BENCH_SEARCH_BYTES / size;
+    const void* found = NULL;
+    uint64_t start = bench_now_ns();
+    for(size_t r = 0; r < reps; r++) {
+        switch(op) {
+        case BENCH_MEMCHR:
+            found = libc ? memchr(buf, 0xFF, size)
+                         : my_memchr(buf, 0xFF, size);
+            break;
+        case BENCH_MEMRCHR:
+            found = libc ? memrchr(buf, 0xFF, size)
+                         : my_memrchr(buf, 0xFF, size);
+            break;
+        case BENCH_MEMCMP:
+            found = buf + (libc ? memcmp(buf, ref, size)
+                                : my_memcmp(buf, ref, size));
+            break;
+        case BENCH_MEMMEM:
+            found = libc ? memmem(buf, size, needle, BENCH_NEEDLE_B)
+                         : my_memmem(buf, size, needle, BENCH_NEEDLE_B);
+            break;
+        }
+        bench_sink = (uint8_t)(uintptr_t)found;
+    }
+    return (double)(bench_now_ns() - start) / (double)reps;
+}
+
+/**
+ * @brief Resets buf and ref to the background, then plants what op looks for
+ * at byte hit (or the mirrored byte for memrchr)
+ */
+static void bench_search_plant(enum bench_search_op op, uint8_t* buf,
+                               uint8_t* ref, size_t size, size_t hit,
+                               const uint8_t* needle) {
+    for(size_t i = 0; i < size; i++)
+        buf[i] = ref[i] = (uint8_t)((i * 13 + 5) % 0xF0);
+    switch(op) {
+    case BENCH_MEMCHR:
+        buf[hit] = 0xFF;
+        break;
+    case BENCH_MEMRCHR:
+        buf[size - 1 - hit] = 0xFF;
+        break;
+    case BENCH_MEMCMP:
+        ref[hit] = 0xFF;
+        break;
+    case BENCH_MEMMEM:
+        memcpy(buf + hit, needle, BENCH_NEEDLE_B);
+        break;
+    }
+}
+
+void bench_search(void) {
+    uint8_t* buf = malloc(BENCH_SEARCH_MAX_B);
+    uint8_t* ref = malloc(BENCH_SEARCH_MAX_B);
+    const uint8_t needle[BENCH_NEEDLE_B] = {
+        0xF5, 0x5A, 0xA5, 0x3C, 0xC3, 0x0F, 0xF0, 0xF5
+    };
+    if(!buf || !ref) {
+        PRINTF("bench_search: out of memory\n");
+        free(buf);
+        free(ref);
+        return;
+    }
+
+    PRINTF("\nbench_search() - ns per call, %s kernels, hit 1/16 in (early) "
+           "or at the end (late)\n", memory_isa_name(memory_active_isa()));
+    PRINTF("%10s %8s | %9s %9s | %9s %9s\n", "bytes", "function",
+           "early", "libc", "late", "libc");
+    for(size_t size = 16; size <= BENCH_SEARCH_MAX_B; size *= 16) {
+        for(int op = BENCH_MEMCHR; op <= BENCH_MEMMEM; op++) {
+            size_t late = op == BENCH_MEMMEM ? size - BENCH_NEEDLE_B : size - 1;
+            double t[4];
+            bench_search_plant(op, buf, ref, size, size / 16, needle);
+            t[0] = bench_search_run(op, 0, buf, ref, size, needle);
+            t[1] = bench_search_run(op, 1, buf, ref, size, needle);
+            bench_search_plant(op, buf, ref, size, late, needle);
+            t[2] = bench_search_run(op, 0, buf, ref, size, needle);
+            t[3] = bench_search_run(op, 1, buf, ref, size, needle);
+            PRINTF("%10zu %8s | %9.1f %9.1f | %9.1f %9.1f\n", size,
+                   bench_search_names[op], t[0], t[1], t[2], t[3]);
+        }
+    }
+    free(buf);
+    free(ref);
+}
+
+/**
+ * @brief The one call per byte that de-interleaving took before get_strided,
+ * gather and their inverses. stride 0 means gather through idx.
+ */
+__attribute__((noinline))
+static void bench_strided_bytes(int merge, char* data, size_t stride,
+                                const unsigned int* idx, char* chan,
+                                size_t count) {
+    for(size_t i = 0; i < count; i++) {
+        unsigned int at = stride ? (unsigned int)(i * stride) : idx[i];
+        if(merge)
+            set_value(data, at, chan[i]);
+        else
+            chan[i] = get_value(data, at);
+    }
+}
+
+/**
+ * @brief Splits size bytes of interleaved data into its channels, or merges
+ * them back, until BENCH_STRIDED_BYTES have gone through
+ */
+static double bench_strided_run(int baseline, int merge, char* data,
+                                size_t size, size_t stride,
+                                const unsigned int* idx, char* chans) {
+    size_t count = size / (stride ? stride : 1);
+    size_t reps = BENCH_STRIDED_BYTES / size;
+    uint64_t start = bench_now_ns();
+    for(size_t r = 0; r < reps; r++) {
+        for(size_t c = 0; c < (stride ? stride : 1); c++) {
+            char* chan = chans + c * count;
+            if(baseline)
+                bench_strided_bytes(merge, data + c, stride, idx, chan, count);
+            else if(!stride && merge)
+                scatter(data, idx, chan, count);
+            else if(!stride)
+                gather(data, idx, chan, count);
+            else if(merge)
+                set_strided(data + c, stride, chan, count);
+            else
+                get_strided(data + c, stride, chan, count);
+        }
+        bench_sink = (uint8_t)chans[r % size];
+    }
+    return bench_gbps((uint64_t)reps * size, bench_now_ns() - start);
+}
+
+void bench_strided(void) {
+    static const size_t strides[] = { 2, 3, 4, 8, 0 };
+    char* data = malloc(BENCH_STRIDED_MAX_B);
+    char* chans = malloc(BENCH_STRIDED_MAX_B);
+    unsigned int* idx = malloc(BENCH_STRIDED_MAX_B * sizeof(*idx));
+    memory_isa_t saved = memory_active_isa();
+    if(!data || !chans || !idx) {
+        PRINTF("bench_strided: out of memory\n");
+        free(data);
+        free(chans);
+        free(idx);
+        return;
+    }
+    memset(data, 0x5A, BENCH_STRIDED_MAX_B);
+    memset(chans, 0xA5, BENCH_STRIDED_MAX_B);
+    srand(1);
+
+    PRINTF("\nbench_strided() - GB/s of interleaved data\n");
+    PRINTF("%5s %10s %6s | %9s", "op", "bytes", "stride", "per byte");
+    for(memory_isa_t isa = MEMORY_ISA_SCALAR; isa <= memory_best_isa(); isa++)
+        PRINTF(" %9s", memory_isa_name(isa));
+    PRINTF("\n");
+    for(size_t size = BENCH_STRIDED_MIN_B; size <= BENCH_STRIDED_MAX_B;
+        size *= BENCH_STRIDED_MAX_B / BENCH_STRIDED_MIN_B) {
+        for(size_t i = 0; i < size; i++)
+            idx[i] = (unsigned int)((size_t)rand() % size);
+        for(size_t s = 0; s < sizeof(strides) / sizeof(strides[0]); s++) {
+            for(int merge = 0; merge < 2; merge++) {
+                const char* op = strides[s] ? (merge ? "merge" : "split")
+                                            : (merge ? "scatr" : "gathr");
+                PRINTF("%5s %10zu %6zu | %9.2f", op, size, strides[s],
+                       bench_strided_run(1, merge, data, size, strides[s], idx,
+                                         chans));
+                /* gather and scatter are not dispatched */
+                for(memory_isa_t isa = MEMORY_ISA_SCALAR;
+                    isa <= (strides[s] ? memory_best_isa() : MEMORY_ISA_SCALAR);
+                    isa++) {
+                    memory_select_isa(isa);
+                    PRINTF(" %9.2f", bench_strided_run(0, merge, data, size,
+                                                       strides[s], idx, chans));
+                }
+                PRINTF("\n");
+            }
+        }
+    }
+    memory_select_isa(saved);
+    free(data);
+    free(chans);
+    free(idx);
+}
+
+/**
+ * @brief Element by element transpose, the baseline for my_transpose_u8
+ */
+__attribute__((noinline))
+static void bench_transpose_naive(const uint8_t* src, uint8_t* dst, size_t n) {
+    for(size_t r = 0; r < n; r++)
+        for(size_t c = 0; c < n; c++)
+            dst[c * n + r] = src[r * n + c];
+}
+
+static double bench_transpose_run(int baseline, uint8_t* src, uint8_t* dst,
+                                  size_t n) {
+    size_t reps = BENCH_TRANSPOSE_BYTES / (n * n);
+    uint64_t start = bench_now_ns();
+    for(size_t r = 0; r < (reps ? reps : 1); r++) {
+        if(baseline)
+            bench_transpose_naive(src, dst, n);
+        else
+            my_transpose_u8(src, n, dst, n, n, n);
+        bench_sink = dst[r % (n * n)];
+    }
+    return bench_gbps((uint64_t)(reps ? reps : 1) * n * n,
+                      bench_now_ns() - start);
+}
+
+void bench_transpose(void) {
+    size_t bytes = BENCH_TRANSPOSE_MAX * BENCH_TRANSPOSE_MAX;
+    uint8_t* src = malloc(bytes);
+    uint8_t* dst = malloc(bytes);
+    memory_isa_t saved = memory_active_isa();
+    if(!src || !dst) {
+        PRINTF("bench_transpose: out of memory\n");
+        free(src);
+        free(dst);
+        return;
+    }
+    for(size_t i = 0; i < bytes; i++)
+        src[i] = (uint8_t)(i * 7);
+    memset(dst, 0, bytes);
+
+    PRINTF("\nbench_transpose() - GB/s of square byte matrices\n");
+    PRINTF("%6s %10s | %9s", "rows", "bytes", "naive");
+    for(memory_isa_t isa = MEMORY_ISA_SCALAR; isa <= memory_best_isa(); isa++)
+        PRINTF(" %9s", memory_isa_name(isa));
+    PRINTF("\n");
+    for(size_t n = BENCH_TRANSPOSE_MIN; n <= BENCH_TRANSPOSE_MAX; n *= 2) {
+        PRINTF("%6zu %10zu | %9.2f", n, n * n,
+               bench_transpose_run(1, src, dst, n));
+        for(memory_isa_t isa = MEMORY_ISA_SCALAR; isa <= memory_best_isa();
+            isa++) {
+            memory_select_isa(isa);
+            PRINTF(" %9.2f", bench_transpose_run(0, src, dst, n));
+        }
+        PRINTF("\n");
+    }
+    memory_select_isa(saved);
+    free(src);
+    free(dst);
+}
+
+enum bench_copyv_op { BENCH_COPYV_MY, BENCH_COPYV_LIBC, BENCH_COPYV_BATCH };
+
+/**
+ * @brief Average ns per copy of frames of copies done one call at a time or
+ * one my_memcopy_v() call per frame
+ */
+static double bench_copyv_run(enum bench_copyv_op op,
+                              const struct copy_desc* descs, size_t count) {
+    uint64_t start = bench_now_ns();
+    for(int round = 0; round < BENCH_COPYV_ROUNDS; round++) {
+        for(size_t f = 0; f < count; f += BENCH_COPYV_FRAME) {
+            const struct copy_desc* frame = descs + f;
+            if(op == BENCH_COPYV_BATCH) {
+                my_memcopy_v(frame, BENCH_COPYV_FRAME);
+                continue;
+            }
+            for(size_t i = 0; i < BENCH_COPYV_FRAME; i++) {
+                if(op == BENCH_COPYV_MY)
+                    my_memcopy((uint8_t*)frame[i].src, frame[i].dst,
+                               frame[i].length);
+                else
+                    memcpy(frame[i].dst, frame[i].src, frame[i].length);
+            }
+        }
+        bench_sink = descs[round].dst[0];
+    }
+    return (double)(bench_now_ns() - start) /
+           (double)(BENCH_COPYV_ROUNDS * count);
+}
+
+void bench_memcopy_v(void) {
+    struct copy_desc* descs = malloc(BENCH_COPYV_COUNT * sizeof(*descs));
+    uint8_t* src = malloc(BENCH_COPYV_COLD_B);
+    uint8_t* dst = malloc(BENCH_COPYV_FRAME * BENCH_COPYV_MAX_B);
+    memory_isa_t saved = memory_active_isa();
+    if(!descs || !src || !dst) {
+        PRINTF("bench_memcopy_v: out of memory\n");
+        free(descs);
+        free(src);
+        free(dst);
+        return;
+    }
+    memset(src, 0x5A, BENCH_COPYV_COLD_B);
+    memset(dst, 0, BENCH_COPYV_FRAME * BENCH_COPYV_MAX_B);
+    srand(1);
+
+    PRINTF("\nbench_memcopy_v() - ns per copy of %lu copies of %d to %d "
+           "bytes in frames of %d\n", BENCH_COPYV_COUNT, BENCH_COPYV_MIN_B,
+           BENCH_COPYV_MAX_B, BENCH_COPYV_FRAME);
+    PRINTF("%10s %7s | %10s %10s %10s\n", "sources", "isa", "my_memcopy",
+           "memcpy", "batched");
+    for(size_t span = BENCH_COPYV_HOT_B; span <= BENCH_COPYV_COLD_B;
+        span *= BENCH_COPYV_COLD_B / BENCH_COPYV_HOT_B) {
+        /* random sources, destinations packed back to back in the frame */
+        uint8_t* out = dst;
+        for(size_t i = 0; i < BENCH_COPYV_COUNT; i++) {
+            if(i % BENCH_COPYV_FRAME == 0)
+                out = dst;
+            size_t length = BENCH_COPYV_MIN_B + (size_t)rand() %
+                            (BENCH_COPYV_MAX_B - BENCH_COPYV_MIN_B + 1);
+            descs[i].src = src + (size_t)rand() % (span - length);
+            descs[i].dst = out;
+            descs[i].length = length;
+            out += length;
+        }
+        for(memory_isa_t isa = MEMORY_ISA_SCALAR; isa <= memory_best_isa();
+            isa++) {
+            memory_select_isa(isa);
+            PRINTF("%10zu %7s | %10.2f %10.2f %10.2f\n", span,
+                   memory_isa_name(isa),
+                   bench_copyv_run(BENCH_COPYV_MY, descs, BENCH_COPYV_COUNT),
+                   bench_copyv_run(BENCH_COPYV_LIBC, descs, BENCH_COPYV_COUNT),
+                   bench_copyv_run(BENCH_COPYV_BATCH, descs,
+                                   BENCH_COPYV_COUNT));
+        }
+    }
+    memory_select_isa(saved);
+    free(descs);
+    free(src);
+    free(dst);
+}
+
+/**
+ * @brief Opens a hardware counter for this thread, or returns -1
+ *
+ * perf_event_open is often restricted (perf_event_paranoid, containers), so
+ * callers must cope with the counter being unavailable.
+ */
+static int bench_counter_open(uint32_t type, uint64_t config) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static void bench_counter_start(int fd) {
+    if(fd >= 0) {
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+static long long bench_counter_stop(int fd) {
+    long long count = -1;
+    if(fd >= 0) {
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        if(read(fd, &count, sizeof(count)) != sizeof(count))
+            count = -1;
+    }
+    return count;
+}
+
+void bench_memset_stream(void) {
+    uint8_t* fill = malloc(BENCH_FILL_SIZE_B);
+    uint8_t* samples = malloc(BENCH_STATS_SIZE_B);
+    int misses = bench_counter_open(PERF_TYPE_HARDWARE,
+                                    PERF_COUNT_HW_CACHE_MISSES);
+    size_t threshold = memory_set_stream_threshold(0);
+    if(!fill || !samples) {
+        PRINTF("bench_memset_stream: out of memory\n");
+        free(fill);
+        free(samples);
+        return;
+    }
+    for(size_t i = 0; i < BENCH_STATS_SIZE_B; i++)
+        samples[i] = (uint8_t)(i * 31);
+    my_memset(fill, BENCH_FILL_SIZE_B, 1);
+
+    PRINTF("\nbench_memset_stream() - %zu MiB fill, then stats pass over "
+           "%zu MiB\n", BENCH_FILL_SIZE_B >> 20, BENCH_STATS_SIZE_B >> 20);
+    PRINTF("%10s | %9s | %9s %14s\n", "stores", "fill GB/s", "stats ms",
+           "cache misses");
+    for(int streaming = 0; streaming < 2; streaming++) {
+        memory_set_stream_threshold(streaming ? threshold : 0);
+        /* Warm the working set, evict it or not, then measure a pass over it */
+        bench_sink = find_mean(samples, BENCH_STATS_SIZE_B);
+        uint64_t start = bench_now_ns();
+        my_memzero(fill, BENCH_FILL_SIZE_B);
+        uint64_t fill_ns = bench_now_ns() - start;
+        bench_counter_start(misses);
+        start = bench_now_ns();
+        bench_sink = find_mean(samples, BENCH_STATS_SIZE_B);
+        uint64_t stats_ns = bench_now_ns() - start;
+        long long count = bench_counter_stop(misses);
+        PRINTF("%10s | %9.2f | %9.3f ", streaming ? "streaming" : "cached",
+               bench_gbps(BENCH_FILL_SIZE_B, fill_ns), stats_ns / 1e6);
+        if(count >= 0)
+            PRINTF("%14lld\n", count);
+        else
+            PRINTF("%14s\n", "n/a");
+    }
+
+    memory_set_stream_threshold(threshold);
+    if(misses >= 0)
+        close(misses);
+    free(fill);
+    free(samples);
+}
+
+/*
+ * The loop a caller would write without my_memset32. It is kept out of line
+ * and not vectorized, so it measures that loop and not the compiler.
+ */
+__attribute__((noinline, optimize("no-tree-vectorize")))
+static void bench_fill_words(uint32_t* dst, size_t count, uint32_t value) {
+    for(size_t i = 0; i < count; i++)
+        dst[i] = value;
+}
+
+static double bench_pattern_run(int baseline, uint32_t* buf, size_t size) {
+    size_t reps = BENCH_PATTERN_BYTES / size;
+    uint64_t start = bench_now_ns();
+    for(size_t r = 0; r < reps; r++) {
+        if(baseline)
+            bench_fill_words(buf, size / 4, 0xDEADBEEF);
+        else
+            my_memset32(buf, size / 4, 0xDEADBEEF);
+        bench_sink = (uint8_t)buf[r % (size / 4)];
+    }
+    return bench_gbps((uint64_t)reps * size, bench_now_ns() - start);
+}
+
+void bench_memset_pattern(void) {
+    static const size_t sizes[] = { 4UL << 10, 256UL << 10, BENCH_PATTERN_MAX_B };
+    uint8_t* raw = malloc(BENCH_PATTERN_MAX_B + 8);
+    memory_isa_t saved = memory_active_isa();
+    if(!raw) {
+        PRINTF("bench_memset_pattern: out of memory\n");
+        return;
+    }
+    /* Element aligned but not vector aligned, so every fill has a head */
+    uint32_t* buf = (uint32_t*)(raw + 4);
+    memset(raw, 0, BENCH_PATTERN_MAX_B + 8);
+
+    PRINTF("\nbench_memset_pattern() - my_memset32 GB/s\n");
+    PRINTF("%10s | %9s", "bytes", "word loop");
+    for(memory_isa_t isa = MEMORY_ISA_SCALAR; isa <= memory_best_isa(); isa++)
+        PRINTF(" %9s", memory_isa_name(isa));
+    PRINTF("\n");
+    for(size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        PRINTF("%10zu | %9.2f", sizes[i], bench_pattern_run(1, buf, sizes[i]));
+        for(memory_isa_t isa = MEMORY_ISA_SCALAR; isa <= memory_best_isa();
+            isa++) {
+            memory_select_isa(isa);
+            PRINTF(" %9.2f", bench_pattern_run(0, buf, sizes[i]));
+        }
+        PRINTF("\n");
+    }
+    memory_select_isa(saved);
+    free(raw);
+}
+
+/* The byte-at-a-time table loop the library replaces */
+static uint32_t bench_crc_table[256];
+
+__attribute__((noinline))
+static uint32_t bench_crc32_bytes(const uint8_t* src, size_t length) {
+    uint32_t crc = 0xFFFFFFFF;
+    for(size_t i = 0; i < length; i++)
+        crc = (crc >> 8) ^ bench_crc_table[(crc ^ src[i]) & 0xFF];
+    return ~crc;
+}
+
+enum bench_checksum_op {
+    BENCH_CRC_BYTES, BENCH_CRC32, BENCH_CRC32C_TABLE, BENCH_CRC32C,
+    BENCH_FLETCHER64, BENCH_COPY_THEN_CRC, BENCH_COPY_CRC, BENCH_CHECKSUM_OPS
+};
+
+static const char* const bench_checksum_names[] = {
+    "byte loop", "crc32", "crc32c tbl", "crc32c", "fletcher", "copy+crc",
+    "fused"
+};
+
+static double bench_checksum_run(enum bench_checksum_op op, uint8_t* src,
+                                 uint8_t* dst, size_t size) {
+    size_t reps = BENCH_CHECKSUM_BYTES / size;
+    memory_select_isa(op == BENCH_CRC32C_TABLE ? MEMORY_ISA_SCALAR
+                                               : memory_best_isa());
+    uint64_t start = bench_now_ns();
+    for(size_t r = 0; r < reps; r++) {
+        uint64_t sum = 0;
+        switch(op) {
+        case BENCH_CRC_BYTES:
+            sum = bench_crc32_bytes(src, size);
+            break;
+        case BENCH_CRC32:
+            sum = checksum_crc32(src, size, 0);
+            break;
+        case BENCH_CRC32C_TABLE:
+        case BENCH_CRC32C:
+            sum = checksum_crc32c(src, size, 0);
+            break;
+        case BENCH_FLETCHER64:
+            sum = checksum_fletcher64(src, size, 0);
+            break;
+        case BENCH_COPY_THEN_CRC:
+            my_memcopy(src, dst, size);
+            sum = checksum_crc32c(dst, size, 0);
+            break;
+        default:
+            sum = checksum_copy_crc32c(src, dst, size, 0);
+            break;
+        }
+        bench_sink = (uint8_t)sum;
+    }
+    return bench_gbps((uint64_t)reps * size, bench_now_ns() - start);
+}
+
+void bench_checksum(void) {
+    static const size_t sizes[] = { 4UL << 10, 256UL << 10,
+                                    BENCH_CHECKSUM_MAX_B };
+    uint8_t* src = malloc(2 * BENCH_CHECKSUM_MAX_B);
+    memory_isa_t saved = memory_active_isa();
+    if(!src) {
+        PRINTF("bench_checksum: out of memory\n");
+        return;
+    }
+    uint8_t* dst = src + BENCH_CHECKSUM_MAX_B;
+    for(size_t i = 0; i < 2 * BENCH_CHECKSUM_MAX_B; i++)
+        src[i] = (uint8_t)(i * 131 + (i >> 11));
+    for(uint32_t n = 0; n < 256; n++) {
+        uint32_t c = n;
+        for(int bit = 0; bit < 8; bit++)
+            c = (c >> 1) ^ (0xEDB88320U & (0U - (c & 1)));
+        bench_crc_table[n] = c;
+    }
+
+    PRINTF("\nbench_checksum() - GB/s, copies count the source bytes once\n");
+    PRINTF("%10s |", "bytes");
+    for(int op = 0; op < BENCH_CHECKSUM_OPS; op++)
+        PRINTF(" %10s", bench_checksum_names[op]);
+    PRINTF("\n");
+    for(size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        PRINTF("%10zu |", sizes[i]);
+        for(int op = 0; op < BENCH_CHECKSUM_OPS; op++)
+            PRINTF(" %10.2f", bench_checksum_run((enum bench_checksum_op)op,
+                                                 src, dst, sizes[i]));
+        PRINTF("\n");
+    }
+    memory_select_isa(saved);
+    free(src);
+}
+
+enum bench_compress_set {
+    BENCH_SET_RAMP, BENCH_SET_HELD, BENCH_SET_STEADY, BENCH_SET_NOISE,
+    BENCH_COMPRESS_SETS
+};
+
+static const char* const bench_compress_names[] = {
+    "ramp", "held", "steady", "noise"
+};
+
+static uint32_t bench_rand(uint32_t* state);
+
+/**
+ * @brief Fills a dataset: the 0, 1, 2, ... ramp of the course1 tests, a
+ * sensor sampled faster than it changes (each reading held for 16 samples,
+ * drifting and with the odd glitch), a steady level with rare spikes, and
+ * noise
+ */
+static void bench_compress_fill(enum bench_compress_set set, uint8_t* buf,
+                                size_t size) {
+    uint32_t state = 0x2545F491;
+    uint8_t level = 128;
+    for(size_t i = 0; i < size; i++) {
+        uint32_t r = bench_rand(&state);
+        switch(set) {
+        case BENCH_SET_RAMP:
+            buf[i] = (uint8_t)i;
+            break;
+        case BENCH_SET_HELD:
+            if(i % 16 == 0)
+                level = (uint8_t)(level + (r & 3) - 1);
+            buf[i] = (r & 0xFFF) ? level : (uint8_t)(r >> 24);
+            break;
+        case BENCH_SET_STEADY:
+            buf[i] = (r & 0x3FF) ? 100 : (uint8_t)(r >> 24);
+            break;
+        default:
+            buf[i] = (uint8_t)(r >> 24);
+            break;
+        }
+    }
+}
+
+void bench_compress(void) {
+    size_t bound = MEMORY_COMPRESS_BOUND(BENCH_COMPRESS_SIZE_B);
+    uint8_t* src = malloc(BENCH_COMPRESS_SIZE_B);
+    uint8_t* enc = malloc(bound);
+    uint8_t* dst = malloc(bound + MEMORY_DECOMPRESS_MARGIN(bound));
+    size_t reps = BENCH_COMPRESS_BYTES / BENCH_COMPRESS_SIZE_B;
+    memory_isa_t saved = memory_active_isa();
+    if(!src || !enc || !dst) {
+        PRINTF("bench_compress: out of memory\n");
+        free(src);
+        free(enc);
+        free(dst);
+        return;
+    }
+
+    PRINTF("\nbench_compress() - %zu MiB datasets, GB/s of samples\n",
+           BENCH_COMPRESS_SIZE_B >> 20);
+    PRINTF("%8s | %9s | %9s | %9s %9s | %9s | %s\n", "data", "ratio",
+           "encode", "decode", memory_isa_name(memory_best_isa()), "in place",
+           "round trip");
+    for(int set = 0; set < BENCH_COMPRESS_SETS; set++) {
+        bench_compress_fill((enum bench_compress_set)set, src,
+                            BENCH_COMPRESS_SIZE_B);
+        size_t n = 0;
+        uint64_t start = bench_now_ns();
+        for(size_t r = 0; r < reps; r++)
+            n = memory_compress(src, BENCH_COMPRESS_SIZE_B, enc, bound);
+        uint64_t enc_ns = bench_now_ns() - start;
+
+        double dec[2];
+        for(int best = 0; best < 2; best++) {
+            memory_select_isa(best ? memory_best_isa() : MEMORY_ISA_SCALAR);
+            start = bench_now_ns();
+            for(size_t r = 0; r < reps; r++)
+                bench_sink = (uint8_t)memory_decompress(enc, n, dst,
+                                                        BENCH_COMPRESS_SIZE_B);
+            dec[best] = bench_gbps((uint64_t)reps * BENCH_COMPRESS_SIZE_B,
+                                   bench_now_ns() - start);
+        }
+        int ok = memory_decompress(enc, n, dst, BENCH_COMPRESS_SIZE_B) ==
+                     BENCH_COMPRESS_SIZE_B &&
+                 memcmp(src, dst, BENCH_COMPRESS_SIZE_B) == 0;
+
+        /* The copy to the end of the buffer is part of an in-place decode */
+        size_t size = BENCH_COMPRESS_SIZE_B + MEMORY_DECOMPRESS_MARGIN(n);
+        start = bench_now_ns();
+        for(size_t r = 0; r < reps; r++) {
+            memcpy(dst + size - n, enc, n);
+            bench_sink = (uint8_t)memory_decompress_in_place(dst, size, n);
+        }
+        uint64_t place_ns = bench_now_ns() - start;
+        ok = ok && memcmp(src, dst, BENCH_COMPRESS_SIZE_B) == 0;
+
+        PRINTF("%8s | %9.1f | %9.2f | %9.2f %9.2f | %9.2f | %s\n",
+               bench_compress_names[set],
+               n ? (double)BENCH_COMPRESS_SIZE_B / (double)n : 0.0,
+               bench_gbps((uint64_t)reps * BENCH_COMPRESS_SIZE_B, enc_ns),
+               dec[0], dec[1],
+               bench_gbps((uint64_t)reps * BENCH_COMPRESS_SIZE_B, place_ns),
+               ok ? "ok" : "MISMATCH");
+    }
+    memory_select_isa(saved);
+    free(src);
+    free(enc);
+    free(dst);
+}
+
+/* The bubble sort sort_array() used to be, as the reference */
+__attribute__((noinline))
+static void bench_bubble_sort(unsigned char* arr, size_t length) {
+    for(size_t i = 0; i < length; i++)
+        for(size_t j = length - 1; j > i; j--)
+            if(arr[j] > arr[j - 1]) {
+                unsigned char temp = arr[j];
+                arr[j] = arr[j - 1];
+                arr[j - 1] = temp;
+            }
+}
+
+static int bench_compare_desc(const void* a, const void* b) {
+    return (int)*(const unsigned char*)b - (int)*(const unsigned char*)a;
+}
+
+enum bench_sort_op {
+    BENCH_SORT_BUBBLE, BENCH_SORT_QSORT, BENCH_SORT_COUNTING, BENCH_SORT_U16,
+    BENCH_SORT_U32, BENCH_SORT_OPS
+};
+
+static const char* const bench_sort_names[] = {
+    "bubble", "qsort", "sort_array", "radix u16", "radix u32"
+};
+
+/**
+ * @brief Sorts fresh copies of the samples until enough elements are done
+ *
+ * @return nanoseconds per element, copy included
+ */
+static double bench_sort_run(enum bench_sort_op op, const uint32_t* samples,
+                             uint8_t* work, uint8_t* scratch, size_t n) {
+    size_t width = op == BENCH_SORT_U32 ? 4 : op == BENCH_SORT_U16 ? 2 : 1;
+    size_t reps = (BENCH_SORT_ELEMS + n - 1) / n;
+    /* Quadratic: as many comparisons as the others sort elements */
+    if(op == BENCH_SORT_BUBBLE)
+        reps = reps / n ? reps / n : 1;
+    uint64_t start = bench_now_ns();
+    for(size_t r = 0; r < reps; r++) {
+        if(width == 4)
+            memcpy(work, samples, n * 4);
+        else if(width == 2)
+            for(size_t i = 0; i < n; i++)
+                ((uint16_t*)work)[i] = (uint16_t)samples[i];
+        else
+            for(size_t i = 0; i < n; i++)
+                work[i] = (uint8_t)samples[i];
+        switch(op) {
+        case BENCH_SORT_BUBBLE:
+            bench_bubble_sort(work, n);
+            break;
+        case BENCH_SORT_QSORT:
+            qsort(work, n, 1, bench_compare_desc);
+            break;
+        case BENCH_SORT_COUNTING:
+            sort_array(work, (unsigned int)n);
+            break;
+        case BENCH_SORT_U16:
+            sort_array_u16((uint16_t*)work, n, (uint16_t*)scratch);
+            break;
+        default:
+            sort_array_u32((uint32_t*)work, n, (uint32_t*)scratch);
+            break;
+        }
+        bench_sink = work[r % n];
+    }
+    return (double)(bench_now_ns() - start) / (double)(reps * n);
+}
+
+void bench_sort(void) {
+    uint32_t* samples = malloc(BENCH_SORT_MAX * sizeof(uint32_t));
+    uint8_t* work = malloc(BENCH_SORT_MAX * sizeof(uint32_t));
+    uint8_t* scratch = malloc(BENCH_SORT_MAX * sizeof(uint32_t));
+    uint32_t state = 0x1234567;
+    if(!samples || !work || !scratch) {
+        PRINTF("bench_sort: out of memory\n");
+        free(samples);
+        free(work);
+        free(scratch);
+        return;
+    }
+    for(size_t i = 0; i < BENCH_SORT_MAX; i++)
+        samples[i] = bench_rand(&state);
+
+    PRINTF("\nbench_sort() - ns per element, descending, random keys\n");
+    PRINTF("%10s |", "elements");
+    for(int op = 0; op < BENCH_SORT_OPS; op++)
+        PRINTF(" %10s", bench_sort_names[op]);
+    PRINTF("\n");
+    for(size_t n = BENCH_SORT_MIN; n <= BENCH_SORT_MAX; n *= 8) {
+        PRINTF("%10zu |", n);
+        for(int op = 0; op < BENCH_SORT_OPS; op++) {
+            if(op == BENCH_SORT_BUBBLE && n > BENCH_BUBBLE_MAX)
+                PRINTF(" %10s", "-");
+            else
+                PRINTF(" %10.2f", bench_sort_run((enum bench_sort_op)op,
+                                                 samples, work, scratch, n));
+        }
+        PRINTF("\n");
+        /* The last row is the full 100M */
+        if(n < BENCH_SORT_MAX && n * 8 > BENCH_SORT_MAX)
+            n = BENCH_SORT_MAX / 8;
+    }
+    free(samples);
+    free(work);
+    free(scratch);
+}
+
+enum bench_stats_op {
+    BENCH_STATS_SORT, BENCH_STATS_ONE, BENCH_STATS_HIST, BENCH_STATS_OPS
+};
+
+static const char* const bench_stats_names[] = {
+    "sort copy", "1 counter", "histogram"
+};
+
+/**
+ * @brief Takes median, mean, maximum and minimum of the samples until enough
+ * samples are done: from a sorted copy, from a histogram counted with one
+ * counter per value, or from stats_histogram_build()
+ *
+ * @return nanoseconds per sample
+ */
+static double bench_stats_run(enum bench_stats_op op, const uint8_t* samples,
+                              uint8_t* work, size_t n) {
+    stats_histogram_t hist;
+    size_t reps = (BENCH_STATS_ELEMS + n - 1) / n;
+    uint64_t start = bench_now_ns();
+    for(size_t r = 0; r < reps; r++) {
+        switch(op) {
+        case BENCH_STATS_SORT:
+            memcpy(work, samples, n);
+            sort_array(work, (unsigned int)n);
+            bench_sink = (uint8_t)(work[n / 2] + work[0] + work[n - 1]);
+            bench_sink = find_mean(work, (unsigned int)n);
+            break;
+        case BENCH_STATS_ONE:
+            stats_histogram_reset(&hist);
+            for(size_t i = 0; i < n; i++)
+                hist.counts[samples[i]]++;
+            hist.length = n;
+            bench_sink = (uint8_t)(stats_histogram_median(&hist) +
+                                   stats_histogram_maximum(&hist) +
+                                   stats_histogram_minimum(&hist));
+            bench_sink = stats_histogram_mean(&hist);
+            break;
+        default:
+            stats_histogram_build(&hist, samples, n);
+            bench_sink = (uint8_t)(stats_histogram_median(&hist) +
+                                   stats_histogram_maximum(&hist) +
+                                   stats_histogram_minimum(&hist));
+            bench_sink = stats_histogram_mean(&hist);
+            break;
+        }
+    }
+    return (double)(bench_now_ns() - start) / (double)(reps * n);
+}
+
+void bench_stats(void) {
+    uint8_t* samples = malloc(BENCH_STATS_MAX_B);
+    uint8_t* work = malloc(BENCH_STATS_MAX_B);
+    if(!samples || !work) {
+        PRINTF("bench_stats: out of memory\n");
+        free(samples);
+        free(work);
+        return;
+    }
+
+    PRINTF("\nbench_stats() - ns per sample for median, mean, max and min\n");
+    PRINTF("%7s %10s |", "data", "bytes");
+    for(int op = 0; op < BENCH_STATS_OPS; op++)
+        PRINTF(" %10s", bench_stats_names[op]);
+    PRINTF("\n");
+    /* Noise spreads the counts, a steady signal piles them on one value */
+    for(int set = BENCH_SET_STEADY; set <= BENCH_SET_NOISE; set++) {
+        bench_compress_fill((enum bench_compress_set)set, samples,
+                            BENCH_STATS_MAX_B);
+        for(size_t n = BENCH_STATS_MIN_B; n <= BENCH_STATS_MAX_B; n *= 64) {
+            PRINTF("%7s %10zu |", bench_compress_names[set], n);
+            for(int op = 0; op < BENCH_STATS_OPS; op++)
+                PRINTF(" %10.3f", bench_stats_run((enum bench_stats_op)op,
+                                                  samples, work, n));
+            PRINTF("\n");
+        }
+    }
+    free(samples);
+    free(work);
+}
+
+static int bench_compare_u32_desc(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a;
+    uint32_t y = *(const uint32_t*)b;
+    return (x < y) - (x > y);
+}
+
+enum bench_select_set {
+    BENCH_SELECT_RANDOM, BENCH_SELECT_ASCENDING, BENCH_SELECT_DESCENDING,
+    BENCH_SELECT_PIPE, BENCH_SELECT_SETS
+};
+
+static const char* const bench_select_set_names[] = {
+    "random", "ascending", "descending", "organ pipe"
+};
+
+enum bench_select_op {
+    BENCH_SELECT_QSORT, BENCH_SELECT_RADIX, BENCH_SELECT_INTRO, BENCH_SELECT_OPS
+};
+
+static const char* const bench_select_names[] = {
+    "qsort", "radix", "select"
+};
+
+/**
+ * @brief Takes the median of fresh copies of the keys until enough keys are
+ * done, by sorting and reading the middle or with find_median_select()
+ *
+ * @return nanoseconds per key, copy included
+ */
+static double bench_select_run(enum bench_select_op op, const uint32_t* keys,
+                               uint32_t* work, uint32_t* scratch, size_t n) {
+    size_t reps = (BENCH_SORT_ELEMS + n - 1) / n;
+    uint32_t median = 0;
+    uint64_t start = bench_now_ns();
+    for(size_t r = 0; r < reps; r++) {
+        switch(op) {
+        case BENCH_SELECT_QSORT:
+            memcpy(work, keys, n * sizeof(uint32_t));
+            qsort(work, n, sizeof(uint32_t), bench_compare_u32_desc);
+            median = work[n / 2];
+            break;
+        case BENCH_SELECT_RADIX:
+            memcpy(work, keys, n * sizeof(uint32_t));
+            sort_array_u32(work, n, scratch);
+            median = work[n / 2];
+            break;
+        default:
+            find_median_select((void*)keys, n, sizeof(uint32_t), work,
+                               &median);
+            break;
+        }
+        bench_sink = (uint8_t)median;
+    }
+    return (double)(bench_now_ns() - start) / (double)(reps * n);
+}
+
+void bench_select(void) {
+    uint32_t* keys = malloc(BENCH_SELECT_MAX * sizeof(uint32_t));
+    uint32_t* work = malloc(BENCH_SELECT_MAX * sizeof(uint32_t));
+    uint32_t* scratch = malloc(BENCH_SELECT_MAX * sizeof(uint32_t));
+    if(!keys || !work || !scratch) {
+        PRINTF("bench_select: out of memory\n");
+        free(keys);
+        free(work);
+        free(scratch);
+        return;
+    }
+
+    PRINTF("\nbench_select() - ns per key for the median of 32-bit keys, "
+           "sorting first or selecting\n");
+    PRINTF("%10s %10s |", "keys", "elements");
+    for(int op = 0; op < BENCH_SELECT_OPS; op++)
+        PRINTF(" %10s", bench_select_names[op]);
+    PRINTF("\n");
+    for(int set = 0; set < BENCH_SELECT_SETS; set++) {
+        for(size_t n = BENCH_SELECT_MIN; n <= BENCH_SELECT_MAX; n *= 4) {
+            uint32_t state = 0x1234567;
+            for(size_t i = 0; i < n; i++) {
+                switch(set) {
+                case BENCH_SELECT_RANDOM:
+                    keys[i] = bench_rand(&state);
+                    break;
+                case BENCH_SELECT_ASCENDING:
+                    keys[i] = (uint32_t)i;
+                    break;
+                case BENCH_SELECT_DESCENDING:
+                    keys[i] = (uint32_t)(n - i);
+                    break;
+                default:
+                    /* The first, middle and last keys are the two smallest
+                     * and the largest, so the median of three is lopsided */
+                    keys[i] = (uint32_t)(i < n / 2 ? i : n - i);
+                    break;
+                }
+            }
+            PRINTF("%10s %10zu |", bench_select_set_names[set], n);
+            for(int op = 0; op < BENCH_SELECT_OPS; op++)
+                PRINTF(" %10.2f", bench_select_run((enum bench_select_op)op,
+                                                   keys, work, scratch, n));
+            PRINTF("\n");
+        }
+    }
+    free(keys);
+    free(work);
+    free(scratch);
+}
+
+/* find_mean, find_maximum and find_minimum as three passes, the way they
+ * were before stats_summary(), as the reference */
+__attribute__((noinline))
+static void bench_summary_loops(const uint8_t* src, size_t length,
+                                struct stats_result* result) {
+    unsigned int sum = 0;
+    uint8_t max = 0;
+    uint8_t min = 255;
+    for(size_t i = 0; i < length; i++)
+        sum += src[i];
+    for(size_t i = 0; i < length; i++)
+        max = src[i] > max ? src[i] : max;
+    for(size_t i = 0; i < length; i++)
+        min = src[i] < min ? src[i] : min;
+    result->sum = sum;
+    result->maximum = max;
+    result->minimum = min;
+    result->count = length;
+}
+
+static double bench_summary_run(int loops, const uint8_t* buf, size_t size) {
+    struct stats_result result;
+    size_t reps = BENCH_STATS_ELEMS / size ? BENCH_STATS_ELEMS / size : 1;
+    uint64_t start = bench_now_ns();
+    for(size_t r = 0; r < reps; r++) {
+        if(loops)
+            bench_summary_loops(buf, size, &result);
+        else
+            stats_summary(buf, size, &result);
+        bench_sink = (uint8_t)(result.sum + result.minimum + result.maximum);
+    }
+    return bench_gbps((uint64_t)reps * size, bench_now_ns() - start);
+}
+
+void bench_summary(void) {
+    uint8_t* buf = malloc(BENCH_SUMMARY_MAX_B);
+    memory_isa_t saved = memory_active_isa();
+    uint32_t state = 0x9E3779B9;
+    if(!buf) {
+        PRINTF("bench_summary: out of memory\n");
+        return;
+    }
+    for(size_t i = 0; i < BENCH_SUMMARY_MAX_B; i++)
+        buf[i] = (uint8_t)bench_rand(&state);
+
+    PRINTF("\nbench_summary() - GB/s, minimum, maximum and sum\n");
+    PRINTF("%10s | %9s", "bytes", "3 loops");
+    for(memory_isa_t isa = MEMORY_ISA_SCALAR; isa <= memory_best_isa(); isa++)
+        PRINTF(" %9s", memory_isa_name(isa));
+    PRINTF("\n");
+    for(size_t size = BENCH_SUMMARY_MIN_B; size <= BENCH_SUMMARY_MAX_B;
+        size *= 32) {
+        PRINTF("%10zu | %9.2f", size, bench_summary_run(1, buf, size));
+        for(memory_isa_t isa = MEMORY_ISA_SCALAR; isa <= memory_best_isa();
+            isa++) {
+            memory_select_isa(isa);
+            PRINTF(" %9.2f", bench_summary_run(0, buf, size));
+        }
+        PRINTF("\n");
+    }
+    memory_select_isa(saved);
+    free(buf);
+}
+
+/**
+ * @brief Small xorshift generator so runs are repeatable across libcs
+ */
+static uint32_t bench_rand(uint32_t* state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+/**
+ * @brief Returns the KiB of the mapping holding ptr that are on huge pages,
+ * from /proc/self/smaps, or -1 if it cannot be read
+ */
+static long bench_huge_kib(const void* ptr) {
+    FILE* smaps = fopen("/proc/self/smaps", "r");
+    char line[256];
+    int inside = 0;
+    long kib = -1;
+    if(!smaps)
+        return -1;
+    while(kib < 0 && fgets(line, sizeof(line), smaps)) {
+        uintptr_t lo;
+        uintptr_t hi;
+        if(sscanf(line, "%lx-%lx ", &lo, &hi) == 2)
+            inside = (uintptr_t)ptr >= lo && (uintptr_t)ptr < hi;
+        else if(inside)
+            sscanf(line, "AnonHugePages: %ld kB", &kib);
+    }
+    fclose(smaps);
+    return kib;
+}
+
+void bench_huge_pages(void) {
+    static const char* const names[] = { "reserve_words", "aligned" };
+    size_t words = BENCH_HUGE_SIZE_B / sizeof(int32_t);
+    int tlb = bench_counter_open(PERF_TYPE_HW_CACHE,
+                                 PERF_COUNT_HW_CACHE_DTLB |
+                                 (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                 (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+
+    PRINTF("\nbench_huge_pages() - %zu MiB buffer: first touch, find_mean, "
+           "%zu Mi random reads\n", BENCH_HUGE_SIZE_B >> 20,
+           BENCH_HUGE_READS >> 20);
+    PRINTF("%14s | %9s | %9s | %9s %14s | %10s\n", "reserve", "fill GB/s",
+           "mean GB/s", "reads ms", "dTLB misses", "huge MiB");
+    for(int aligned = 0; aligned < 2; aligned++) {
+        uint8_t* buf = (uint8_t*)(aligned ? reserve_words_aligned(words, 0)
+                                          : reserve_words(words));
+        if(!buf) {
+            PRINTF("%14s | out of memory\n", names[aligned]);
+            continue;
+        }
+        /* The first write faults every page in */
+        uint64_t start = bench_now_ns();
+        my_memset(buf, BENCH_HUGE_SIZE_B, 7);
+        uint64_t fill_ns = bench_now_ns() - start;
+        start = bench_now_ns();
+        bench_sink = find_mean(buf, BENCH_HUGE_SIZE_B);
+        uint64_t mean_ns = bench_now_ns() - start;
+
+        /* Random reads touch a new page almost every time */
+        uint32_t state = 0x9E3779B9;
+        uint32_t sum = 0;
+        bench_counter_start(tlb);
+        start = bench_now_ns();
+        for(size_t i = 0; i < BENCH_HUGE_READS; i++) {
+            size_t at = (size_t)bench_rand(&state) << 7;
+            sum += buf[(at ^ bench_rand(&state)) & (BENCH_HUGE_SIZE_B - 1)];
+        }
+        uint64_t reads_ns = bench_now_ns() - start;
+        long long misses = bench_counter_stop(tlb);
+        bench_sink = (uint8_t)sum;
+        long huge = bench_huge_kib(buf);
+
+        PRINTF("%14s | %9.2f | %9.2f | %9.1f ", names[aligned],
+               bench_gbps(BENCH_HUGE_SIZE_B, fill_ns),
+               bench_gbps(BENCH_HUGE_SIZE_B, mean_ns), reads_ns / 1e6);
+        if(misses >= 0)
+            PRINTF("%14lld | ", misses);
+        else
+            PRINTF("%14s | ", "n/a");
+        if(huge >= 0)
+            PRINTF("%10ld\n", huge >> 10);
+        else
+            PRINTF("%10s\n", "n/a");
+        free_words((uint32_t*)buf);
+    }
+    if(tlb >= 0)
+        close(tlb);
+}
+
+typedef void* (*bench_alloc_fn)(size_t bytes);
+typedef void (*bench_free_fn)(void* ptr);
+
+static void* bench_reserve_bytes(size_t bytes) {
+    return reserve_words((bytes + sizeof(int32_t) - 1) / sizeof(int32_t));
+}
+
+static void bench_free_bytes(void* ptr) {
+    free_words((uint32_t*)ptr);
+}
+
+/**
+ * @brief Allocates batches of random sizes up to max_bytes and frees each
+ * batch in a shuffled order. Returns nanoseconds per reserve/free pair.
+ */
+static double bench_alloc_churn(bench_alloc_fn alloc, bench_free_fn release,
+                                size_t max_bytes) {
+    static void* live[BENCH_ALLOC_BATCH];
+    static size_t sizes[BENCH_ALLOC_BATCH];
+    static uint16_t order[BENCH_ALLOC_BATCH];
+    uint32_t seed = 0x2545F491;
+    for(size_t i = 0; i < BENCH_ALLOC_BATCH; i++) {
+        sizes[i] = 1 + bench_rand(&seed) % max_bytes;
+        order[i] = (uint16_t)i;
+    }
+    for(size_t i = BENCH_ALLOC_BATCH - 1; i > 0; i--) {
+        size_t j = bench_rand(&seed) % (i + 1);
+        uint16_t t = order[i];
+        order[i] = order[j];
+        order[j] = t;
+    }
+
+    uint64_t start = bench_now_ns();
+    for(size_t r = 0; r < BENCH_ALLOC_ROUNDS; r++) {
+        for(size_t i = 0; i < BENCH_ALLOC_BATCH; i++) {
+            live[i] = alloc(sizes[i]);
+            *(volatile uint8_t*)live[i] = (uint8_t)i;
+        }
+        for(size_t i = 0; i < BENCH_ALLOC_BATCH; i++)
+            release(live[order[i]]);
+    }
+    return (double)(bench_now_ns() - start) /
+           ((double)BENCH_ALLOC_ROUNDS * BENCH_ALLOC_BATCH);
+}
+
+void bench_reserve_words(void) {
+    PRINTF("\nbench_reserve_words() - ns per reserve/free pair, batches of %d"
+           "\n", BENCH_ALLOC_BATCH);
+    PRINTF("%10s | %9s %9s\n", "max bytes", "reserve", "malloc");
+    for(size_t max = MEM_POOL_MIN_BLOCK; max <= MEM_POOL_MAX_BLOCK; max *= 4) {
+        PRINTF("%10zu | %9.1f %9.1f\n", max,
+               bench_alloc_churn(bench_reserve_bytes, bench_free_bytes, max),
+               bench_alloc_churn(malloc, free, max));
+    }
+}
+
+/* Latency histogram in BENCH_LAT_STEP_NS buckets; the last one is overflow */
+#define BENCH_LAT_BUCKETS   (1000)
+#define BENCH_LAT_STEP_NS   (10)
+
+struct bench_latency {
+    uint64_t total_ns;
+    uint64_t max_alloc_ns;
+    uint64_t max_free_ns;
+    size_t failed;
+    uint32_t histogram[BENCH_LAT_BUCKETS];
+};
+
+static void bench_latency_add(struct bench_latency* lat, uint64_t ns) {
+    uint64_t bucket = ns / BENCH_LAT_STEP_NS;
+    lat->total_ns += ns;
+    lat->histogram[bucket < BENCH_LAT_BUCKETS ? bucket : BENCH_LAT_BUCKETS - 1]++;
+}
+
+/**
+ * @brief Upper bound in ns of the given fraction of samples
+ */
+static uint64_t bench_latency_percentile(const struct bench_latency* lat,
+                                         size_t samples, double fraction) {
+    size_t target = (size_t)(fraction * samples);
+    size_t seen = 0;
+    for(size_t b = 0; b < BENCH_LAT_BUCKETS; b++) {
+        seen += lat->histogram[b];
+        if(seen >= target)
+            return (b + 1) * BENCH_LAT_STEP_NS;
+    }
+    return BENCH_LAT_BUCKETS * BENCH_LAT_STEP_NS;
+}
+
+static void bench_latency_print(const char* name,
+                                const struct bench_latency* lat, size_t ops) {
+    PRINTF("%8s | %8.1f %8llu %8llu %12llu %12llu %8zu\n", name,
+           (double)lat->total_ns / ops,
+           (unsigned long long)bench_latency_percentile(lat, ops, 0.99),
+           (unsigned long long)bench_latency_percentile(lat, ops, 0.9999),
+           (unsigned long long)lat->max_alloc_ns,
+           (unsigned long long)lat->max_free_ns, lat->failed);
+}
+
+static tlsf_t bench_tlsf;
+
+static void* bench_tlsf_malloc(size_t bytes) {
+    return tlsf_malloc(&bench_tlsf, bytes);
+}
+
+static void bench_tlsf_free(void* ptr) {
+    tlsf_free(&bench_tlsf, ptr);
+}
+
+/**
+ * @brief Random churn: each step picks a slot and frees it if it is live or
+ * fills it with a block of log-uniform random size otherwise. Every call is
+ * timed individually to catch the worst case.
+ */
+static void bench_churn(bench_alloc_fn alloc, bench_free_fn release,
+                        struct bench_latency* lat) {
+    /* Warm up the timer so its first call is not charged to the allocator */
+    bench_now_ns();
+    static void* live[BENCH_CHURN_SLOTS];
+    uint32_t seed = 0x9E3779B9;
+    memset(live, 0, sizeof(live));
+    memset(lat, 0, sizeof(*lat));
+    for(size_t op = 0; op < BENCH_CHURN_OPS; op++) {
+        uint32_t r = bench_rand(&seed);
+        size_t slot = r % BENCH_CHURN_SLOTS;
+        uint64_t start = bench_now_ns();
+        if(live[slot]) {
+            release(live[slot]);
+            live[slot] = NULL;
+            uint64_t ns = bench_now_ns() - start;
+            bench_latency_add(lat, ns);
+            if(ns > lat->max_free_ns)
+                lat->max_free_ns = ns;
+        } else {
+            size_t shift = 4 + (r >> 16) % 11;
+            size_t bytes = 1 + bench_rand(&seed) % ((size_t)1 << shift);
+            live[slot] = alloc(bytes);
+            uint64_t ns = bench_now_ns() - start;
+            bench_latency_add(lat, ns);
+            if(ns > lat->max_alloc_ns)
+                lat->max_alloc_ns = ns;
+            if(!live[slot])
+                lat->failed++;
+        }
+    }
+    for(size_t slot = 0; slot < BENCH_CHURN_SLOTS; slot++)
+        if(live[slot])
+            release(live[slot]);
+}
+
+void bench_tlsf_churn(void) {
+    uint8_t* region = malloc(BENCH_CHURN_HEAP_B);
+    static struct bench_latency lat;
+    struct tlsf_stats stats;
+    if(!region || tlsf_init(&bench_tlsf, region, BENCH_CHURN_HEAP_B) != 0) {
+        PRINTF("bench_tlsf_churn: out of memory\n");
+        free(region);
+        return;
+    }
+    /* Fault the region in so page faults do not count as allocator time */
+    memset(region, 0, BENCH_CHURN_HEAP_B);
+    tlsf_init(&bench_tlsf, region, BENCH_CHURN_HEAP_B);
+
+    PRINTF("\nbench_tlsf_churn() - %d ops over %d slots, 1 B to %lu KiB\n",
+           BENCH_CHURN_OPS, BENCH_CHURN_SLOTS, BENCH_CHURN_MAX_B >> 10);
+    PRINTF("(timer overhead included; the maxima include preemption)\n");
+    PRINTF("%8s | %8s %8s %8s %12s %12s %8s\n", "heap", "avg ns", "p99",
+           "p99.99", "max alloc ns", "max free ns", "failed");
+    bench_churn(bench_tlsf_malloc, bench_tlsf_free, &lat);
+    bench_latency_print("tlsf", &lat, BENCH_CHURN_OPS);
+    bench_churn(malloc, free, &lat);
+    bench_latency_print("malloc", &lat, BENCH_CHURN_OPS);
+
+    /* Fragmentation with half of the slots still live */
+    static void* live[BENCH_CHURN_SLOTS];
+    uint32_t seed = 0x1234567;
+    for(size_t slot = 0; slot < BENCH_CHURN_SLOTS; slot++)
+        live[slot] = tlsf_malloc(&bench_tlsf,
+                                 1 + bench_rand(&seed) % BENCH_CHURN_MAX_B);
+    for(size_t slot = 0; slot < BENCH_CHURN_SLOTS; slot += 2)
+        tlsf_free(&bench_tlsf, live[slot]);
+    tlsf_stats(&bench_tlsf, &stats);
+    PRINTF("tlsf fragmentation with every other block freed: %.1f%% "
+           "(largest free %zu of %zu free bytes in %zu blocks)\n",
+           stats.free_bytes ?
+           100.0 * (1.0 - (double)stats.largest_free / stats.free_bytes) : 0.0,
+           stats.largest_free, stats.free_bytes, stats.free_blocks);
+
+    free(region);
+}
+
+struct bench_thread {
+    pthread_t id;
+    pthread_barrier_t* start;
+    bench_alloc_fn alloc;
+    bench_free_fn release;
+    uint32_t seed;
+    size_t corrupted;
+};
+
+/**
+ * @brief Churn on private slots. Each block is stamped with its thread and slot
+ * and checked before it is freed, so a block handed to two threads shows up.
+ */
+static void* bench_thread_churn(void* arg) {
+    struct bench_thread* t = arg;
+    uint32_t* live[BENCH_THREAD_SLOTS] = { NULL };
+    uint32_t seed = t->seed;
+    pthread_barrier_wait(t->start);
+    for(size_t op = 0; op < BENCH_THREAD_OPS; op++) {
+        uint32_t r = bench_rand(&seed);
+        size_t slot = r % BENCH_THREAD_SLOTS;
+        uint32_t stamp = t->seed ^ (uint32_t)slot;
+        if(live[slot]) {
+            if(*live[slot] != stamp)
+                t->corrupted++;
+            t->release(live[slot]);
+            live[slot] = NULL;
+        } else {
+            live[slot] = t->alloc(sizeof(uint32_t) +
+                                  (r >> 16) % BENCH_THREAD_MAX_B);
+            if(live[slot])
+                *live[slot] = stamp;
+        }
+    }
+    for(size_t slot = 0; slot < BENCH_THREAD_SLOTS; slot++)
+        if(live[slot])
+            t->release(live[slot]);
+    return NULL;
+}
+
+/**
+ * @brief Runs the churn on the given number of threads at once. Returns total
+ * operations per second; *corrupted receives the number of bad stamps.
+ */
+static double bench_threads_run(bench_alloc_fn alloc, bench_free_fn release,
+                                size_t threads, size_t* corrupted) {
+    static struct bench_thread workers[BENCH_THREADS_MAX];
+    pthread_barrier_t start;
+    size_t started = 0;
+    pthread_barrier_init(&start, NULL, (unsigned)threads + 1);
+    for(; started < threads; started++) {
+        struct bench_thread* t = &workers[started];
+        t->start = &start;
+        t->alloc = alloc;
+        t->release = release;
+        t->seed = 0x6A09E667u + 0x9E3779B9u * (uint32_t)started;
+        t->corrupted = 0;
+        if(pthread_create(&t->id, NULL, bench_thread_churn, t) != 0)
+            break;
+    }
+    if(started < threads) {
+        /* The barrier can never open; bail out rather than hang */
+        PRINTF("bench_reserve_threads: could not start %zu threads\n", threads);
+        exit(1);
+    }
+    pthread_barrier_wait(&start);
+    uint64_t begin = bench_now_ns();
+    *corrupted = 0;
+    for(size_t i = 0; i < threads; i++) {
+        pthread_join(workers[i].id, NULL);
+        *corrupted += workers[i].corrupted;
+    }
+    uint64_t ns = bench_now_ns() - begin;
+    pthread_barrier_destroy(&start);
+    return (double)threads * BENCH_THREAD_OPS * 1e9 / (double)ns;
+}
+
+void bench_reserve_threads(void) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t max = cpus > BENCH_THREADS_MIN ? (size_t)cpus : BENCH_THREADS_MIN;
+    if(max > BENCH_THREADS_MAX)
+        max = BENCH_THREADS_MAX;
+
+    PRINTF("\nbench_reserve_threads() - Mops/s, %d ops per thread over %d "
+           "slots, up to %d B\n", BENCH_THREAD_OPS, BENCH_THREAD_SLOTS,
+           BENCH_THREAD_MAX_B);
+    PRINTF("(%ld CPUs online; scaling stops there)\n", cpus);
+    PRINTF("%8s | %9s %9s %9s %9s\n", "threads", "reserve", "no cache",
+           "malloc", "corrupt");
+    for(size_t threads = 1; threads <= max; threads *= 2) {
+        size_t bad;
+        size_t corrupted = 0;
+        double cached = bench_threads_run(bench_reserve_bytes,
+                                          bench_free_bytes, threads, &bad);
+        corrupted += bad;
+        mem_pool_thread_cache(0);
+        double locked = bench_threads_run(bench_reserve_bytes,
+                                          bench_free_bytes, threads, &bad);
+        mem_pool_thread_cache(1);
+        corrupted += bad;
+        double libc = bench_threads_run(malloc, free, threads, &bad);
+        corrupted += bad;
+        PRINTF("%8zu | %9.1f %9.1f %9.1f %9zu\n", threads, cached / 1e6,
+               locked / 1e6, libc / 1e6, corrupted);
+        if(threads < max && threads * 2 > max)
+            threads = max / 2;
+    }
+}
+
+void bench(void) {
+    PRINTF("--------------------------------\n");
+    PRINTF("Benchmarks:\n");
+    bench_memmove();
+    bench_memory_isa();
+    bench_memcopy_v();
+    bench_reverse();
+    bench_search();
+    bench_strided();
+    bench_transpose();
+    bench_memset_stream();
+    bench_memset_pattern();
+    bench_checksum();
+    bench_compress();
+    bench_sort();
+    bench_stats();
+    bench_summary();
+    bench_select();
+    bench_huge_pages();
+    bench_reserve_words();
+    bench_reserve_threads();
+    bench_tlsf_churn();
+    PRINTF("--------------------------------\n");
+}
@@ -0,0 +1,339 @@
+/******************************************************************************
+ * Copyright (C) 2024 by Hatem Alamir
+ *
+ * Redistribution, modification or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of embedded
+ * software. Hatem Alamir is not liable for any misuse of this material.
+ *
+ *****************************************************************************/
+/**
+ * @file checksum.c
+ * @brief CRC32, CRC32C and Fletcher-64 over memory buffers
+ *
+ * Both CRCs are kept bit-reflected, the way they go over the wire, so the
+ * lowest bit of the state is the coefficient of x^31. The functions
+ * condition the state (invert it) on entry and exit; everything in between
+ * works on the raw state, which is linear in the data. That is what lets the
+ * combine functions and the interleaved SSE4.2 loop merge partial results by
+ * multiplying with a power of x modulo the polynomial.
+ *
+ * @author Hatem Alamir
+ * @date December 20 2024
+ *
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include "checksum.h"
+#include "memory.h"
+#include "mem_lock.h"
+
+/* The crc32 instruction and the carry-less multiply that merges its streams
+ * are only used on x86-64 hosts */
+#if defined(HOST) && defined(__GNUC__) && defined(__x86_64__)
+#define CHECKSUM_SSE42
+#include <immintrin.h>
+#endif
+
+#define CRC32_POLY      (0xEDB88320U)   /* IEEE 802.3, reflected */
+#define CRC32C_POLY     (0x82F63B78U)   /* Castagnoli, reflected */
+/* x^0 in the reflected representation */
+#define CRC_X0          (0x80000000U)
+
+#define FLETCHER_MOD    (0xFFFFFFFFULL)
+/* Words summed between reductions. After n words the second sum is below
+ * 2^32 * n^2, which stays clear of 2^64 for n = 2^13. */
+#define FLETCHER_BLOCK  (8192)
+
+typedef uint64_t __attribute__((__may_alias__, __aligned__(1))) crc_u64_t;
+typedef uint32_t __attribute__((__may_alias__, __aligned__(1))) crc_u32_t;
+
+/***********************************************************
+ Tables
+***********************************************************/
+/*
+ * table[0][n] is the raw CRC of byte n; table[k][n] that of byte n followed
+ * by k zero bytes, so eight bytes are looked up independently and XORed.
+ */
+static uint32_t crc32_table[CHECKSUM_SLICES][256];
+static uint32_t crc32c_table[CHECKSUM_SLICES][256];
+static int crc_tables_ready;
+static mem_lock_t crc_tables_lock;
+
+static void crc_build_table(uint32_t table[][256], uint32_t poly) {
+    for(uint32_t n = 0; n < 256; n++) {
+        uint32_t c = n;
+        for(int bit = 0; bit < 8; bit++)
+            c = (c >> 1) ^ (poly & (0U - (c & 1)));
+        table[0][n] = c;
+    }
+    for(int k = 1; k < CHECKSUM_SLICES; k++)
+        for(uint32_t n = 0; n < 256; n++)
+            table[k][n] = (table[k - 1][n] >> 8) ^
+                          table[0][table[k - 1][n] & 0xFF];
+}
+
+/*
+ * a * b modulo the polynomial, both reflected. One pass per bit of a, so this
+ * is for the combine functions and set-up, not for data.
+ */
+static uint32_t crc_multmodp(uint32_t a, uint32_t b, uint32_t poly) {
+    uint32_t product = 0;
+    for(uint32_t m = CRC_X0; m; m >>= 1) {
+        if(a & m)
+            product ^= b;
+        b = (b >> 1) ^ (poly & (0U - (b & 1)));
+    }
+    return product;
+}
+
+/* x^n modulo the polynomial, by repeated squaring */
+static uint32_t crc_xnmodp(uint64_t n, uint32_t poly) {
+    uint32_t p = CRC_X0;
+    uint32_t square = CRC_X0 >> 1;    /* x^1 */
+    for(; n; n >>= 1) {
+        if(n & 1)
+            p = crc_multmodp(square, p, poly);
+        square = crc_multmodp(square, square, poly);
+    }
+    return p;
+}
+
+#ifdef CHECKSUM_SSE42
+/* Bytes per stream of the interleaved CRC32C loop */
+#define CRC32C_LANE_B   (512)
+
+/* Set once the tables are built: 1 for crc32, 2 for crc32 and pclmulqdq */
+static int crc32c_hw;
+/* x^(8 * lane - 33) and x^(16 * lane - 33), see crc32c_shift_sse42() */
+static uint64_t crc32c_lane_k1;
+static uint64_t crc32c_lane_k2;
+#endif
+
+static void crc_tables_init(void) {
+    if(__atomic_load_n(&crc_tables_ready, __ATOMIC_ACQUIRE))
+        return;
+    mem_lock(&crc_tables_lock);
+    if(!crc_tables_ready) {
+        crc_build_table(crc32_table, CRC32_POLY);
+        crc_build_table(crc32c_table, CRC32C_POLY);
+#ifdef CHECKSUM_SSE42
+        crc32c_lane_k1 = crc_xnmodp(8 * CRC32C_LANE_B - 33, CRC32C_POLY);
+        crc32c_lane_k2 = crc_xnmodp(16 * CRC32C_LANE_B - 33, CRC32C_POLY);
+        __builtin_cpu_init();
+        if(__builtin_cpu_supports("sse4.2"))
+            crc32c_hw = __builtin_cpu_supports("pclmul") ? 2 : 1;
+#endif
+        __atomic_store_n(&crc_tables_ready, 1, __ATOMIC_RELEASE);
+    }
+    mem_unlock(&crc_tables_lock);
+}
+
+/***********************************************************
+ Kernels
+***********************************************************/
+/*
+ * Raw CRC update. With eight tables, eight bytes are loaded as one
+ * little-endian word (x86 and the M4 alike) and the state folded into its low
+ * half. With copy set, each loaded piece is also stored to dst.
+ */
+static inline __attribute__((always_inline))
+uint32_t crc_update(const uint32_t table[][256], uint32_t crc,
+                    const uint8_t* src, uint8_t* dst, size_t length, int copy) {
+    size_t i = 0;
+#if CHECKSUM_SLICES == 8
+    for(; i + 8 <= length; i += 8) {
+        uint64_t w = *(const crc_u64_t*)(src + i);
+        if(copy)
+            *(crc_u64_t*)(dst + i) = w;
+        w ^= crc;
+        crc = table[7][w & 0xFF] ^ table[6][(w >> 8) & 0xFF] ^
+              table[5][(w >> 16) & 0xFF] ^ table[4][(w >> 24) & 0xFF] ^
+              table[3][(w >> 32) & 0xFF] ^ table[2][(w >> 40) & 0xFF] ^
+              table[1][(w >> 48) & 0xFF] ^ table[0][w >> 56];
+    }
+#endif
+    for(; i < length; i++) {
+        if(copy)
+            dst[i] = src[i];
+        crc = (crc >> 8) ^ table[0][(crc ^ src[i]) & 0xFF];
+    }
+    return crc;
+}
+
+#ifdef CHECKSUM_SSE42
+#pragma GCC push_options
+#pragma GCC target("sse4.2,pclmul")
+
+/*
+ * Raw CRC32C of the state followed by 8 * lane zero bytes, given
+ * k = x^(8 * lane - 33). The 64-bit carry-less product of two reflected
+ * 32-bit values comes out one bit short of a reflected 64-bit value, and the
+ * crc32 instruction multiplies by x^32: together the extra x^33.
+ */
+static inline uint64_t crc32c_shift_sse42(uint32_t crc, uint64_t k) {
+    __m128i product = _mm_clmulepi64_si128(_mm_cvtsi32_si128((int)crc),
+                                           _mm_cvtsi64_si128((long long)k), 0);
+    return (uint64_t)_mm_cvtsi128_si64(product);
+}
+
+/*
+ * The crc32 instruction has a latency of three cycles and a throughput of
+ * one, so three lanes of CRC32C_LANE_B bytes run side by side. The first two
+ * are then moved into place behind the third and folded in, all with one
+ * more crc32.
+ */
+static inline __attribute__((always_inline))
+uint32_t crc32c_update_sse42(uint32_t crc, const uint8_t* src, uint8_t* dst,
+                             size_t length, int copy) {
+    uint64_t c0 = crc;
+    size_t i = 0;
+    if(crc32c_hw > 1) {
+        for(; i + 3 * CRC32C_LANE_B <= length; i += 3 * CRC32C_LANE_B) {
+            const uint8_t* s0 = src + i;
+            uint64_t c1 = 0;
+            uint64_t c2 = 0;
+            for(size_t j = 0; j < CRC32C_LANE_B; j += 8) {
+                uint64_t w0 = *(const crc_u64_t*)(s0 + j);
+                uint64_t w1 = *(const crc_u64_t*)(s0 + CRC32C_LANE_B + j);
+                uint64_t w2 = *(const crc_u64_t*)(s0 + 2 * CRC32C_LANE_B + j);
+                if(copy) {
+                    uint8_t* d0 = dst + i;
+                    *(crc_u64_t*)(d0 + j) = w0;
+                    *(crc_u64_t*)(d0 + CRC32C_LANE_B + j) = w1;
+                    *(crc_u64_t*)(d0 + 2 * CRC32C_LANE_B + j) = w2;
+                }
+                c0 = _mm_crc32_u64(c0, w0);
+                c1 = _mm_crc32_u64(c1, w1);
+                c2 = _mm_crc32_u64(c2, w2);
+            }
+            c0 = c2 ^ _mm_crc32_u64(0, crc32c_shift_sse42((uint32_t)c0,
+                                                          crc32c_lane_k2) ^
+                                       crc32c_shift_sse42((uint32_t)c1,
+                                                          crc32c_lane_k1));
+        }
+    }
+    for(; i + 8 <= length; i += 8) {
+        uint64_t w = *(const crc_u64_t*)(src + i);
+        if(copy)
+            *(crc_u64_t*)(dst + i) = w;
+        c0 = _mm_crc32_u64(c0, w);
+    }
+    crc = (uint32_t)c0;
+    for(; i < length; i++) {
+        if(copy)
+            dst[i] = src[i];
+        crc = _mm_crc32_u8(crc, src[i]);
+    }
+    return crc;
+}
+
+static uint32_t crc32c_sse42(uint32_t crc, const uint8_t* src, size_t length) {
+    return crc32c_update_sse42(crc, src, NULL, length, 0);
+}
+
+static uint32_t crc32c_copy_sse42(uint32_t crc, const uint8_t* src,
+                                  uint8_t* dst, size_t length) {
+    return crc32c_update_sse42(crc, src, dst, length, 1);
+}
+
+#pragma GCC pop_options
+
+/* The scalar tier pins the table code, so both paths can be tested */
+static inline int crc32c_use_hw(void) {
+    return crc32c_hw && memory_active_isa() > MEMORY_ISA_SCALAR;
+}
+#endif
+
+/***********************************************************
+ CRC
+***********************************************************/
+uint32_t checksum_crc32(const uint8_t* src, size_t length, uint32_t crc) {
+    crc_tables_init();
+    return ~crc_update(crc32_table, ~crc, src, NULL, length, 0);
+}
+
+uint32_t checksum_crc32c(const uint8_t* src, size_t length, uint32_t crc) {
+    crc_tables_init();
+#ifdef CHECKSUM_SSE42
+    if(crc32c_use_hw())
+        return ~crc32c_sse42(~crc, src, length);
+#endif
+    return ~crc_update(crc32c_table, ~crc, src, NULL, length, 0);
+}
+
+uint32_t checksum_copy_crc32c(const uint8_t* src, uint8_t* dst, size_t length,
+                              uint32_t crc) {
+    crc_tables_init();
+#ifdef CHECKSUM_SSE42
+    if(crc32c_use_hw())
+        return ~crc32c_copy_sse42(~crc, src, dst, length);
+#endif
+    return ~crc_update(crc32c_table, ~crc, src, dst, length, 1);
+}
+
+/*
+ * The conditioning of the two chunks cancels out, leaving the raw CRC of the
+ * first chunk moved past length2 zero bytes, plus the second.
+ */
+uint32_t checksum_crc32_combine(uint32_t crc1, uint32_t crc2, size_t length2) {
+    return crc_multmodp(crc_xnmodp(8 * (uint64_t)length2, CRC32_POLY), crc1,
+                        CRC32_POLY) ^ crc2;
+}
+
+uint32_t checksum_crc32c_combine(uint32_t crc1, uint32_t crc2,
+                                 size_t length2) {
+    return crc_multmodp(crc_xnmodp(8 * (uint64_t)length2, CRC32C_POLY), crc1,
+                        CRC32C_POLY) ^ crc2;
+}
+
+/***********************************************************
+ Fletcher
+***********************************************************/
+/* Fully reduced modulo 2^32 - 1, so zero is always 0 and never 2^32 - 1 */
+static inline uint64_t fletcher_reduce(uint64_t x) {
+    x = (x & FLETCHER_MOD) + (x >> 32);
+    x = (x & FLETCHER_MOD) + (x >> 32);
+    return x >= FLETCHER_MOD ? x - FLETCHER_MOD : x;
+}
+
+uint64_t checksum_fletcher64(const uint8_t* src, size_t length, uint64_t sum) {
+    uint64_t sum1 = sum & FLETCHER_MOD;
+    uint64_t sum2 = sum >> 32;
+    while(length >= 4) {
+        size_t words = length / 4;
+        if(words > FLETCHER_BLOCK)
+            words = FLETCHER_BLOCK;
+        length -= 4 * words;
+        for(; words; words--, src += 4) {
+            sum1 += *(const crc_u32_t*)src;
+            sum2 += sum1;
+        }
+        sum1 = fletcher_reduce(sum1);
+        sum2 = fletcher_reduce(sum2);
+    }
+    if(length) {
+        uint32_t last = 0;
+        for(size_t i = 0; i < length; i++)
+            last |= (uint32_t)src[i] << (8 * i);
+        sum1 = fletcher_reduce(sum1 + last);
+        sum2 = fletcher_reduce(sum2 + sum1);
+    }
+    return sum2 << 32 | sum1;
+}
+
+/*
+ * Every word of the second chunk adds the first sum of the first chunk to
+ * the second sum once more.
+ */
+uint64_t checksum_fletcher64_combine(uint64_t sum1, uint64_t sum2,
+                                     size_t length2) {
+    uint64_t words = fletcher_reduce(((uint64_t)length2 + 3) / 4);
+    uint64_t first = fletcher_reduce((sum1 & FLETCHER_MOD) +
+                                     (sum2 & FLETCHER_MOD));
+    uint64_t second = fletcher_reduce((sum1 >> 32) + (sum2 >> 32) +
+                                      fletcher_reduce(words *
+                                                      (sum1 & FLETCHER_MOD)));
+    return second << 32 | first;
+}
@@ -0,0 +1,285 @@
+/******************************************************************************
+ * Copyright (C) 2024 by Hatem Alamir
+ *
+ * Redistribution, modification or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of embedded
+ * software. Hatem Alamir is not liable for any misuse of this material.
+ *
+ *****************************************************************************/
+/**
+ * @file compress.c
+ * @brief Delta and run-length codec for byte sample buffers
+ *
+ * The encoder keeps up to 128 differences in its state until it knows
+ * whether they end in a run, which is what lets it stop at any sample when
+ * the output is full. The decoder undoes the differences with a running sum,
+ * 16 bytes at a time on x86 hosts, and writes runs as fills: a run of zero
+ * differences is a repeated sample, anything else a ramp.
+ *
+ * @author Hatem Alamir
+ * @date December 22 2024
+ *
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include "compress.h"
+#include "memory.h"
+
+/* The running sum and ramps use SSE2, which every x86-64 host has */
+#if defined(HOST) && defined(__GNUC__) && defined(__x86_64__)
+#define COMPRESS_SSE2
+#include <emmintrin.h>
+#endif
+
+#define LITERAL_MAX     (128)
+#define RUN_MIN         (3)
+/* Run headers 0x80..0xFE hold lengths RUN_MIN..RUN_SHORT_MAX */
+#define RUN_LONG        (0xFF)
+#define RUN_SHORT_MAX   (RUN_MIN + RUN_LONG - 0x80 - 1)
+
+/***********************************************************
+ Encoder
+***********************************************************/
+static uint8_t* put_literal(uint8_t* dst, uint8_t* literal, size_t count) {
+    if(count) {
+        *dst++ = (uint8_t)(count - 1);
+        my_memcopy(literal, dst, count);
+        dst += count;
+    }
+    return dst;
+}
+
+static uint8_t* put_run(uint8_t* dst, uint8_t step, size_t count) {
+    if(count <= RUN_SHORT_MAX) {
+        *dst++ = (uint8_t)(0x80 + count - RUN_MIN);
+    } else {
+        size_t extra = count - RUN_SHORT_MAX - 1;
+        *dst++ = RUN_LONG;
+        while(extra >= 0x80) {
+            *dst++ = (uint8_t)(extra | 0x80);
+            extra >>= 7;
+        }
+        *dst++ = (uint8_t)extra;
+    }
+    *dst++ = step;
+    return dst;
+}
+
+void memory_compress_init(compress_stream_t* stream) {
+    stream->prev = 0;
+    stream->run_value = 0;
+    stream->run_length = 0;
+    stream->literal_length = 0;
+}
+
+size_t memory_compress_update(compress_stream_t* stream, const uint8_t* src,
+                              size_t length, uint8_t* dst, size_t capacity,
+                              size_t* consumed) {
+    uint8_t* out = dst;
+    size_t taken = 0;
+    uint8_t prev = stream->prev;
+    /* One sample ends at most a run and a full literal, never both */
+    while(taken < length &&
+          capacity - (size_t)(out - dst) >= MEMORY_COMPRESS_TOKEN_MAX) {
+        uint8_t step = (uint8_t)(src[taken] - prev);
+        prev = src[taken++];
+        if(stream->run_length) {
+            if(step == stream->run_value) {
+                stream->run_length++;
+                continue;
+            }
+            out = put_run(out, stream->run_value, stream->run_length);
+            stream->run_length = 0;
+        }
+
+        size_t n = stream->literal_length;
+        stream->literal[n++] = step;
+        if(n >= RUN_MIN && stream->literal[n - 2] == step &&
+           stream->literal[n - 3] == step) {
+            out = put_literal(out, stream->literal, n - RUN_MIN);
+            stream->run_value = step;
+            stream->run_length = RUN_MIN;
+            n = 0;
+        } else if(n == LITERAL_MAX) {
+            out = put_literal(out, stream->literal, n);
+            n = 0;
+        }
+        stream->literal_length = n;
+    }
+    stream->prev = prev;
+    *consumed = taken;
+    return (size_t)(out - dst);
+}
+
+size_t memory_compress_finish(compress_stream_t* stream, uint8_t* dst,
+                              size_t capacity) {
+    uint8_t* out = dst;
+    if(capacity < MEMORY_COMPRESS_TOKEN_MAX)
+        return 0;
+    if(stream->run_length)
+        out = put_run(out, stream->run_value, stream->run_length);
+    out = put_literal(out, stream->literal, stream->literal_length);
+    stream->run_length = 0;
+    stream->literal_length = 0;
+    return (size_t)(out - dst);
+}
+
+size_t memory_compress(const uint8_t* src, size_t length, uint8_t* dst,
+                       size_t capacity) {
+    compress_stream_t stream;
+    size_t consumed;
+    memory_compress_init(&stream);
+    size_t written = memory_compress_update(&stream, src, length, dst,
+                                            capacity, &consumed);
+    if(consumed < length)
+        return 0;
+    size_t tail = memory_compress_finish(&stream, dst + written,
+                                         capacity - written);
+    /* finish only writes nothing when it lacks room, or has nothing left */
+    if(!tail && (stream.run_length || stream.literal_length))
+        return 0;
+    return written + tail;
+}
+
+/***********************************************************
+ Decoder
+***********************************************************/
+#ifdef COMPRESS_SSE2
+/* Byte 15 of x in every byte */
+static inline __m128i broadcast_last(__m128i x) {
+    __m128i t = _mm_unpackhi_epi8(x, x);
+    t = _mm_shufflehi_epi16(t, 0xFF);
+    return _mm_unpackhi_epi64(t, t);
+}
+#endif
+
+/**
+ * @brief Writes the running sum of count differences, starting from prev
+ *
+ * dst may be below src in the same buffer: each block is loaded before
+ * anything at or past it is stored.
+ *
+ * @return the last sample written
+ */
+static uint8_t delta_sum(const uint8_t* src, uint8_t* dst, size_t count,
+                         uint8_t prev) {
+    size_t i = 0;
+#ifdef COMPRESS_SSE2
+    if(count >= 16 && memory_active_isa() > MEMORY_ISA_SCALAR) {
+        __m128i sum = _mm_set1_epi8((char)prev);
+        for(; i + 16 <= count; i += 16) {
+            /* Prefix sum within the block in four shifted adds */
+            __m128i x = _mm_loadu_si128((const __m128i*)(src + i));
+            x = _mm_add_epi8(x, _mm_slli_si128(x, 1));
+            x = _mm_add_epi8(x, _mm_slli_si128(x, 2));
+            x = _mm_add_epi8(x, _mm_slli_si128(x, 4));
+            x = _mm_add_epi8(x, _mm_slli_si128(x, 8));
+            x = _mm_add_epi8(x, sum);
+            _mm_storeu_si128((__m128i*)(dst + i), x);
+            sum = broadcast_last(x);
+        }
+        prev = (uint8_t)_mm_cvtsi128_si32(sum);
+    }
+#endif
+    for(; i < count; i++)
+        dst[i] = prev = (uint8_t)(prev + src[i]);
+    return prev;
+}
+
+/**
+ * @brief Writes count samples that each add step to the one before
+ *
+ * @return the last sample written
+ */
+static uint8_t delta_fill(uint8_t* dst, size_t count, uint8_t prev,
+                          uint8_t step) {
+    size_t i = 0;
+    if(!step) {
+        my_memset(dst, count, prev);
+        return prev;
+    }
+#ifdef COMPRESS_SSE2
+    if(count >= 16 && memory_active_isa() > MEMORY_ISA_SCALAR) {
+        uint8_t ramp[16];
+        for(int k = 0; k < 16; k++)
+            ramp[k] = (uint8_t)(prev + (k + 1) * step);
+        __m128i x = _mm_loadu_si128((const __m128i*)ramp);
+        __m128i inc = _mm_set1_epi8((char)(16 * step));
+        for(; i + 16 <= count; i += 16) {
+            _mm_storeu_si128((__m128i*)(dst + i), x);
+            x = _mm_add_epi8(x, inc);
+        }
+        prev = (uint8_t)(prev + i * step);
+    }
+#endif
+    for(; i < count; i++)
+        dst[i] = prev = (uint8_t)(prev + step);
+    return prev;
+}
+
+/*
+ * In place, src is inside dst and a run may only write up to where the next
+ * token starts, so the output never overtakes the input. A literal is one
+ * byte longer than what it writes, so it cannot overtake it either.
+ */
+static size_t decode(const uint8_t* src, size_t length, uint8_t* dst,
+                     size_t capacity, int in_place) {
+    const uint8_t* in = src;
+    const uint8_t* end = src + length;
+    uint8_t* out = dst;
+    uint8_t* out_end = dst + capacity;
+    uint8_t prev = 0;
+    while(in < end) {
+        uint8_t head = *in++;
+        size_t count;
+        if(head < 0x80) {
+            count = (size_t)head + 1;
+            if(count > (size_t)(end - in))
+                return 0;
+            if(count > (size_t)(out_end - out))
+                return 0;
+            prev = delta_sum(in, out, count, prev);
+            in += count;
+        } else {
+            if(head < RUN_LONG) {
+                count = (size_t)head - 0x80 + RUN_MIN;
+            } else {
+                size_t extra = 0;
+                uint8_t byte;
+                unsigned shift = 0;
+                do {
+                    if(in == end || shift >= 8 * sizeof(size_t))
+                        return 0;
+                    byte = *in++;
+                    extra |= (size_t)(byte & 0x7F) << shift;
+                    shift += 7;
+                } while(byte & 0x80);
+                if(extra > SIZE_MAX - RUN_SHORT_MAX - 1)
+                    return 0;
+                count = extra + RUN_SHORT_MAX + 1;
+            }
+            if(in == end)
+                return 0;
+            uint8_t step = *in++;
+            uint8_t* limit = in_place ? (uint8_t*)in : out_end;
+            if(count > (size_t)(limit - out))
+                return 0;
+            prev = delta_fill(out, count, prev, step);
+        }
+        out += count;
+    }
+    return (size_t)(out - dst);
+}
+
+size_t memory_decompress(const uint8_t* src, size_t length, uint8_t* dst,
+                         size_t capacity) {
+    return decode(src, length, dst, capacity, 0);
+}
+
+size_t memory_decompress_in_place(uint8_t* buf, size_t size, size_t length) {
+    if(length > size)
+        return 0;
+    return decode(buf + size - length, length, buf, size, 1);
+}
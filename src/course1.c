@@ -18,11 +18,18 @@
  */
 
 #include <stdint.h>
+#include <errno.h>
+#include <limits.h>
 #include "course1.h"
 #include "platform.h"
 #include "memory.h"
 #include "data.h"
 #include "stats.h"
+#include "mem_pool.h"
+#include "tlsf.h"
+#include "arena.h"
+#include "checksum.h"
+#include "compress.h"
 
 int8_t test_data1() {
   uint8_t * ptr;
@@ -201,6 +208,462 @@ int8_t test_memmove3() {
 
 }
 
+int8_t test_memmove4() {
+  uint32_t i;
+  size_t len;
+  int8_t ret = TEST_NO_ERROR;
+  uint8_t * set;
+  uint8_t * ref;
+  uint8_t * tmp;
+  uint8_t src;
+  uint8_t dst;
+
+  PRINTF("test_memmove4() - LENGTH AND ALIGNMENT SWEEP\n");
+  set = (uint8_t*) reserve_words(3 * TEST_SWEEP_SIZE_B / sizeof(int32_t));
+
+  if (! set )
+  {
+    return TEST_ERROR;
+  }
+  ref = set + TEST_SWEEP_SIZE_B;
+  tmp = ref + TEST_SWEEP_SIZE_B;
+
+  for (len = 0; len <= TEST_SWEEP_SIZE_B / 2; len++)
+  {
+    for (src = 0; src < 40; src += 3)
+    {
+      for (dst = 0; dst < 40; dst += 5)
+      {
+        for (i = 0; i < TEST_SWEEP_SIZE_B; i++)
+        {
+          set[i] = ref[i] = (uint8_t)(i * 7 + 1);
+        }
+        /* Reference: stage through tmp so overlap cannot matter */
+        for (i = 0; i < len; i++)
+        {
+          tmp[i] = ref[src + i];
+        }
+        for (i = 0; i < len; i++)
+        {
+          ref[dst + i] = tmp[i];
+        }
+        my_memmove(set + src, set + dst, len);
+        for (i = 0; i < TEST_SWEEP_SIZE_B; i++)
+        {
+          if (set[i] != ref[i])
+          {
+            ret = TEST_ERROR;
+          }
+        }
+      }
+    }
+  }
+
+  free_words( (uint32_t*)set );
+  return ret;
+}
+
+int8_t test_memory_isa() {
+  uint32_t i;
+  size_t len;
+  int8_t ret = TEST_NO_ERROR;
+  uint8_t * set;
+  uint8_t * ref;
+  uint8_t off;
+  memory_isa_t isa;
+  memory_isa_t saved = memory_active_isa();
+
+  PRINTF("test_memory_isa()\n");
+  set = (uint8_t*) reserve_words(2 * TEST_SWEEP_SIZE_B / sizeof(int32_t));
+
+  if (! set )
+  {
+    return TEST_ERROR;
+  }
+  ref = set + TEST_SWEEP_SIZE_B;
+
+  for (isa = MEMORY_ISA_SCALAR; isa <= memory_best_isa(); isa++)
+  {
+    memory_select_isa(isa);
+    #ifdef VERBOSE
+    PRINTF("  %s\n", memory_isa_name(isa));
+    #endif
+    for (len = 0; len <= TEST_SWEEP_SIZE_B / 4; len++)
+    {
+      for (off = 0; off < 64; off += 13)
+      {
+        /* memcopy from the lower half into the upper half */
+        for (i = 0; i < TEST_SWEEP_SIZE_B; i++)
+        {
+          set[i] = ref[i] = (uint8_t)(i * 11 + 3);
+        }
+        for (i = 0; i < len; i++)
+        {
+          ref[TEST_SWEEP_SIZE_B / 2 + off / 2 + i] = ref[off + i];
+        }
+        my_memcopy(set + off, set + TEST_SWEEP_SIZE_B / 2 + off / 2, len);
+
+        /* memset over the first half */
+        my_memset(set + off / 4, len / 2, (uint8_t)len);
+        for (i = 0; i < len / 2; i++)
+        {
+          ref[off / 4 + i] = (uint8_t)len;
+        }
+
+        /* reverse across the middle */
+        my_reverse(set + off, len);
+        for (i = 0; i < len / 2; i++)
+        {
+          uint8_t tmp = ref[off + i];
+          ref[off + i] = ref[off + len - 1 - i];
+          ref[off + len - 1 - i] = tmp;
+        }
+
+        for (i = 0; i < TEST_SWEEP_SIZE_B; i++)
+        {
+          if (set[i] != ref[i])
+          {
+            ret = TEST_ERROR;
+          }
+        }
+      }
+    }
+    if (test_memmove4() != TEST_NO_ERROR)
+    {
+      ret = TEST_ERROR;
+    }
+
+    /* reverse alone at lengths that reach the unrolled loops of every tier */
+    for (len = 0; len <= 2 * TEST_SWEEP_SIZE_B - 64; len++)
+    {
+      for (off = 0; off < 64; off += 21)
+      {
+        for (i = 0; i < 2 * TEST_SWEEP_SIZE_B; i++)
+        {
+          set[i] = (uint8_t)(i * 7 + 1);
+        }
+        my_reverse(set + off, len);
+        for (i = 0; i < 2 * TEST_SWEEP_SIZE_B; i++)
+        {
+          uint32_t from = (i >= off && i < off + len) ? 2 * off + len - 1 - i : i;
+          if (set[i] != (uint8_t)(from * 7 + 1))
+          {
+            ret = TEST_ERROR;
+          }
+        }
+      }
+    }
+  }
+
+  memory_select_isa(saved);
+  free_words( (uint32_t*)set );
+  return ret;
+}
+
+int8_t test_memset_stream() {
+  uint32_t i;
+  size_t len;
+  int8_t ret = TEST_NO_ERROR;
+  uint8_t * set;
+  uint8_t off;
+  memory_isa_t isa;
+  memory_isa_t saved = memory_active_isa();
+  size_t threshold = memory_set_stream_threshold(1);
+
+  PRINTF("test_memset_stream()\n");
+  set = (uint8_t*) reserve_words(TEST_SWEEP_SIZE_B / sizeof(int32_t));
+
+  if (! set )
+  {
+    memory_set_stream_threshold(threshold);
+    return TEST_ERROR;
+  }
+
+  for (isa = MEMORY_ISA_SCALAR; isa <= memory_best_isa(); isa++)
+  {
+    memory_select_isa(isa);
+    for (len = 0; len <= TEST_SWEEP_SIZE_B / 2; len++)
+    {
+      for (off = 0; off < 64; off += 7)
+      {
+        for (i = 0; i < TEST_SWEEP_SIZE_B; i++)
+        {
+          set[i] = 0x55;
+        }
+        my_memset(set + off, len, 0xAA);
+        my_memzero(set + off + len / 2, len / 4);
+        for (i = 0; i < TEST_SWEEP_SIZE_B; i++)
+        {
+          uint8_t expected = 0x55;
+          if (i >= off && i < off + len)
+          {
+            expected = 0xAA;
+          }
+          if (i >= off + len / 2 && i < off + len / 2 + len / 4)
+          {
+            expected = 0;
+          }
+          if (set[i] != expected)
+          {
+            ret = TEST_ERROR;
+          }
+        }
+      }
+    }
+  }
+
+  memory_select_isa(saved);
+  memory_set_stream_threshold(threshold);
+  free_words( (uint32_t*)set );
+  return ret;
+}
+
+int8_t test_reserve_pool() {
+  uint32_t i;
+  uint32_t j;
+  int8_t ret = TEST_NO_ERROR;
+  uint8_t * blocks[TEST_POOL_BLOCKS];
+  size_t words[TEST_POOL_BLOCKS];
+  uint8_t * big;
+
+  PRINTF("test_reserve_pool()\n");
+  for (i = 0; i < TEST_POOL_BLOCKS; i++)
+  {
+    /* Cycle through the classes, landing on and just past each boundary */
+    words[i] = ((MEM_POOL_MIN_BLOCK << (i % MEM_POOL_CLASS_COUNT))
+                / sizeof(int32_t)) - (i & 1);
+    blocks[i] = (uint8_t*) reserve_words(words[i]);
+    if (! blocks[i] || ! mem_pool_owns(blocks[i]) ||
+        ((uintptr_t)blocks[i] % MEM_POOL_MIN_BLOCK) != 0)
+    {
+      ret = TEST_ERROR;
+      words[i] = 0;
+      continue;
+    }
+    my_memset(blocks[i], words[i] * sizeof(int32_t), (uint8_t)i);
+  }
+
+  for (i = 0; i < TEST_POOL_BLOCKS; i++)
+  {
+    for (j = 0; j < words[i] * sizeof(int32_t); j++)
+    {
+      if (blocks[i][j] != (uint8_t)i)
+      {
+        ret = TEST_ERROR;
+      }
+    }
+  }
+
+  for (i = 0; i < TEST_POOL_BLOCKS; i++)
+  {
+    free_words( (uint32_t*)blocks[i] );
+  }
+  /* Freed blocks are recycled last in, first out */
+  blocks[0] = (uint8_t*) reserve_words(words[TEST_POOL_BLOCKS - 1]);
+  if (blocks[0] != blocks[TEST_POOL_BLOCKS - 1])
+  {
+    ret = TEST_ERROR;
+  }
+  free_words( (uint32_t*)blocks[0] );
+
+  big = (uint8_t*) reserve_words(MEM_POOL_MAX_BLOCK / sizeof(int32_t) + 1);
+  if (! big || mem_pool_owns(big))
+  {
+    ret = TEST_ERROR;
+  }
+  free_words( (uint32_t*)big );
+  return ret;
+}
+
+int8_t test_thread_cache() {
+  uint32_t i;
+  uint32_t round;
+  int8_t ret = TEST_NO_ERROR;
+  uint32_t * blocks[TEST_CACHE_BLOCKS];
+
+  PRINTF("test_thread_cache()\n");
+  for (round = 0; round < 2; round++)
+  {
+    for (i = 0; i < TEST_CACHE_BLOCKS; i++)
+    {
+      blocks[i] = (uint32_t*) reserve_words(TEST_CACHE_SIZE_B / sizeof(int32_t));
+      if (! blocks[i] || ! mem_pool_owns(blocks[i]))
+      {
+        ret = TEST_ERROR;
+        blocks[i] = NULL;
+        continue;
+      }
+      *blocks[i] = i;
+    }
+    for (i = 0; i < TEST_CACHE_BLOCKS; i++)
+    {
+      if (blocks[i] && *blocks[i] != i)
+      {
+        ret = TEST_ERROR;
+      }
+    }
+    for (i = 0; i < TEST_CACHE_BLOCKS; i++)
+    {
+      free_words(blocks[i]);
+    }
+  }
+
+#ifdef MEM_POOL_TCACHE
+  mem_pool_thread_flush();
+#endif
+  return ret;
+}
+
+int8_t test_tlsf() {
+  static uint8_t region[TEST_TLSF_SIZE_B];
+  uint32_t i;
+  uint32_t j;
+  int8_t ret = TEST_NO_ERROR;
+  tlsf_t tlsf;
+  struct tlsf_stats before;
+  struct tlsf_stats after;
+  uint8_t * blocks[TEST_TLSF_BLOCKS];
+  uint8_t * big;
+
+  PRINTF("test_tlsf()\n");
+  if (tlsf_init(&tlsf, region, sizeof(region)) != 0)
+  {
+    return TEST_ERROR;
+  }
+  tlsf_stats(&tlsf, &before);
+
+  for (i = 0; i < TEST_TLSF_BLOCKS; i++)
+  {
+    blocks[i] = (uint8_t*) tlsf_malloc(&tlsf, 1 + i * 23);
+    if (! blocks[i] || ((uintptr_t)blocks[i] % TLSF_ALIGN) != 0 ||
+        tlsf_block_size(blocks[i]) < 1 + i * 23)
+    {
+      return TEST_ERROR;
+    }
+    my_memset(blocks[i], 1 + i * 23, (uint8_t)i);
+  }
+  for (i = 0; i < TEST_TLSF_BLOCKS; i++)
+  {
+    for (j = 0; j < 1 + i * 23; j++)
+    {
+      if (blocks[i][j] != (uint8_t)i)
+      {
+        ret = TEST_ERROR;
+      }
+    }
+  }
+  if (tlsf_malloc(&tlsf, TEST_TLSF_SIZE_B) != NULL)
+  {
+    ret = TEST_ERROR;
+  }
+
+  /* Odd blocks first so the even ones merge with both neighbours */
+  for (i = 1; i < TEST_TLSF_BLOCKS; i += 2)
+  {
+    tlsf_free(&tlsf, blocks[i]);
+  }
+  for (i = 0; i < TEST_TLSF_BLOCKS; i += 2)
+  {
+    tlsf_free(&tlsf, blocks[i]);
+  }
+  tlsf_stats(&tlsf, &after);
+  if (after.free_blocks != 1 || after.used_blocks != 0 ||
+      after.largest_free != before.largest_free)
+  {
+    ret = TEST_ERROR;
+  }
+
+  big = (uint8_t*) reserve_bytes(3 * MEM_POOL_MAX_BLOCK + 1);
+  if (! big || mem_pool_owns(big))
+  {
+    ret = TEST_ERROR;
+  }
+  else
+  {
+    my_memset(big, 3 * MEM_POOL_MAX_BLOCK + 1, 0x5A);
+  }
+  free_bytes(big);
+  return ret;
+}
+
+int8_t test_arena() {
+  uint8_t i;
+  int8_t ret = TEST_NO_ERROR;
+  static uint8_t block[TEST_ARENA_SIZE_B];
+  uint8_t set[MEM_SET_SIZE_B];
+  arena_t arena;
+  arena_mark_t mark;
+  uint8_t * a;
+  uint8_t * b;
+  uint8_t * str;
+  stats_histogram_t * hist;
+
+  PRINTF("test_arena()\n");
+  arena_init(&arena, block, sizeof(block));
+
+  a = (uint8_t*) arena_alloc(&arena, 3, 1);
+  b = (uint8_t*) arena_alloc(&arena, 8, 16);
+  if (! a || ! b || ((uintptr_t)b % 16) != 0 || b < a + 3)
+  {
+    ret = TEST_ERROR;
+  }
+
+  mark = arena_mark(&arena);
+  a = (uint8_t*) arena_alloc(&arena, 40, 0);
+  arena_rewind(&arena, mark);
+  if (arena_alloc(&arena, 40, 0) != a)
+  {
+    ret = TEST_ERROR;
+  }
+  if (arena_alloc(&arena, TEST_ARENA_SIZE_B, 1) != NULL)
+  {
+    ret = TEST_ERROR;
+  }
+  arena_reset(&arena);
+  if (arena_remaining(&arena) != TEST_ARENA_SIZE_B)
+  {
+    ret = TEST_ERROR;
+  }
+
+  str = my_itoa_alloc(-4096, BASE_16, &arena);
+  if (! str || my_atoi(str, 6, BASE_16) != -4096)
+  {
+    ret = TEST_ERROR;
+  }
+
+  /* The histogram goes in the arena, which gets it back afterwards, and
+   * the input is only read */
+  for (i = 0; i < MEM_SET_SIZE_B; i++)
+  {
+    set[i] = i;
+  }
+  mark = arena_mark(&arena);
+  print_statistics_ex(set, MEM_SET_SIZE_B, &arena);
+  if (arena_mark(&arena) != mark)
+  {
+    ret = TEST_ERROR;
+  }
+  /* the same request lands where print_statistics_ex() built it */
+  hist = (stats_histogram_t*) arena_alloc(&arena, sizeof(*hist), 0);
+  if (! hist || hist->length != MEM_SET_SIZE_B ||
+      hist->counts[0] != 1 || hist->counts[MEM_SET_SIZE_B - 1] != 1 ||
+      hist->counts[MEM_SET_SIZE_B] != 0)
+  {
+    ret = TEST_ERROR;
+  }
+  arena_rewind(&arena, mark);
+  for (i = 0; i < MEM_SET_SIZE_B; i++)
+  {
+    if (set[i] != i)
+    {
+      ret = TEST_ERROR;
+    }
+  }
+
+  arena_destroy(&arena);
+  return ret;
+}
+
 int8_t test_memcopy() {
   uint8_t i;
   int8_t ret = TEST_NO_ERROR;
@@ -321,6 +784,1632 @@ int8_t test_reverse()
   return ret;
 }
 
+/* Index of the byte a bswap16 (0), bswap32 (1) or word reverse (2) of bytes
+ * bytes starting at 0 reads for output byte k */
+static uint32_t test_bswap_source(uint8_t op, uint32_t k, uint32_t bytes)
+{
+  if (op == 0)
+  {
+    return k ^ 1;
+  }
+  if (op == 1)
+  {
+    return k ^ 3;
+  }
+  return bytes - 4 - (k & ~3U) + (k & 3);
+}
+
+int8_t test_bswap()
+{
+  uint32_t i;
+  uint32_t bytes;
+  uint8_t op;
+  uint8_t off;
+  uint8_t copy;
+  int8_t ret = TEST_NO_ERROR;
+  uint8_t * set;
+  uint8_t * src;
+  uint8_t * dst;
+  memory_isa_t isa;
+  memory_isa_t saved = memory_active_isa();
+
+  PRINTF("test_bswap()\n");
+  set = (uint8_t*) reserve_words(TEST_BSWAP_SIZE_B / sizeof(int32_t));
+  if (! set )
+  {
+    return TEST_ERROR;
+  }
+
+  for (isa = MEMORY_ISA_SCALAR; isa <= memory_best_isa(); isa++)
+  {
+    memory_select_isa(isa);
+    for (op = 0; op < 3; op++)
+    {
+      for (bytes = 0; bytes <= TEST_BSWAP_SIZE_B / 2 - 64; bytes += op ? 4 : 2)
+      {
+        for (off = 0; off < 8; off += 3)
+        {
+          for (copy = 0; copy < 2; copy++)
+          {
+            for (i = 0; i < TEST_BSWAP_SIZE_B; i++)
+            {
+              set[i] = (uint8_t)(i * 7 + 1);
+            }
+            src = set + off;
+            dst = copy ? set + TEST_BSWAP_SIZE_B / 2 + off / 2 : src;
+            if (op == 0 && copy)
+            {
+              my_bswap16_array_copy(src, dst, bytes / 2);
+            }
+            else if (op == 0)
+            {
+              my_bswap16_array(src, bytes / 2);
+            }
+            else if (op == 1 && copy)
+            {
+              my_bswap32_array_copy(src, dst, bytes / 4);
+            }
+            else if (op == 1)
+            {
+              my_bswap32_array(src, bytes / 4);
+            }
+            else if (copy)
+            {
+              my_reverse_words_copy(src, dst, bytes / 4);
+            }
+            else
+            {
+              my_reverse_words(src, bytes / 4);
+            }
+
+            for (i = 0; i < TEST_BSWAP_SIZE_B; i++)
+            {
+              uint32_t from = i;
+              if (set + i >= dst && set + i < dst + bytes)
+              {
+                from = off + test_bswap_source(op, (uint32_t)(set + i - dst),
+                                               bytes);
+              }
+              if (set[i] != (uint8_t)(from * 7 + 1))
+              {
+                ret = TEST_ERROR;
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+
+  memory_select_isa(saved);
+  free_words( (uint32_t*)set );
+  return ret;
+}
+
+int8_t test_search()
+{
+  uint32_t i;
+  uint32_t len;
+  uint32_t hit;
+  uint32_t n;
+  int8_t ret = TEST_NO_ERROR;
+  uint8_t * set;
+  uint8_t * other;
+  uint8_t * needle;
+  memory_isa_t isa;
+  memory_isa_t saved = memory_active_isa();
+
+  PRINTF("test_search()\n");
+  set = (uint8_t*) reserve_words(3 * TEST_SEARCH_SIZE_B / sizeof(int32_t));
+  if (! set )
+  {
+    return TEST_ERROR;
+  }
+  other = set + TEST_SEARCH_SIZE_B;
+  needle = other + TEST_SEARCH_SIZE_B;
+
+  for (isa = MEMORY_ISA_SCALAR; isa <= memory_best_isa(); isa++)
+  {
+    memory_select_isa(isa);
+    for (len = 0; len <= TEST_SEARCH_SIZE_B - 8; len += (len < 160) ? 1 : 7)
+    {
+      /* 0xFF never occurs in the background, which stays below 0xF0 */
+      for (i = 0; i < TEST_SEARCH_SIZE_B; i++)
+      {
+        set[i] = other[i] = (uint8_t)((i * 13 + 5) % 0xF0);
+      }
+      if (my_memchr(set + 3, 0xFF, len) || my_memrchr(set + 3, 0xFF, len) ||
+          my_memcmp(set + 3, other + 3, len) != 0)
+      {
+        ret = TEST_ERROR;
+      }
+
+      for (hit = 0; hit < len / 2; hit += 1 + hit / 4)
+      {
+        /* two occurrences: the first and last ones must be told apart */
+        set[3 + hit] = 0xFF;
+        set[3 + len - 1 - hit] = 0xFF;
+        if (my_memchr(set + 3, 0xFF, len) != set + 3 + hit ||
+            my_memrchr(set + 3, 0xFF, len) != set + 3 + len - 1 - hit)
+        {
+          ret = TEST_ERROR;
+        }
+        set[3 + len - 1 - hit] = other[3 + len - 1 - hit];
+        if (my_memcmp(set + 3, other + 3, len) <= 0 ||
+            my_memcmp(other + 3, set + 3, len) >= 0)
+        {
+          ret = TEST_ERROR;
+        }
+        set[3 + hit] = other[3 + hit];
+      }
+
+      /* needles copied from the buffer, with near misses in front that
+       * share their first and last byte */
+      for (n = 1; n <= 24 && n <= len; n += 3)
+      {
+        hit = (len - n) * 3 / 4;
+        for (i = 0; i < n; i++)
+        {
+          needle[i] = (uint8_t)(0xF0 + (i % 15));
+        }
+        for (i = 0; i + n <= hit; i += n + 1)
+        {
+          my_memcopy(needle, set + 3 + i, n);
+          if (n > 2)
+          {
+            set[3 + i + n / 2] = 0xFF;
+          }
+          else
+          {
+            set[3 + i] = 0xFF;
+          }
+        }
+        my_memcopy(needle, set + 3 + hit, n);
+        if (my_memmem(set + 3, len, needle, n) != set + 3 + hit)
+        {
+          ret = TEST_ERROR;
+        }
+        needle[n - 1] = 0xFF;
+        if (n > 1 && my_memmem(set + 3, len, needle, n) != NULL)
+        {
+          ret = TEST_ERROR;
+        }
+        my_memcopy(other, set, TEST_SEARCH_SIZE_B);
+      }
+    }
+  }
+
+  memory_select_isa(saved);
+  free_words( (uint32_t*)set );
+  return ret;
+}
+
+int8_t test_strided()
+{
+  uint32_t i;
+  uint32_t j;
+  uint32_t stride;
+  uint32_t count;
+  int8_t ret = TEST_NO_ERROR;
+  char * set;
+  char * vals;
+  char expected;
+  unsigned int indices[TEST_GATHER_COUNT];
+  memory_isa_t isa;
+  memory_isa_t saved = memory_active_isa();
+
+  PRINTF("test_strided()\n");
+  set = (char*) reserve_words(2 * TEST_STRIDED_SIZE_B / sizeof(int32_t));
+  if (! set )
+  {
+    return TEST_ERROR;
+  }
+  vals = set + TEST_STRIDED_SIZE_B;
+
+  for (isa = MEMORY_ISA_SCALAR; isa <= memory_best_isa(); isa++)
+  {
+    memory_select_isa(isa);
+    /* strides 2 to 4 have vector kernels, the others fall back */
+    for (stride = 1; stride <= 6; stride++)
+    {
+      /* elements start one byte in and leave a guard byte at the end */
+      for (count = 0; count * stride < TEST_STRIDED_SIZE_B - 1;
+           count += (count < 160) ? 1 : 5)
+      {
+        for (i = 0; i < TEST_STRIDED_SIZE_B; i++)
+        {
+          set[i] = (char)(i * 7 + 1);
+          vals[i] = (char)0xA5;
+        }
+        get_strided(set + 1, stride, vals, count);
+        for (i = 0; i < TEST_STRIDED_SIZE_B; i++)
+        {
+          expected = i < count ? (char)((1 + i * stride) * 7 + 1) : (char)0xA5;
+          if (vals[i] != expected)
+          {
+            ret = TEST_ERROR;
+          }
+        }
+
+        for (i = 0; i < TEST_STRIDED_SIZE_B; i++)
+        {
+          set[i] = (char)(i * 7 + 1);
+          vals[i] = (char)(i * 3 + 0x80);
+        }
+        set_strided(set + 1, stride, vals, count);
+        for (i = 0; i < TEST_STRIDED_SIZE_B; i++)
+        {
+          expected = (char)(i * 7 + 1);
+          if (i >= 1 && (i - 1) % stride == 0 && (i - 1) / stride < count)
+          {
+            expected = vals[(i - 1) / stride];
+          }
+          if (set[i] != expected)
+          {
+            ret = TEST_ERROR;
+          }
+        }
+      }
+    }
+  }
+  memory_select_isa(saved);
+
+  /* indexes below 61 repeat from the 61st on */
+  for (count = 0; count <= TEST_GATHER_COUNT; count++)
+  {
+    for (i = 0; i < TEST_STRIDED_SIZE_B; i++)
+    {
+      set[i] = (char)(i * 7 + 1);
+      vals[i] = (char)(i * 3 + 0x80);
+    }
+    for (i = 0; i < count; i++)
+    {
+      indices[i] = (i * 37) % 61;
+    }
+    gather(set, indices, vals, count);
+    for (i = 0; i < TEST_STRIDED_SIZE_B; i++)
+    {
+      expected = i < count ? (char)(indices[i] * 7 + 1) : (char)(i * 3 + 0x80);
+      if (vals[i] != expected)
+      {
+        ret = TEST_ERROR;
+      }
+      vals[i] = (char)(i * 3 + 0x80);
+    }
+    scatter(set, indices, vals, count);
+    for (i = 0; i < count; i++)
+    {
+      for (j = i + 1; j < count && indices[j] != indices[i]; j++);
+      if (j == count && set[indices[i]] != vals[i])
+      {
+        ret = TEST_ERROR;
+      }
+    }
+    for (i = 61; i < TEST_STRIDED_SIZE_B; i++)
+    {
+      if (set[i] != (char)(i * 7 + 1))
+      {
+        ret = TEST_ERROR;
+      }
+    }
+  }
+
+  free_words( (uint32_t*)set );
+  return ret;
+}
+
+int8_t test_transpose()
+{
+  static const uint8_t dims[] = { 0, 1, 7, 8, 9, 15, 16, 17, 31, 33, 64, 65,
+                                  TEST_MATRIX_DIM };
+  uint32_t i;
+  uint32_t r;
+  uint32_t c;
+  uint8_t w;
+  uint8_t h;
+  uint8_t width;
+  uint8_t height;
+  uint8_t expected;
+  int8_t ret = TEST_NO_ERROR;
+  uint8_t * src;
+  uint8_t * dst;
+  memory_isa_t isa;
+  memory_isa_t saved = memory_active_isa();
+
+  PRINTF("test_transpose()\n");
+  src = (uint8_t*) reserve_words(2 * TEST_MATRIX_SIZE_B / sizeof(int32_t));
+  if (! src )
+  {
+    return TEST_ERROR;
+  }
+  dst = src + TEST_MATRIX_SIZE_B;
+
+  for (isa = MEMORY_ISA_SCALAR; isa <= memory_best_isa(); isa++)
+  {
+    memory_select_isa(isa);
+    for (w = 0; w < sizeof(dims); w++)
+    {
+      for (h = 0; h < sizeof(dims); h++)
+      {
+        width = dims[w];
+        height = dims[h];
+        for (i = 0; i < TEST_MATRIX_SIZE_B; i++)
+        {
+          src[i] = (uint8_t)(i * 7 + 1);
+          dst[i] = (uint8_t)0xA5;
+        }
+        /* both matrices are windows one row and one column in */
+        my_transpose_u8(src + TEST_MATRIX_PITCH + 1, TEST_MATRIX_PITCH,
+                        dst + TEST_MATRIX_PITCH + 1, TEST_MATRIX_PITCH,
+                        width, height);
+        for (i = 0; i < TEST_MATRIX_SIZE_B; i++)
+        {
+          r = i / TEST_MATRIX_PITCH - 1;
+          c = i % TEST_MATRIX_PITCH - 1;
+          expected = (uint8_t)0xA5;
+          if (i >= TEST_MATRIX_PITCH && i % TEST_MATRIX_PITCH &&
+              r < width && c < height)
+          {
+            expected = (uint8_t)(((c + 1) * TEST_MATRIX_PITCH + r + 1) * 7 + 1);
+          }
+          if (dst[i] != expected)
+          {
+            ret = TEST_ERROR;
+          }
+        }
+
+        my_memcopy_2d(src + TEST_MATRIX_PITCH + 1, TEST_MATRIX_PITCH,
+                      dst + 2, TEST_MATRIX_PITCH - 1, width, height);
+        for (i = 0; i < TEST_MATRIX_SIZE_B - 2; i++)
+        {
+          r = i / (TEST_MATRIX_PITCH - 1);
+          c = i % (TEST_MATRIX_PITCH - 1);
+          if (r < height && c < width &&
+              dst[i + 2] != (uint8_t)(((r + 1) * TEST_MATRIX_PITCH + c + 1) * 7 + 1))
+          {
+            ret = TEST_ERROR;
+          }
+        }
+      }
+    }
+  }
+
+  memory_select_isa(saved);
+  free_words( (uint32_t*)src );
+  return ret;
+}
+
+int8_t test_memcopy_v()
+{
+  uint32_t i;
+  uint32_t k;
+  uint32_t at;
+  int8_t ret = TEST_NO_ERROR;
+  uint8_t * src;
+  uint8_t * dst;
+  struct copy_desc * descs;
+  memory_isa_t isa;
+  memory_isa_t saved = memory_active_isa();
+
+  PRINTF("test_memcopy_v()\n");
+  src = (uint8_t*) reserve_words((TEST_COPYV_SRC_B + TEST_COPYV_DST_B) /
+                                 sizeof(int32_t));
+  descs = reserve_bytes((TEST_COPYV_DESCS + 1) * sizeof(struct copy_desc));
+  if (! src || ! descs )
+  {
+    free_words( (uint32_t*)src );
+    free_bytes(descs);
+    return TEST_ERROR;
+  }
+  dst = src + TEST_COPYV_SRC_B;
+  for (i = 0; i < TEST_COPYV_SRC_B; i++)
+  {
+    src[i] = (uint8_t)(i * 7 + 1);
+  }
+
+  /* every length up to past one AVX-512 vector, then a run across two of
+   * them, packed one guard byte apart */
+  at = 0;
+  for (k = 0; k < TEST_COPYV_DESCS; k++)
+  {
+    descs[k].length = (k <= 72) ? k : 124 + (k - 73);
+    descs[k].src = src + (k * 37) % (TEST_COPYV_SRC_B - 256);
+    descs[k].dst = dst + at;
+    at += descs[k].length + 1;
+  }
+  /* the last copy reads what an earlier one wrote */
+  descs[k].length = descs[1].length;
+  descs[k].src = descs[1].dst;
+  descs[k].dst = dst + at;
+
+  for (isa = MEMORY_ISA_SCALAR; isa <= memory_best_isa(); isa++)
+  {
+    memory_select_isa(isa);
+    for (i = 0; i < TEST_COPYV_DST_B; i++)
+    {
+      dst[i] = 0xA5;
+    }
+    my_memcopy_v(descs, TEST_COPYV_DESCS + 1);
+    for (k = 0; k <= TEST_COPYV_DESCS; k++)
+    {
+      for (i = 0; i < descs[k].length; i++)
+      {
+        if (descs[k].dst[i] != src[descs[k == TEST_COPYV_DESCS ? 1 : k].src -
+                                   src + i])
+        {
+          ret = TEST_ERROR;
+        }
+      }
+      if (descs[k].dst[descs[k].length] != 0xA5)
+      {
+        ret = TEST_ERROR;
+      }
+    }
+  }
+
+  memory_select_isa(saved);
+  free_bytes(descs);
+  free_words( (uint32_t*)src );
+  return ret;
+}
+
+int8_t test_memset_pattern()
+{
+  uint32_t i;
+  size_t len;
+  size_t width;
+  int8_t ret = TEST_NO_ERROR;
+  int stream;
+  uint8_t * set;
+  uint8_t off;
+  uint64_t value;
+  memory_isa_t isa;
+  memory_isa_t saved = memory_active_isa();
+  size_t threshold = memory_set_stream_threshold(0);
+
+  PRINTF("test_memset_pattern()\n");
+  set = (uint8_t*) reserve_bytes(TEST_PATTERN_SIZE_B);
+
+  if (! set )
+  {
+    memory_set_stream_threshold(threshold);
+    return TEST_ERROR;
+  }
+
+  for (isa = MEMORY_ISA_SCALAR; isa <= memory_best_isa(); isa++)
+  {
+    memory_select_isa(isa);
+    for (stream = 0; stream < 2; stream++)
+    {
+      memory_set_stream_threshold(stream);
+      for (width = 2; width <= 8; width *= 2)
+      {
+        value = 0x0123456789ABCDEFULL >> (64 - 8 * width);
+        for (len = 0; len <= TEST_PATTERN_SIZE_B / 2; len += width)
+        {
+          for (off = 0; off < 64; off += 7)
+          {
+            for (i = 0; i < TEST_PATTERN_SIZE_B; i++)
+            {
+              set[i] = 0x55;
+            }
+            if (width == 2)
+            {
+              my_memset16((uint16_t*)(set + off), len / 2, (uint16_t)value);
+            }
+            else if (width == 4)
+            {
+              my_memset32((uint32_t*)(set + off), len / 4, (uint32_t)value);
+            }
+            else
+            {
+              my_memset64((uint64_t*)(set + off), len / 8, value);
+            }
+            for (i = 0; i < off + len + 64; i++)
+            {
+              uint8_t expected = 0x55;
+              if (i >= off && i < off + len)
+              {
+                expected = (uint8_t)(value >> (8 * ((i - off) % width)));
+              }
+              if (set[i] != expected)
+              {
+                ret = TEST_ERROR;
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+
+  memory_select_isa(saved);
+  memory_set_stream_threshold(threshold);
+  free_bytes(set);
+  return ret;
+}
+
+/* CRC of a buffer one bit at a time, as a reference for the table and
+ * instruction based versions */
+static uint32_t test_crc_bitwise(uint32_t poly, const uint8_t * src,
+                                 uint32_t length)
+{
+  uint32_t i;
+  uint8_t bit;
+  uint32_t crc = 0xFFFFFFFF;
+  for (i = 0; i < length; i++)
+  {
+    crc ^= src[i];
+    for (bit = 0; bit < 8; bit++)
+    {
+      crc = (crc >> 1) ^ (poly & (0U - (crc & 1)));
+    }
+  }
+  return ~crc;
+}
+
+int8_t test_checksum()
+{
+  uint32_t i;
+  uint32_t len;
+  uint32_t half;
+  uint32_t crc;
+  uint32_t crc_c;
+  uint64_t sum;
+  int8_t ret = TEST_NO_ERROR;
+  uint8_t * src;
+  uint8_t * dst;
+  const uint8_t * check = (const uint8_t*)"123456789";
+  memory_isa_t isa;
+  memory_isa_t saved = memory_active_isa();
+
+  PRINTF("test_checksum()\n");
+  src = (uint8_t*) reserve_words(2 * TEST_CHECKSUM_SIZE_B / sizeof(int32_t));
+  if (! src )
+  {
+    return TEST_ERROR;
+  }
+  dst = src + TEST_CHECKSUM_SIZE_B;
+  for (i = 0; i < TEST_CHECKSUM_SIZE_B; i++)
+  {
+    src[i] = (uint8_t)(i * 131 + (i >> 7));
+  }
+
+  /* the published check values */
+  if (checksum_fletcher64((const uint8_t*)"abcde", 5, 0) !=
+      0xC8C6C527646362C6ULL ||
+      checksum_fletcher64((const uint8_t*)"abcdefgh", 8, 0) !=
+      0x312E2B28CCCAC8C6ULL)
+  {
+    ret = TEST_ERROR;
+  }
+
+  for (isa = MEMORY_ISA_SCALAR; isa <= memory_best_isa(); isa++)
+  {
+    memory_select_isa(isa);
+    if (checksum_crc32(check, 9, 0) != 0xCBF43926 ||
+        checksum_crc32c(check, 9, 0) != 0xE3069283)
+    {
+      ret = TEST_ERROR;
+    }
+    /* every length up to 64, then steps across the interleaved blocks */
+    for (len = 0; len <= TEST_CHECKSUM_SIZE_B; len += (len < 64) ? 1 : 61)
+    {
+      half = (len / 3) & ~3U;
+      crc = test_crc_bitwise(0xEDB88320, src, len);
+      crc_c = test_crc_bitwise(0x82F63B78, src, len);
+      if (checksum_crc32(src, len, 0) != crc ||
+          checksum_crc32c(src, len, 0) != crc_c)
+      {
+        ret = TEST_ERROR;
+      }
+      if (checksum_crc32(src + half, len - half,
+                         checksum_crc32(src, half, 0)) != crc ||
+          checksum_crc32_combine(checksum_crc32(src, half, 0),
+                                 checksum_crc32(src + half, len - half, 0),
+                                 len - half) != crc ||
+          checksum_crc32c_combine(checksum_crc32c(src, half, 0),
+                                  checksum_crc32c(src + half, len - half, 0),
+                                  len - half) != crc_c)
+      {
+        ret = TEST_ERROR;
+      }
+      sum = checksum_fletcher64(src, len, 0);
+      if (checksum_fletcher64(src + half, len - half,
+                              checksum_fletcher64(src, half, 0)) != sum ||
+          checksum_fletcher64_combine(checksum_fletcher64(src, half, 0),
+                                      checksum_fletcher64(src + half,
+                                                          len - half, 0),
+                                      len - half) != sum)
+      {
+        ret = TEST_ERROR;
+      }
+      for (i = 0; i <= len && i < TEST_CHECKSUM_SIZE_B; i++)
+      {
+        dst[i] = 0xA5;
+      }
+      if (checksum_copy_crc32c(src, dst, len, 0) != crc_c)
+      {
+        ret = TEST_ERROR;
+      }
+      for (i = 0; i <= len && i < TEST_CHECKSUM_SIZE_B; i++)
+      {
+        if (dst[i] != ((i < len) ? src[i] : 0xA5))
+        {
+          ret = TEST_ERROR;
+        }
+      }
+    }
+  }
+
+  memory_select_isa(saved);
+  free_words( (uint32_t*)src );
+  return ret;
+}
+
+int8_t test_span()
+{
+  uint32_t i;
+  int8_t ret = TEST_NO_ERROR;
+  uint8_t * set;
+  byte_span_t all;
+  byte_span_t head;
+  byte_span_t tail;
+  byte_span_t part;
+  byte_span_t number;
+
+  PRINTF("test_span()\n");
+  set = (uint8_t*) reserve_words(TEST_SPAN_SIZE_B / sizeof(int32_t));
+  if (! set )
+  {
+    return TEST_ERROR;
+  }
+  for (i = 0; i < TEST_SPAN_SIZE_B; i++)
+  {
+    set[i] = (uint8_t)i;
+  }
+  all = span_make(set, TEST_SPAN_SIZE_B);
+
+  /* sub-ranges are clamped to the parent */
+  part = span_sub(all, 16, TEST_SPAN_SIZE_B);
+  if (part.data != set + 16 || part.length != TEST_SPAN_SIZE_B - 16 ||
+      ! span_is_empty(span_sub(all, TEST_SPAN_SIZE_B + 1, 4)))
+  {
+    ret = TEST_ERROR;
+  }
+  span_split(all, 40, &head, &tail);
+  if (head.data != set || head.length != 40 || tail.data != set + 40 ||
+      tail.length != TEST_SPAN_SIZE_B - 40)
+  {
+    ret = TEST_ERROR;
+  }
+  part = tail;
+  head = span_advance(&part, TEST_SPAN_SIZE_B);
+  if (head.length != TEST_SPAN_SIZE_B - 40 || ! span_is_empty(part))
+  {
+    ret = TEST_ERROR;
+  }
+
+  /* a copy into a shorter span stops at its end */
+  part = my_memcopy_span(span_sub(all, 0, 32), span_sub(all, 64, 8));
+  if (part.data != set + 64 || part.length != 8 || set[71] != 7 ||
+      set[72] != 72)
+  {
+    ret = TEST_ERROR;
+  }
+  part = my_memmove_span(span_sub(all, 64, 8), span_sub(all, 68, 16));
+  if (part.length != 8 || set[68] != 0 || set[75] != 7 || set[76] != 76)
+  {
+    ret = TEST_ERROR;
+  }
+  my_memset_span(span_sub(all, 100, 10), 0xEE);
+  my_reverse_span(span_sub(all, 120, 4));
+  if (set[99] != 99 || set[100] != 0xEE || set[109] != 0xEE ||
+      set[110] != 110 || set[120] != 123 || set[123] != 120)
+  {
+    ret = TEST_ERROR;
+  }
+  part = my_memchr_span(all, 0xEE);
+  if (part.data != set + 100 || part.length != TEST_SPAN_SIZE_B - 100 ||
+      my_memmem_span(all, span_sub(all, 120, 4)).data != set + 120 ||
+      my_memmem_span(tail, span_sub(all, 0, 9)).data != NULL)
+  {
+    ret = TEST_ERROR;
+  }
+  if (my_memcmp_span(span_sub(all, 0, 4), span_sub(all, 0, 8)) >= 0 ||
+      my_memcmp_span(span_sub(all, 0, 8), span_sub(all, 0, 8)) != 0)
+  {
+    ret = TEST_ERROR;
+  }
+
+  /* the number only lands when it fits */
+  number = my_itoa_span(-1234, span_sub(all, 200, 5), 10);
+  if (! span_is_empty(number) || set[200] != 200)
+  {
+    ret = TEST_ERROR;
+  }
+  number = my_itoa_span(-1234, span_sub(all, 200, 6), 10);
+  if (number.length != 5 || set[205] != '\0' ||
+      my_atoi_span(number, 10) != -1234)
+  {
+    ret = TEST_ERROR;
+  }
+
+  /* the stats of a sub-range leave it in its order */
+  part = span_sub(all, 8, 5);
+  print_statistics_span(part, NULL);
+  for (i = 0; i < 5; i++)
+  {
+    if (set[8 + i] != 8 + i)
+    {
+      ret = TEST_ERROR;
+    }
+  }
+  if (find_mean_span(part) != 10)
+  {
+    ret = TEST_ERROR;
+  }
+#if SIZE_MAX > UINT_MAX
+  /* too long for the unsigned int length of sort_array(), so refused whole */
+  if (sort_array_span(span_make(set, (size_t)UINT_MAX + 1)) != -1 ||
+      set[0] != 0 || set[TEST_SPAN_SIZE_B - 1] != TEST_SPAN_SIZE_B - 1)
+  {
+    ret = TEST_ERROR;
+  }
+#endif
+  if (sort_array_span(part) != 0 || set[8] != 12 || set[12] != 8)
+  {
+    ret = TEST_ERROR;
+  }
+
+  free_words( (uint32_t*)set );
+  return ret;
+}
+
+int8_t test_reserve_aligned() {
+  static uint8_t region[TEST_TLSF_SIZE_B];
+  static const size_t lengths[] = {
+    25, TEST_ALIGNED_HEAP_B / sizeof(int32_t),
+#if defined (HOST)
+    MEMORY_HUGE_THRESHOLD / sizeof(int32_t) + 3,
+#endif
+  };
+  size_t n;
+  size_t align;
+  size_t i;
+  int8_t ret = TEST_NO_ERROR;
+  tlsf_t tlsf;
+  struct tlsf_stats before;
+  struct tlsf_stats after;
+  uint8_t * blocks[TEST_ALIGNED_SHIFTS];
+  int32_t * words;
+
+  PRINTF("test_reserve_aligned()\n");
+  for (n = 0; n < sizeof(lengths) / sizeof(lengths[0]); n++)
+  {
+    for (align = 16; align <= 4096; align <<= 1)
+    {
+      words = reserve_words_aligned(lengths[n], align);
+      if (! words || ((uintptr_t)words % align) != 0)
+      {
+        ret = TEST_ERROR;
+        free_words( (uint32_t*)words );
+        continue;
+      }
+      my_memset((uint8_t*)words, lengths[n] * sizeof(int32_t), (uint8_t)align);
+      for (i = 0; i < lengths[n]; i += 1 + lengths[n] / 64)
+      {
+        if (words[i] != (int32_t)(0x01010101U * (uint8_t)align))
+        {
+          ret = TEST_ERROR;
+        }
+      }
+      if (words[lengths[n] - 1] != (int32_t)(0x01010101U * (uint8_t)align))
+      {
+        ret = TEST_ERROR;
+      }
+      free_words( (uint32_t*)words );
+    }
+  }
+
+  /* 0 asks for a cache line; other alignments must be powers of two */
+  words = reserve_words_aligned(10, 0);
+  if (! words || ((uintptr_t)words % MEMORY_CACHE_LINE) != 0 ||
+      reserve_words_aligned(10, 3) != NULL)
+  {
+    ret = TEST_ERROR;
+  }
+  free_words( (uint32_t*)words );
+
+  /* The gaps skipped to reach each boundary go back to the heap */
+  if (tlsf_init(&tlsf, region, sizeof(region)) != 0)
+  {
+    return TEST_ERROR;
+  }
+  tlsf_stats(&tlsf, &before);
+  for (i = 0; i < TEST_ALIGNED_SHIFTS; i++)
+  {
+    align = (size_t)16 << i;
+    blocks[i] = (uint8_t*) tlsf_memalign(&tlsf, align, 40);
+    if (! blocks[i] || ((uintptr_t)blocks[i] % align) != 0 ||
+        tlsf_block_size(blocks[i]) < 40)
+    {
+      ret = TEST_ERROR;
+      blocks[i] = NULL;
+      continue;
+    }
+    my_memset(blocks[i], 40, (uint8_t)i);
+  }
+  for (i = 0; i < TEST_ALIGNED_SHIFTS; i++)
+  {
+    if (blocks[i] && (blocks[i][0] != (uint8_t)i || blocks[i][39] != (uint8_t)i))
+    {
+      ret = TEST_ERROR;
+    }
+  }
+  for (i = 0; i < TEST_ALIGNED_SHIFTS; i++)
+  {
+    if (blocks[i])
+    {
+      tlsf_free(&tlsf, blocks[i]);
+    }
+  }
+  tlsf_stats(&tlsf, &after);
+  if (after.free_blocks != 1 || after.used_blocks != 0 ||
+      after.largest_free != before.largest_free)
+  {
+    ret = TEST_ERROR;
+  }
+  return ret;
+}
+
+int8_t test_numa() {
+  static const int places[] = { MEMORY_NODE_LOCAL, MEMORY_NODE_INTERLEAVE, 0,
+                                1000 };
+  size_t p;
+  size_t i;
+  unsigned threads;
+  int nodes;
+  int node;
+  int8_t ret = TEST_NO_ERROR;
+  uint8_t * set;
+
+  PRINTF("test_numa()\n");
+  nodes = memory_node_count();
+  if (nodes < 1)
+  {
+    return TEST_ERROR;
+  }
+
+  /* A node that is not there still gets memory */
+  for (p = 0; p < sizeof(places) / sizeof(places[0]); p++)
+  {
+    set = (uint8_t*) reserve_words_node(TEST_NUMA_SIZE_B / sizeof(int32_t),
+                                        places[p]);
+    if (! set || ((uintptr_t)set % MEMORY_CACHE_LINE) != 0)
+    {
+      ret = TEST_ERROR;
+      continue;
+    }
+    my_memset(set, TEST_NUMA_SIZE_B, 0xA5);
+    node = memory_node_of(set);
+    if (node >= nodes || (places[p] == 0 && node > 0))
+    {
+      ret = TEST_ERROR;
+    }
+    free_words( (uint32_t*)set );
+  }
+
+  /* Parts cut at odd offsets, thread counts that do not divide the pages */
+  set = (uint8_t*) reserve_words_node(TEST_NUMA_SIZE_B / sizeof(int32_t),
+                                      MEMORY_NODE_LOCAL);
+  if (! set)
+  {
+    return TEST_ERROR;
+  }
+  for (threads = 0; threads <= 5; threads++)
+  {
+    my_memset(set, TEST_NUMA_SIZE_B, 0xA5);
+    my_memzero_parallel(set + threads, TEST_NUMA_SIZE_B - 2 * threads - 1,
+                        threads);
+    for (i = 0; i < TEST_NUMA_SIZE_B; i++)
+    {
+      if (set[i] != ((i < threads || i >= TEST_NUMA_SIZE_B - threads - 1)
+                     ? 0xA5 : 0))
+      {
+        ret = TEST_ERROR;
+        break;
+      }
+    }
+  }
+  free_words( (uint32_t*)set );
+  return ret;
+}
+
+int8_t test_compress()
+{
+  uint32_t i;
+  uint32_t kind;
+  uint32_t seed = 1;
+  size_t n;
+  size_t at;
+  size_t got;
+  size_t piece;
+  size_t taken;
+  size_t room;
+  int8_t ret = TEST_NO_ERROR;
+  uint8_t * src;
+  uint8_t * enc;
+  uint8_t * tmp;
+  compress_stream_t stream;
+  memory_isa_t isa;
+  memory_isa_t saved = memory_active_isa();
+
+  PRINTF("test_compress()\n");
+  src = (uint8_t*) reserve_bytes(TEST_COMPRESS_SIZE_B +
+                                 2 * MEMORY_COMPRESS_BOUND(TEST_COMPRESS_SIZE_B));
+  if (! src )
+  {
+    return TEST_ERROR;
+  }
+  enc = src + TEST_COMPRESS_SIZE_B;
+  tmp = enc + MEMORY_COMPRESS_BOUND(TEST_COMPRESS_SIZE_B);
+
+  /* a ramp, a held and stepped sensor trace, noise and a constant */
+  for (kind = 0; kind < 4; kind++)
+  {
+    for (i = 0; i < TEST_COMPRESS_SIZE_B; i++)
+    {
+      seed = seed * 1103515245 + 12345;
+      src[i] = (kind == 0) ? (uint8_t)i :
+               (kind == 1) ? (uint8_t)((i / 37) * 3 + ((i / 5) & 1)) :
+               (kind == 2) ? (uint8_t)(seed >> 24) : 0x42;
+    }
+    for (isa = MEMORY_ISA_SCALAR; isa <= memory_best_isa(); isa++)
+    {
+      memory_select_isa(isa);
+      n = memory_compress(src, TEST_COMPRESS_SIZE_B, enc,
+                          MEMORY_COMPRESS_BOUND(TEST_COMPRESS_SIZE_B));
+      if (n == 0 || n > MEMORY_COMPRESS_BOUND(TEST_COMPRESS_SIZE_B) ||
+          ((kind == 0 || kind == 3) && n > 16) ||
+          memory_compress(src, TEST_COMPRESS_SIZE_B, tmp, n - 1) != 0)
+      {
+        ret = TEST_ERROR;
+        continue;
+      }
+
+      my_memset(tmp, TEST_COMPRESS_SIZE_B, 0);
+      if (memory_decompress(enc, n, tmp, TEST_COMPRESS_SIZE_B) !=
+          TEST_COMPRESS_SIZE_B ||
+          my_memcmp(tmp, src, TEST_COMPRESS_SIZE_B) != 0 ||
+          memory_decompress(enc, n, tmp, TEST_COMPRESS_SIZE_B - 1) != 0 ||
+          memory_decompress(enc, n - 1, tmp, TEST_COMPRESS_SIZE_B) != 0)
+      {
+        ret = TEST_ERROR;
+      }
+
+      /* uneven input pieces into barely enough room give the same bytes */
+      memory_compress_init(&stream);
+      got = 0;
+      for (at = 0, i = 0; at < TEST_COMPRESS_SIZE_B; i++)
+      {
+        piece = 1 + (i * 89) % 301;
+        if (piece > TEST_COMPRESS_SIZE_B - at)
+        {
+          piece = TEST_COMPRESS_SIZE_B - at;
+        }
+        room = MEMORY_COMPRESS_TOKEN_MAX + i % 5;
+        got += memory_compress_update(&stream, src + at, piece, tmp + got,
+                                      room, &taken);
+        at += taken;
+      }
+      got += memory_compress_finish(&stream, tmp + got,
+                                    MEMORY_COMPRESS_TOKEN_MAX);
+      if (got != n || my_memcmp(tmp, enc, n) != 0)
+      {
+        ret = TEST_ERROR;
+      }
+
+      /* over itself, with the documented margin and with too little room */
+      room = TEST_COMPRESS_SIZE_B + MEMORY_DECOMPRESS_MARGIN(n);
+      my_memcopy(enc, tmp + room - n, n);
+      if (memory_decompress_in_place(tmp, room, n) != TEST_COMPRESS_SIZE_B ||
+          my_memcmp(tmp, src, TEST_COMPRESS_SIZE_B) != 0)
+      {
+        ret = TEST_ERROR;
+      }
+      room = TEST_COMPRESS_SIZE_B - 1;
+      my_memcopy(enc, tmp + room - n, n);
+      if (n <= room && memory_decompress_in_place(tmp, room, n) != 0)
+      {
+        ret = TEST_ERROR;
+      }
+    }
+  }
+
+  /* a long run ahead of a literal would run over the literal in place */
+  tmp[0] = 0xFF;
+  tmp[1] = 70;
+  tmp[2] = 0;
+  tmp[3] = 3;
+  my_memset(tmp + 4, 4, 1);
+  my_memcopy(tmp, src + 196, 8);
+  if (memory_decompress(tmp, 8, enc, 204) != 204 ||
+      memory_decompress_in_place(src, 204, 8) != 0 ||
+      src[203] != 1)
+  {
+    ret = TEST_ERROR;
+  }
+
+  memory_select_isa(saved);
+  free_bytes(src);
+  return ret;
+}
+
+int8_t test_sort()
+{
+  static const uint32_t lengths[] = {
+    0, 1, 2, STATS_SORT_CUTOFF - 1, STATS_SORT_CUTOFF, STATS_SORT_CUTOFF + 1,
+    1000, TEST_SORT_SIZE
+  };
+  uint32_t i;
+  uint32_t n;
+  uint32_t kind;
+  uint32_t seed = 7;
+  uint32_t len;
+  uint32_t sum;
+  uint32_t sorted_sum;
+  int8_t ret = TEST_NO_ERROR;
+  uint8_t * bytes;
+  uint16_t * halves;
+  uint32_t * words;
+  uint32_t * scratch;
+  uint32_t counts[256];
+
+  PRINTF("test_sort()\n");
+  words = (uint32_t*) reserve_words(3 * TEST_SORT_SIZE);
+  if (! words )
+  {
+    return TEST_ERROR;
+  }
+  scratch = words + TEST_SORT_SIZE;
+  halves = (uint16_t*)(scratch + TEST_SORT_SIZE);
+  bytes = (uint8_t*)(halves + TEST_SORT_SIZE);
+
+  /* random, constant, ascending and keys that differ only in the low byte */
+  for (kind = 0; kind < 4; kind++)
+  {
+    for (n = 0; n < sizeof(lengths) / sizeof(lengths[0]); n++)
+    {
+      len = lengths[n];
+      sum = 0;
+      for (i = 0; i < 256; i++)
+      {
+        counts[i] = 0;
+      }
+      for (i = 0; i < len; i++)
+      {
+        seed = seed * 1103515245 + 12345;
+        words[i] = (kind == 0) ? seed : (kind == 1) ? 0x12345678 :
+                   (kind == 2) ? i * 40503 : 0xABCD0000 + (seed >> 24);
+        halves[i] = (uint16_t)(words[i] >> 8);
+        bytes[i] = (uint8_t)(words[i] >> 16);
+        counts[bytes[i]]++;
+        sum += words[i];
+      }
+
+      sort_array(bytes, len);
+      for (i = 0; i < len; i++)
+      {
+        counts[bytes[i]]--;
+        if (i > 0 && bytes[i] > bytes[i - 1])
+        {
+          ret = TEST_ERROR;
+        }
+      }
+      for (i = 0; i < 256; i++)
+      {
+        if (counts[i] != 0)
+        {
+          ret = TEST_ERROR;
+        }
+      }
+
+      /* the 16-bit keys reserve their own scratch */
+      sort_array_u16(halves, len, NULL);
+      sort_array_u32(words, len, scratch);
+      sorted_sum = 0;
+      for (i = 0; i < len; i++)
+      {
+        sorted_sum += words[i];
+        if (i > 0 && (words[i] > words[i - 1] || halves[i] > halves[i - 1]))
+        {
+          ret = TEST_ERROR;
+        }
+      }
+      if (sorted_sum != sum)
+      {
+        ret = TEST_ERROR;
+      }
+    }
+  }
+
+  free_words(words);
+  return ret;
+}
+
+static uint8_t histogram_check(const stats_histogram_t * hist,
+                               const uint8_t * sorted, uint32_t len,
+                               const uint32_t * counts, uint32_t sum)
+{
+  uint32_t p;
+  uint32_t rank;
+  uint32_t mode = 0;
+  uint8_t ret = TEST_NO_ERROR;
+
+  /* sorted is descending, so ascending rank r is sorted[len - r] */
+  for (p = 1; p < 256; p++)
+  {
+    if (counts[p] > counts[mode])
+    {
+      mode = p;
+    }
+  }
+  if (stats_histogram_minimum(hist) != sorted[len - 1] ||
+      stats_histogram_maximum(hist) != sorted[0] ||
+      stats_histogram_mean(hist) != sum / len ||
+      stats_histogram_mode(hist) != mode ||
+      stats_histogram_median(hist) != ((len % 2) ? sorted[len / 2] :
+        (sorted[len / 2] + sorted[len / 2 - 1]) / 2))
+  {
+    ret = TEST_ERROR;
+  }
+  for (p = 0; p <= 100; p++)
+  {
+    rank = (p * len + 99) / 100;
+    if (stats_histogram_percentile(hist, p) != sorted[len - (rank ? rank : 1)])
+    {
+      ret = TEST_ERROR;
+    }
+  }
+  return ret;
+}
+
+int8_t test_histogram()
+{
+  static const uint32_t lengths[] = { 1, 2, 5, 6, 1000, TEST_SORT_SIZE };
+  uint32_t i;
+  uint32_t n;
+  uint32_t kind;
+  uint32_t seed = 11;
+  uint32_t len;
+  uint32_t sum;
+  uint32_t counts[256];
+  int8_t ret = TEST_NO_ERROR;
+  uint8_t * samples;
+  uint8_t * sorted;
+  uint8_t * copy;
+  stats_histogram_t whole;
+  stats_histogram_t chunked;
+
+  PRINTF("test_histogram()\n");
+  samples = (uint8_t*) reserve_words(3 * TEST_SORT_SIZE / 4);
+  if (! samples )
+  {
+    return TEST_ERROR;
+  }
+  sorted = samples + TEST_SORT_SIZE;
+  copy = sorted + TEST_SORT_SIZE;
+
+  /* random, constant and a few values with long runs */
+  for (kind = 0; kind < 3; kind++)
+  {
+    for (n = 0; n < sizeof(lengths) / sizeof(lengths[0]); n++)
+    {
+      len = lengths[n];
+      sum = 0;
+      for (i = 0; i < 256; i++)
+      {
+        counts[i] = 0;
+      }
+      for (i = 0; i < len; i++)
+      {
+        seed = seed * 1103515245 + 12345;
+        samples[i] = (kind == 0) ? (uint8_t)(seed >> 24) :
+                     (kind == 1) ? 200 : (uint8_t)(((i / 37) % 3) * 90);
+        sorted[i] = samples[i];
+        copy[i] = samples[i];
+        counts[samples[i]]++;
+        sum += samples[i];
+      }
+      sort_array(sorted, len);
+
+      stats_histogram_build(&whole, samples, len);
+      stats_histogram_reset(&chunked);
+      stats_histogram_add(&chunked, samples, len / 3);
+      stats_histogram_add(&chunked, samples + len / 3, 1);
+      stats_histogram_add(&chunked, samples + len / 3 + 1,
+                          len - len / 3 - 1);
+      if (whole.length != len || chunked.length != len)
+      {
+        ret = TEST_ERROR;
+      }
+      for (i = 0; i < 256; i++)
+      {
+        if (whole.counts[i] != counts[i] || chunked.counts[i] != counts[i])
+        {
+          ret = TEST_ERROR;
+        }
+      }
+      if (histogram_check(&whole, sorted, len, counts, sum) != TEST_NO_ERROR)
+      {
+        ret = TEST_ERROR;
+      }
+
+      /* the find_* functions take the samples in any order and keep it */
+      if (find_median(samples, len) != stats_histogram_median(&whole) ||
+          find_maximum(samples, len) != sorted[0] ||
+          find_minimum(samples, len) != sorted[len - 1])
+      {
+        ret = TEST_ERROR;
+      }
+      if (len < TEST_SORT_SIZE)
+      {
+        print_statistics(samples, len);
+      }
+      for (i = 0; i < len; i++)
+      {
+        if (samples[i] != copy[i])
+        {
+          ret = TEST_ERROR;
+        }
+      }
+    }
+  }
+
+  /* empty histograms and out of range percentiles are refused */
+  stats_histogram_reset(&whole);
+  errno = 0;
+  if (stats_histogram_median(&whole) != 0 || errno != EINVAL)
+  {
+    ret = TEST_ERROR;
+  }
+  stats_histogram_build(&whole, samples, 1);
+  errno = 0;
+  if (stats_histogram_percentile(&whole, 101) != 0 || errno != EINVAL)
+  {
+    ret = TEST_ERROR;
+  }
+
+  /* so are samples past what the 32-bit counts can hold, before any is read */
+  whole.length = UINT32_MAX;
+  if (stats_histogram_add(&whole, samples, 1) != -1 ||
+      whole.length != UINT32_MAX || whole.counts[samples[0]] != 1)
+  {
+    ret = TEST_ERROR;
+  }
+#if SIZE_MAX > UINT32_MAX
+  if (stats_histogram_build(&whole, samples, (size_t)UINT32_MAX + 1) != -1 ||
+      whole.length != 0 || stats_histogram_add(&whole, samples, 1) != 0)
+  {
+    ret = TEST_ERROR;
+  }
+#endif
+
+  free_words((uint32_t*)samples);
+  return ret;
+}
+
+#if defined (MSP432)
+volatile uint32_t test_summary_cycles[2];
+#endif
+
+int8_t test_summary()
+{
+  uint32_t i;
+  uint32_t len;
+  uint32_t off;
+  uint32_t seed = 3;
+  uint64_t sum;
+  uint8_t min;
+  uint8_t max;
+  int8_t ret = TEST_NO_ERROR;
+  uint8_t * set;
+  struct stats_result result;
+  memory_isa_t isa;
+  memory_isa_t saved = memory_active_isa();
+#if defined (MSP432)
+  uint32_t start;
+#endif
+
+  PRINTF("test_summary()\n");
+  set = (uint8_t*) reserve_words(TEST_SUMMARY_SIZE_B / sizeof(int32_t) + 1);
+  if (! set )
+  {
+    return TEST_ERROR;
+  }
+  for (i = 0; i < TEST_SUMMARY_SIZE_B + 4; i++)
+  {
+    seed = seed * 1103515245 + 12345;
+    set[i] = 1 + (seed >> 24) % 254;
+  }
+
+  for (isa = MEMORY_ISA_SCALAR; isa <= memory_best_isa(); isa++)
+  {
+    memory_select_isa(isa);
+    for (len = 1; len <= TEST_SUMMARY_SIZE_B; len++)
+    {
+      for (off = 0; off < 4; off++)
+      {
+        /* the extremes land in the vector body or the scalar tail */
+        uint8_t * arr = set + off;
+        uint32_t lo = (len * 7) / 11;
+        uint32_t hi = len - 1 - (len * 3) / 13;
+        uint8_t keep_lo = arr[lo];
+        uint8_t keep_hi = arr[hi];
+        arr[lo] = 0;
+        arr[hi] = 255;
+        min = 255;
+        max = 0;
+        sum = 0;
+        for (i = 0; i < len; i++)
+        {
+          min = arr[i] < min ? arr[i] : min;
+          max = arr[i] > max ? arr[i] : max;
+          sum += arr[i];
+        }
+        if (stats_summary(arr, len, &result) != 0 || result.count != len ||
+            result.minimum != min || result.maximum != max ||
+            result.sum != sum)
+        {
+          ret = TEST_ERROR;
+        }
+        arr[hi] = keep_hi;
+        arr[lo] = keep_lo;
+      }
+    }
+  }
+  memory_select_isa(saved);
+
+#if defined (MSP432)
+  /* the whole buffer through the DSP path, then through the plain loop */
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  start = DWT->CYCCNT;
+  if (stats_summary(set, TEST_SUMMARY_SIZE_B, &result) != 0)
+  {
+    ret = TEST_ERROR;
+  }
+  test_summary_cycles[0] = DWT->CYCCNT - start;
+  start = DWT->CYCCNT;
+  min = 255;
+  max = 0;
+  sum = 0;
+  for (i = 0; i < TEST_SUMMARY_SIZE_B; i++)
+  {
+    min = set[i] < min ? set[i] : min;
+    max = set[i] > max ? set[i] : max;
+    sum += set[i];
+  }
+  test_summary_cycles[1] = DWT->CYCCNT - start;
+  if (result.minimum != min || result.maximum != max || result.sum != sum)
+  {
+    ret = TEST_ERROR;
+  }
+  PRINTF("  %d bytes: %lu cycles, %lu for the plain loop\n",
+         TEST_SUMMARY_SIZE_B, (unsigned long)test_summary_cycles[0],
+         (unsigned long)test_summary_cycles[1]);
+#endif
+
+  errno = 0;
+  if (stats_summary(set, 0, &result) != -1 || result.count != 0 ||
+      result.sum != 0 || stats_summary(NULL, 4, &result) != -1 ||
+      stats_summary(set, 4, NULL) != -1 || errno != 0)
+  {
+    ret = TEST_ERROR;
+  }
+  free_words( (uint32_t*)set );
+
+#if defined (HOST)
+  set = (uint8_t*) reserve_words(TEST_SUMMARY_BIG_B / sizeof(int32_t));
+  if (! set )
+  {
+    return TEST_ERROR;
+  }
+  my_memset(set, TEST_SUMMARY_BIG_B, 255);
+  for (isa = MEMORY_ISA_SCALAR; isa <= memory_best_isa(); isa++)
+  {
+    memory_select_isa(isa);
+    if (stats_summary(set, TEST_SUMMARY_BIG_B, &result) != 0 ||
+        result.sum != 255ULL * TEST_SUMMARY_BIG_B || result.minimum != 255 ||
+        find_mean(set, TEST_SUMMARY_BIG_B) != 255)
+    {
+      ret = TEST_ERROR;
+    }
+  }
+  memory_select_isa(saved);
+  free_words( (uint32_t*)set );
+#endif
+  return ret;
+}
+
+static uint32_t select_key(const void * keys, uint32_t i, uint32_t width)
+{
+  if (width == 1)
+  {
+    return ((const uint8_t*)keys)[i];
+  }
+  if (width == 2)
+  {
+    return ((const uint16_t*)keys)[i];
+  }
+  return ((const uint32_t*)keys)[i];
+}
+
+/* test_select() runs a fixed 1000 key case in its TEST_SORT_SIZE buffers */
+#if TEST_SORT_SIZE < 1000
+#error "TEST_SORT_SIZE is too small for test_select()"
+#endif
+
+int8_t test_select()
+{
+  static const uint32_t lengths[] = {
+    1, 2, 3, STATS_SORT_CUTOFF, STATS_SORT_CUTOFF + 1, 1000, TEST_SORT_SIZE
+  };
+  uint32_t i;
+  uint32_t n;
+  uint32_t r;
+  uint32_t kind;
+  uint32_t width;
+  uint32_t seed = 5;
+  uint32_t len;
+  uint32_t k;
+  uint32_t value;
+  uint32_t expected;
+  uint32_t before;
+  uint32_t after;
+  int8_t ret = TEST_NO_ERROR;
+  uint32_t * keys;
+  uint32_t * sorted;
+  uint32_t * scratch;
+
+  PRINTF("test_select()\n");
+  keys = (uint32_t*) reserve_words(3 * TEST_SORT_SIZE);
+  if (! keys )
+  {
+    return TEST_ERROR;
+  }
+  sorted = keys + TEST_SORT_SIZE;
+  scratch = sorted + TEST_SORT_SIZE;
+
+  /* random, constant, ascending and organ pipe, which defeats the median
+   * of three pivot */
+  for (width = 1; width <= 4; width *= 2)
+  {
+    for (kind = 0; kind < 4; kind++)
+    {
+      for (n = 0; n < sizeof(lengths) / sizeof(lengths[0]); n++)
+      {
+        len = lengths[n];
+        for (r = 0; r < 4; r++)
+        {
+          seed = seed * 1103515245 + 12345;
+          k = (r == 0) ? 0 : (r == 1) ? len - 1 : (r == 2) ? len / 2 :
+              (seed >> 8) % len;
+          for (i = 0; i < len; i++)
+          {
+            seed = seed * 1103515245 + 12345;
+            value = (kind == 0) ? seed : (kind == 1) ? 0x5A5A5A5A :
+                    (kind == 2) ? i * 40503 :
+                    (i < len / 2 ? i : len - i) * 40503;
+            if (width == 1)
+            {
+              ((uint8_t*)keys)[i] = (uint8_t)(value >> 24);
+              ((uint8_t*)sorted)[i] = (uint8_t)(value >> 24);
+            }
+            else if (width == 2)
+            {
+              ((uint16_t*)keys)[i] = (uint16_t)(value >> 16);
+              ((uint16_t*)sorted)[i] = (uint16_t)(value >> 16);
+            }
+            else
+            {
+              keys[i] = value;
+              sorted[i] = value;
+            }
+          }
+          if (width == 1)
+          {
+            sort_array((uint8_t*)sorted, len);
+          }
+          else if (width == 2)
+          {
+            sort_array_u16((uint16_t*)sorted, len, (uint16_t*)scratch);
+          }
+          else
+          {
+            sort_array_u32(sorted, len, scratch);
+          }
+          expected = select_key(sorted, k, width);
+          before = 0;
+          for (i = 0; i < len; i++)
+          {
+            before = before * 31 + select_key(keys, i, width);
+          }
+
+          /* on a copy the keys keep their order */
+          if (find_kth(keys, len, width, k, scratch, &value) != 0 ||
+              value != expected)
+          {
+            ret = TEST_ERROR;
+          }
+          if (find_median_select(keys, len, width, scratch, &value) != 0 ||
+              value != ((len % 2) ? select_key(sorted, len / 2, width) :
+                        (select_key(sorted, len / 2, width) +
+                         (uint64_t)select_key(sorted, len / 2 - 1, width)) / 2))
+          {
+            ret = TEST_ERROR;
+          }
+          after = 0;
+          for (i = 0; i < len; i++)
+          {
+            after = after * 31 + select_key(keys, i, width);
+          }
+          if (after != before)
+          {
+            ret = TEST_ERROR;
+          }
+
+          /* in place they end up partitioned around rank k */
+          if (find_kth(keys, len, width, k, NULL, &value) != 0 ||
+              value != expected)
+          {
+            ret = TEST_ERROR;
+          }
+          for (i = 0; i < len; i++)
+          {
+            if ((i < k && select_key(keys, i, width) < expected) ||
+                (i > k && select_key(keys, i, width) > expected))
+            {
+              ret = TEST_ERROR;
+            }
+          }
+        }
+      }
+    }
+  }
+
+  /* mostly one key, which is also most of the pivot samples and so the
+   * pivot, with few keys above it: rank 628 is the first key below the run */
+  for (i = 0; i < 1000; i++)
+  {
+    keys[i] = (i % 50 == 1) ? 2000000 + i : (i < 620) ? 1000000 : 2000 - i;
+  }
+  keys[999] = 1000000;
+  for (r = 0, i = 0; i < 1000; i++)
+  {
+    r += (keys[i] == 1000000);
+  }
+  if (r != 608 || find_kth(keys, 1000, 4, 627, scratch, &value) != 0 ||
+      value != 1000000 || find_kth(keys, 1000, 4, 628, NULL, &value) != 0 ||
+      value != 1380)
+  {
+    ret = TEST_ERROR;
+  }
+
+  if (find_kth(keys, 4, 4, 4, NULL, &value) != -1 ||
+      find_kth(keys, 4, 3, 0, NULL, &value) != -1 ||
+      find_kth(NULL, 4, 4, 0, NULL, &value) != -1 ||
+      find_median_select(keys, 0, 4, NULL, &value) != -1)
+  {
+    ret = TEST_ERROR;
+  }
+
+  free_words(keys);
+  return ret;
+}
+
 void course1(void) 
 {
   uint8_t i;
@@ -332,9 +2421,31 @@ void course1(void)
   results[2] = test_memmove1();
   results[3] = test_memmove2();
   results[4] = test_memmove3();
-  results[5] = test_memcopy();
-  results[6] = test_memset();
-  results[7] = test_reverse();
+  results[5] = test_memmove4();
+  results[6] = test_memory_isa();
+  results[7] = test_memset_stream();
+  results[8] = test_reserve_pool();
+  results[9] = test_thread_cache();
+  results[10] = test_tlsf();
+  results[11] = test_arena();
+  results[12] = test_memcopy();
+  results[13] = test_memset();
+  results[14] = test_reverse();
+  results[15] = test_bswap();
+  results[16] = test_search();
+  results[17] = test_strided();
+  results[18] = test_transpose();
+  results[19] = test_memcopy_v();
+  results[20] = test_memset_pattern();
+  results[21] = test_checksum();
+  results[22] = test_span();
+  results[23] = test_reserve_aligned();
+  results[24] = test_numa();
+  results[25] = test_compress();
+  results[26] = test_sort();
+  results[27] = test_histogram();
+  results[28] = test_summary();
+  results[29] = test_select();
 
   for ( i = 0; i < TESTCOUNT; i++) 
   {
@@ -346,4 +2457,5 @@ void course1(void)
   PRINTF("  PASSED: %d / %d\n", (TESTCOUNT - failed), TESTCOUNT);
   PRINTF("  FAILED: %d / %d\n", failed, TESTCOUNT);
   PRINTF("--------------------------------\n");
+  memory_stats_dump();
 }
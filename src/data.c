@@ -54,6 +54,14 @@ uint8_t my_itoa(int32_t data, uint8_t * ptr, uint32_t base) {
     return idx;
 }
 
+uint8_t* my_itoa_alloc(int32_t data, uint32_t base, arena_t* scratch) {
+    uint8_t* ptr = scratch ? (uint8_t*)arena_alloc(scratch, MAX_CHAR_LEN, 1)
+                           : (uint8_t*)reserve_bytes(MAX_CHAR_LEN);
+    if(ptr)
+        my_itoa(data, ptr, base);
+    return ptr;
+}
+
 uint8_t atoi_ch(uint8_t ach, uint8_t base) {
     if(ach >= '0' && ach <= '9')
         return ach - '0';
@@ -81,3 +89,22 @@ int32_t my_atoi(uint8_t * ptr, uint8_t digits, uint32_t base) {
         result += atoi_ch(*ptr, base) * power;
     return result;
 }
+
+byte_span_t my_itoa_span(int32_t data, byte_span_t dst, uint32_t base) {
+    uint8_t str[MAX_CHAR_LEN];
+    uint8_t length = my_itoa(data, str, base);
+    if(length > dst.length)
+        return span_make(dst.data, 0);
+    my_memcopy(str, dst.data, length);
+    return span_sub(dst, 0, length - 1);
+}
+
+int32_t my_atoi_span(byte_span_t src, uint32_t base) {
+    size_t length = src.length;
+    if(length && *(src.data + length - 1) == '\0')
+        length--;
+    /* my_atoi counts the terminator among the digits */
+    if(length > UINT8_MAX - 1)
+        length = UINT8_MAX - 1;
+    return my_atoi(src.data, (uint8_t)(length + 1), base);
+}
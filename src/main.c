@@ -22,10 +22,16 @@
  * Modfiled by Hatem Alamir 12/1/2024
  */
 #include "course1.h"
+#ifdef BENCH
+#include "bench.h"
+#endif
 
 int main(void) {
 #ifdef COURSE1
     course1();
+#endif
+#ifdef BENCH
+    bench();
 #endif
   return 0;
 }
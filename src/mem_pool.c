@@ -0,0 +1,331 @@
+/******************************************************************************
+ * Copyright (C) 2024 by Hatem Alamir
+ *
+ * Redistribution, modification or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are 
+ * permitted to modify this and use it to learn about the field of embedded
+ * software. Hatem Alamir is not liable for any misuse of this material.
+ *
+ *****************************************************************************/
+/**
+ * @file mem_pool.c
+ * @brief Fixed-block pool allocator with power-of-two size classes
+ *
+ * Each class keeps an intrusive free list and a bump cursor into the page it
+ * is currently carving. A byte per page records which class owns it, which is
+ * all free needs to find the class of a block without a header. On HOST the
+ * shared classes sit behind per-thread caches (see mem_pool_thread_cache()).
+ *
+ * @author Hatem Alamir
+ * @date December 12 2024
+ *
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include "mem_pool.h"
+#include "mem_lock.h"
+#if defined (MEM_POOL_TCACHE)
+#include <pthread.h>
+#endif
+
+#define MEM_POOL_PAGE_COUNT (MEM_POOL_ARENA_SIZE / MEM_POOL_PAGE_SIZE)
+
+#if MEM_POOL_PAGE_SIZE % MEM_POOL_MAX_BLOCK != 0
+#error "MEM_POOL_PAGE_SIZE must be a multiple of the largest block size"
+#endif
+
+struct pool_block {
+    struct pool_block* next;
+};
+
+struct pool_class {
+    struct pool_block* free;  /* recycled blocks, LIFO */
+    uint8_t* bump;            /* next never-used block in the current page */
+    uint8_t* bump_end;        /* end of the current page */
+};
+
+/* Page aligned, so every block is aligned to its own size */
+static uint8_t pool_arena[MEM_POOL_ARENA_SIZE]
+    __attribute__((aligned(MEM_POOL_PAGE_SIZE)));
+static uint8_t page_class[MEM_POOL_PAGE_COUNT];
+static size_t pages_used;
+static struct pool_class classes[MEM_POOL_CLASS_COUNT];
+
+static mem_lock_t pool_lock;
+
+/**
+ * @brief Maps a request size to its class index, or -1 if it is too large
+ */
+static inline int pool_class_index(size_t bytes) {
+    if(bytes <= MEM_POOL_MIN_BLOCK)
+        return 0;
+    if(bytes > MEM_POOL_MAX_BLOCK)
+        return -1;
+    /* ceil(log2(bytes)) - MIN_SHIFT; bytes - 1 has the same top bit as the
+     * next power of two minus one */
+    unsigned long v = (unsigned long)(bytes - 1);
+    return (int)(sizeof(v) * 8 - __builtin_clzl(v)) - MEM_POOL_MIN_SHIFT;
+}
+
+size_t mem_pool_block_size(size_t bytes) {
+    int c = pool_class_index(bytes);
+    return c < 0 ? 0 : MEM_POOL_MIN_BLOCK << c;
+}
+
+/**
+ * @brief Takes up to count blocks of one class under a single lock
+ *
+ * @return NULL-terminated list of the blocks taken; *taken receives the count
+ */
+static struct pool_block* central_take(int c, size_t count, size_t* taken) {
+    struct pool_class* cls = &classes[c];
+    size_t block_size = MEM_POOL_MIN_BLOCK << c;
+    struct pool_block* head = NULL;
+    size_t n = 0;
+    mem_lock(&pool_lock);
+    for(; n < count; n++) {
+        struct pool_block* block;
+        if(cls->free) {
+            block = cls->free;
+            cls->free = block->next;
+        } else {
+            if(cls->bump == cls->bump_end && pages_used < MEM_POOL_PAGE_COUNT) {
+                page_class[pages_used] = (uint8_t)c;
+                cls->bump = pool_arena + pages_used * MEM_POOL_PAGE_SIZE;
+                cls->bump_end = cls->bump + MEM_POOL_PAGE_SIZE;
+                pages_used++;
+            }
+            if(cls->bump == cls->bump_end)
+                break;
+            block = (struct pool_block*)cls->bump;
+            cls->bump += block_size;
+        }
+        block->next = head;
+        head = block;
+    }
+    mem_unlock(&pool_lock);
+    *taken = n;
+    return head;
+}
+
+/**
+ * @brief Puts a list of blocks of one class back on its free list
+ */
+static void central_give(int c, struct pool_block* first,
+                         struct pool_block* last) {
+    struct pool_class* cls = &classes[c];
+    mem_lock(&pool_lock);
+    last->next = cls->free;
+    cls->free = first;
+    mem_unlock(&pool_lock);
+}
+
+static inline int pool_block_class(const void* ptr) {
+    size_t page = (size_t)((const uint8_t*)ptr - pool_arena) / MEM_POOL_PAGE_SIZE;
+    return page_class[page];
+}
+
+#if defined (MEM_POOL_TCACHE)
+/*
+ * Thread caches. Each thread keeps a LIFO list of free blocks per class and
+ * only touches shared state when a list runs dry or grows past two batches.
+ * Whole batches move between threads through the depot: one Treiber stack of
+ * chains per class, where a chain is MEM_POOL_TCACHE_BATCH blocks linked
+ * through their first word and the first block's second word links chains.
+ *
+ * The depot head packs the chain's block index (plus one, so zero is empty)
+ * in the low half and a version tag in the high half. Every push and pop bumps
+ * the tag, so a pop that read a stale next_chain cannot succeed after the
+ * chain was popped and pushed again (ABA).
+ */
+struct pool_chain {
+    struct pool_block* next;
+    struct pool_chain* next_chain;
+};
+
+typedef char pool_chain_fits[MEM_POOL_MIN_BLOCK >= sizeof(struct pool_chain)
+                             ? 1 : -1];
+
+#if MEM_POOL_ARENA_SIZE / MEM_POOL_MIN_BLOCK >= 0xFFFFFFFFUL
+#error "MEM_POOL_ARENA_SIZE is too large to index depot chains in 32 bits"
+#endif
+
+struct tcache_bin {
+    struct pool_block* head;
+    size_t count;
+};
+
+static uint64_t depot[MEM_POOL_CLASS_COUNT];
+static int tcache_enabled = 1;
+static __thread struct tcache_bin tcache[MEM_POOL_CLASS_COUNT];
+static __thread int tcache_registered;
+static pthread_key_t tcache_key;
+static pthread_once_t tcache_key_once = PTHREAD_ONCE_INIT;
+
+static inline uint32_t chain_index(const struct pool_chain* chain) {
+    return chain ? (uint32_t)(((const uint8_t*)chain - pool_arena) /
+                              MEM_POOL_MIN_BLOCK) + 1
+                 : 0;
+}
+
+static inline struct pool_chain* chain_at(uint64_t head) {
+    uint32_t index = (uint32_t)head;
+    return index ? (struct pool_chain*)(pool_arena + (size_t)(index - 1) *
+                                                     MEM_POOL_MIN_BLOCK)
+                 : NULL;
+}
+
+static void depot_push(int c, struct pool_chain* chain) {
+    uint64_t old = __atomic_load_n(&depot[c], __ATOMIC_RELAXED);
+    uint64_t head;
+    do {
+        __atomic_store_n(&chain->next_chain, chain_at(old), __ATOMIC_RELAXED);
+        head = ((old >> 32) + 1) << 32 | chain_index(chain);
+    } while(!__atomic_compare_exchange_n(&depot[c], &old, head, 1,
+                                         __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+static struct pool_chain* depot_pop(int c) {
+    uint64_t old = __atomic_load_n(&depot[c], __ATOMIC_ACQUIRE);
+    uint64_t head;
+    struct pool_chain* chain;
+    do {
+        chain = chain_at(old);
+        if(!chain)
+            return NULL;
+        /* The chain may already belong to another thread; the tag check makes
+         * the CAS fail if so, and the arena is always mapped, so the read is
+         * harmless. */
+        struct pool_chain* next =
+            __atomic_load_n(&chain->next_chain, __ATOMIC_RELAXED);
+        head = ((old >> 32) + 1) << 32 | chain_index(next);
+    } while(!__atomic_compare_exchange_n(&depot[c], &old, head, 1,
+                                         __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE));
+    return chain;
+}
+
+static void tcache_exit(void* unused) {
+    (void)unused;
+    mem_pool_thread_flush();
+}
+
+static void tcache_make_key(void) {
+    pthread_key_create(&tcache_key, tcache_exit);
+}
+
+/**
+ * @brief Arranges for the calling thread's cache to be flushed when it exits
+ */
+static void tcache_register(void) {
+    pthread_once(&tcache_key_once, tcache_make_key);
+    pthread_setspecific(tcache_key, &tcache_registered);
+    tcache_registered = 1;
+}
+
+static int tcache_refill(int c, struct tcache_bin* bin) {
+    struct pool_chain* chain = depot_pop(c);
+    if(chain) {
+        bin->head = (struct pool_block*)chain;
+        bin->count = MEM_POOL_TCACHE_BATCH;
+    } else {
+        bin->head = central_take(c, MEM_POOL_TCACHE_BATCH, &bin->count);
+    }
+    return bin->head != NULL;
+}
+
+/**
+ * @brief Moves the most recently freed batch of a bin to the depot
+ */
+static void tcache_spill(int c, struct tcache_bin* bin) {
+    struct pool_block* first = bin->head;
+    struct pool_block* last = first;
+    for(size_t i = 1; i < MEM_POOL_TCACHE_BATCH; i++)
+        last = last->next;
+    bin->head = last->next;
+    bin->count -= MEM_POOL_TCACHE_BATCH;
+    last->next = NULL;
+    depot_push(c, (struct pool_chain*)first);
+}
+
+void mem_pool_thread_flush(void) {
+    for(int c = 0; c < MEM_POOL_CLASS_COUNT; c++) {
+        struct tcache_bin* bin = &tcache[c];
+        while(bin->count >= MEM_POOL_TCACHE_BATCH)
+            tcache_spill(c, bin);
+        if(bin->head) {
+            struct pool_block* last = bin->head;
+            while(last->next)
+                last = last->next;
+            central_give(c, bin->head, last);
+        }
+        bin->head = NULL;
+        bin->count = 0;
+    }
+}
+
+int mem_pool_thread_cache(int enable) {
+    return __atomic_exchange_n(&tcache_enabled, enable != 0, __ATOMIC_RELAXED);
+}
+
+void* mem_pool_alloc(size_t bytes) {
+    int c = pool_class_index(bytes);
+    if(c < 0)
+        return NULL;
+    if(!__atomic_load_n(&tcache_enabled, __ATOMIC_RELAXED)) {
+        size_t taken;
+        return central_take(c, 1, &taken);
+    }
+
+    struct tcache_bin* bin = &tcache[c];
+    if(!bin->head) {
+        if(!tcache_registered)
+            tcache_register();
+        if(!tcache_refill(c, bin))
+            return NULL;
+    }
+    struct pool_block* block = bin->head;
+    bin->head = block->next;
+    bin->count--;
+    return block;
+}
+
+void mem_pool_free(void* ptr) {
+    struct pool_block* block = (struct pool_block*)ptr;
+    int c = pool_block_class(ptr);
+    if(!__atomic_load_n(&tcache_enabled, __ATOMIC_RELAXED)) {
+        central_give(c, block, block);
+        return;
+    }
+
+    struct tcache_bin* bin = &tcache[c];
+    if(!tcache_registered)
+        tcache_register();
+    block->next = bin->head;
+    bin->head = block;
+    if(++bin->count >= 2 * MEM_POOL_TCACHE_BATCH)
+        tcache_spill(c, bin);
+}
+#else
+void* mem_pool_alloc(size_t bytes) {
+    int c = pool_class_index(bytes);
+    if(c < 0)
+        return NULL;
+    size_t taken;
+    return central_take(c, 1, &taken);
+}
+
+void mem_pool_free(void* ptr) {
+    struct pool_block* block = (struct pool_block*)ptr;
+    central_give(pool_block_class(ptr), block, block);
+}
+#endif
+
+size_t mem_pool_usable_size(const void* ptr) {
+    return MEM_POOL_MIN_BLOCK << pool_block_class(ptr);
+}
+
+int mem_pool_owns(const void* ptr) {
+    return (const uint8_t*)ptr >= pool_arena &&
+           (const uint8_t*)ptr < pool_arena + MEM_POOL_ARENA_SIZE;
+}
@@ -21,8 +21,1311 @@
  *
  */
 
+#if defined (HOST)
+/* mmap flags, posix_memalign and syscall() are outside strict C99 */
+#define _GNU_SOURCE
+#endif
+
 #include <stdlib.h>
+#include <errno.h>
 #include "memory.h"
+#include "mem_pool.h"
+#include "mem_lock.h"
+#include "tlsf.h"
+#include "platform.h"
+
+/* Runtime selection between instruction sets is only done on x86 hosts. Every
+ * other build (MSP432 included) compiles the scalar kernels alone. */
+#if defined(HOST) && defined(__GNUC__) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define MEMORY_DISPATCH
+#include <string.h>
+#include <immintrin.h>
+#endif
+
+/* Large aligned buffers are mapped directly, on Linux hosts only */
+#if defined(HOST) && defined(__linux__)
+#define MEMORY_MMAP
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#endif
+
+#if defined (HOST)
+#include <unistd.h>
+#include <pthread.h>
+#endif
+
+/* 64-bit units for the bulk loops. may_alias keeps the byte buffers legal to
+ * access through them; the aligned(1) flavour is for the side that is not
+ * aligned (Cortex-M4 LDRD faults on unaligned addresses). */
+typedef uint64_t __attribute__((__may_alias__)) mem_word_t;
+typedef uint64_t __attribute__((__may_alias__, __aligned__(1))) mem_uword_t;
+#define MEM_WORD_SIZE (sizeof(mem_word_t))
+#define MEM_WORD_BROADCAST(b) ((mem_word_t)(b) * 0x0101010101010101ULL)
+
+#define MEM_KERNEL__(name, isa) name##_##isa
+#define MEM_KERNEL_(name, isa) MEM_KERNEL__(name, isa)
+#define MEM_KERNEL(name) MEM_KERNEL_(name, MEM_ISA)
+
+/***********************************************************
+ Kernels
+***********************************************************/
+/*
+ * Moves and fills of fewer than 8 bytes: pairs of possibly overlapping 4, 2 or
+ * 1 byte accesses, all loads before the stores.
+ */
+typedef uint32_t __attribute__((__may_alias__, __aligned__(1))) mem_u32_t;
+typedef uint16_t __attribute__((__may_alias__, __aligned__(1))) mem_u16_t;
+
+static inline __attribute__((always_inline))
+void move_tiny(uint8_t* dst, const uint8_t* src, size_t length) {
+    if(length >= 4) {
+        uint32_t head = *(const mem_u32_t*)src;
+        uint32_t tail = *(const mem_u32_t*)(src + length - 4);
+        *(mem_u32_t*)dst = head;
+        *(mem_u32_t*)(dst + length - 4) = tail;
+    } else if(length >= 2) {
+        uint16_t head = *(const mem_u16_t*)src;
+        uint16_t tail = *(const mem_u16_t*)(src + length - 2);
+        *(mem_u16_t*)dst = head;
+        *(mem_u16_t*)(dst + length - 2) = tail;
+    } else if(length == 1) {
+        *dst = *src;
+    }
+}
+
+/* An 8-byte fill pattern as seen from offset bytes further on */
+static inline uint64_t mem_pattern_at(uint64_t pattern, size_t offset) {
+    unsigned shift = (unsigned)(offset & 7) * 8;
+    return (pattern >> shift) | (pattern << ((64 - shift) & 63));
+}
+
+static inline __attribute__((always_inline))
+void fill_tiny(uint8_t* dst, uint64_t pattern, size_t length) {
+    if(length >= 4) {
+        *(mem_u32_t*)dst = (uint32_t)pattern;
+        *(mem_u32_t*)(dst + length - 4) = (uint32_t)pattern;
+    } else if(length >= 2) {
+        *(mem_u16_t*)dst = (uint16_t)pattern;
+        *(mem_u16_t*)(dst + length - 2) = (uint16_t)pattern;
+    } else if(length == 1) {
+        *dst = (uint8_t)pattern;
+    }
+}
+
+/*
+ * Byte swaps. The M4 has single-cycle REV and REV16, reached through CMSIS;
+ * elsewhere the compiler builtins map to bswap or equivalent.
+ */
+static inline uint16_t mem_bswap16(uint16_t x) {
+#if defined (MSP432)
+    return (uint16_t)__REV16(x);
+#else
+    return __builtin_bswap16(x);
+#endif
+}
+
+static inline uint32_t mem_bswap32(uint32_t x) {
+#if defined (MSP432)
+    return __REV(x);
+#else
+    return __builtin_bswap32(x);
+#endif
+}
+
+static inline uint64_t mem_bswap64(uint64_t x) {
+#if defined (MSP432)
+    return (uint64_t)__REV((uint32_t)x) << 32 | __REV((uint32_t)(x >> 32));
+#else
+    return __builtin_bswap64(x);
+#endif
+}
+
+/* Two 16-bit, 32-bit or word-order swaps in one 64-bit word */
+static inline uint64_t mem_bswap16x4(uint64_t x) {
+#if defined (MSP432)
+    return (uint64_t)__REV16((uint32_t)(x >> 32)) << 32 | __REV16((uint32_t)x);
+#else
+    return (x & 0x00FF00FF00FF00FFULL) << 8 | ((x >> 8) & 0x00FF00FF00FF00FFULL);
+#endif
+}
+
+static inline uint64_t mem_bswap32x2(uint64_t x) {
+#if defined (MSP432)
+    return (uint64_t)__REV((uint32_t)(x >> 32)) << 32 | __REV((uint32_t)x);
+#else
+    x = __builtin_bswap64(x);
+    return x << 32 | x >> 32;
+#endif
+}
+
+static inline uint64_t mem_swap32x2(uint64_t x) {
+    return x << 32 | x >> 32;
+}
+
+/*
+ * Reverses fewer than 8 bytes: a byte-swapped pair of possibly overlapping
+ * 4 byte accesses (where they overlap they write the same bytes), or for 2 and
+ * 3 bytes a swap of the end bytes. Fewer than 8 bytes hold at most one word,
+ * so there is nothing to do when reversing words.
+ */
+static inline __attribute__((always_inline))
+void reverse_tiny(uint8_t* src, size_t length, int words) {
+    if(words)
+        return;
+    if(length >= 4) {
+        uint32_t head = *(const mem_u32_t*)src;
+        uint32_t tail = *(const mem_u32_t*)(src + length - 4);
+        *(mem_u32_t*)src = mem_bswap32(tail);
+        *(mem_u32_t*)(src + length - 4) = mem_bswap32(head);
+    } else if(length >= 2) {
+        uint8_t head = src[0];
+        src[0] = src[length - 1];
+        src[length - 1] = head;
+    }
+}
+
+/* Element-wise byte swaps of fewer than 8 bytes */
+static inline __attribute__((always_inline))
+void bswap16_tiny(uint8_t* dst, const uint8_t* src, size_t length) {
+    for(; length >= 2; length -= 2, src += 2, dst += 2)
+        *(mem_u16_t*)dst = mem_bswap16(*(const mem_u16_t*)src);
+}
+
+static inline __attribute__((always_inline))
+void bswap32_tiny(uint8_t* dst, const uint8_t* src, size_t length) {
+    if(length >= 4)
+        *(mem_u32_t*)dst = mem_bswap32(*(const mem_u32_t*)src);
+}
+
+/*
+ * Searches and compares of fewer than 8 bytes (fewer than 8 candidate
+ * positions for memmem) are plain byte loops.
+ */
+static const uint8_t* memchr_tiny(const uint8_t* src, uint8_t value,
+                                  size_t length) {
+    for(; length; length--, src++)
+        if(*src == value)
+            return src;
+    return NULL;
+}
+
+static const uint8_t* memrchr_tiny(const uint8_t* src, uint8_t value,
+                                   size_t length) {
+    while(length--)
+        if(src[length] == value)
+            return src + length;
+    return NULL;
+}
+
+static int memcmp_tiny(const uint8_t* a, const uint8_t* b, size_t length) {
+    for(; length; length--, a++, b++)
+        if(*a != *b)
+            return (int)*a - (int)*b;
+    return 0;
+}
+
+static const uint8_t* memmem_tiny(const uint8_t* haystack,
+                                  size_t haystack_length,
+                                  const uint8_t* needle,
+                                  size_t needle_length) {
+    const uint8_t* end = haystack + haystack_length - needle_length;
+    for(; haystack <= end; haystack++)
+        if(memcmp_tiny(haystack, needle, needle_length) == 0)
+            return haystack;
+    return NULL;
+}
+
+/*
+ * 0x80 in every byte of x that is zero and 0 elsewhere. Adding 0x7F to the low
+ * seven bits carries into the top bit exactly when they are non-zero, so unlike
+ * the shorter (x - 0x01..) & ~x form there are no false positives above a zero
+ * byte, and the last match can be found as reliably as the first.
+ */
+static inline uint64_t mem_zero_bytes(uint64_t x) {
+    const uint64_t low7 = 0x7F7F7F7F7F7F7F7FULL;
+    return ~(((x & low7) + low7) | x | low7);
+}
+
+/*
+ * Strided accesses the vector tiers do not split, unrolled by four with the
+ * loads ahead of the stores.
+ */
+static void get_strided_tiny(uint8_t* dst, const uint8_t* src, size_t stride,
+                             size_t count) {
+    size_t i = 0;
+    for(; i + 4 <= count; i += 4) {
+        uint8_t b0 = src[i * stride];
+        uint8_t b1 = src[(i + 1) * stride];
+        uint8_t b2 = src[(i + 2) * stride];
+        uint8_t b3 = src[(i + 3) * stride];
+        dst[i] = b0;
+        dst[i + 1] = b1;
+        dst[i + 2] = b2;
+        dst[i + 3] = b3;
+    }
+    for(; i < count; i++)
+        dst[i] = src[i * stride];
+}
+
+static void set_strided_tiny(uint8_t* dst, const uint8_t* src, size_t stride,
+                             size_t count) {
+    size_t i = 0;
+    for(; i + 4 <= count; i += 4) {
+        uint8_t b0 = src[i];
+        uint8_t b1 = src[i + 1];
+        uint8_t b2 = src[i + 2];
+        uint8_t b3 = src[i + 3];
+        dst[i * stride] = b0;
+        dst[(i + 1) * stride] = b1;
+        dst[(i + 2) * stride] = b2;
+        dst[(i + 3) * stride] = b3;
+    }
+    for(; i < count; i++)
+        dst[i * stride] = src[i];
+}
+
+/* Eight bytes stride apart gathered into one word, first byte lowest, and the
+ * reverse */
+static inline __attribute__((always_inline))
+uint64_t load_strided_word(const uint8_t* src, size_t stride) {
+    uint64_t word = 0;
+    for(int k = 7; k >= 0; k--)
+        word = word << 8 | src[k * stride];
+    return word;
+}
+
+static inline __attribute__((always_inline))
+void store_strided_word(uint8_t* dst, size_t stride, uint64_t word) {
+    for(int k = 0; k < 8; k++, word >>= 8)
+        dst[k * stride] = (uint8_t)word;
+}
+
+/* Transposes of fewer rows or columns than a block, element by element */
+static void transpose_tiny(uint8_t* dst, size_t dst_pitch, const uint8_t* src,
+                           size_t src_pitch, size_t width, size_t height) {
+    for(size_t r = 0; r < height; r++)
+        for(size_t c = 0; c < width; c++)
+            dst[c * dst_pitch + r] = src[r * src_pitch + c];
+}
+
+/*
+ * 8x8 bytes held as one word per row, first column lowest. Swapping the
+ * off-diagonal 4x4 quadrants, then the off-diagonal 2x2 blocks of each
+ * quadrant, then the off-diagonal bytes of each 2x2 block transposes it.
+ */
+static inline __attribute__((always_inline))
+void mem_transpose_swap(uint64_t* a, uint64_t* b, int shift, uint64_t mask) {
+    uint64_t t = ((*a >> shift) ^ *b) & mask;
+    *a ^= t << shift;
+    *b ^= t;
+}
+
+static inline __attribute__((always_inline))
+void transpose8x8_scalar(uint8_t* dst, size_t dst_pitch, const uint8_t* src,
+                         size_t src_pitch) {
+    uint64_t w[8];
+    for(int r = 0; r < 8; r++)
+        w[r] = *(const mem_uword_t*)(src + r * src_pitch);
+    for(int r = 0; r < 4; r++)
+        mem_transpose_swap(&w[r], &w[r + 4], 32, 0x00000000FFFFFFFFULL);
+    for(int r = 0; r < 8; r += (r & 1) ? 3 : 1)
+        mem_transpose_swap(&w[r], &w[r + 2], 16, 0x0000FFFF0000FFFFULL);
+    for(int r = 0; r < 8; r += 2)
+        mem_transpose_swap(&w[r], &w[r + 1], 8, 0x00FF00FF00FF00FFULL);
+    for(int r = 0; r < 8; r++)
+        *(mem_uword_t*)(dst + r * dst_pitch) = w[r];
+}
+
+/* Scalar: the "vector" is one 64-bit word */
+#define MEM_ISA             scalar
+#define mem_vec_t           mem_word_t
+#define MEM_VEC_SIZE        (8)
+#define MEM_VEC_LOAD(p)     (*(const mem_uword_t*)(p))
+#define MEM_VEC_STORE(p, v) (*(mem_word_t*)(p) = (v))
+#define MEM_VEC_STOREU(p, v) (*(mem_uword_t*)(p) = (v))
+#define MEM_VEC_SET1(b)     MEM_WORD_BROADCAST(b)
+#define MEM_VEC_SET1_64(w)  ((mem_word_t)(w))
+#define MEM_VEC_REVERSE(v)  mem_bswap64(v)
+#define MEM_VEC_REVERSE32(v) mem_swap32x2(v)
+#define MEM_VEC_BSWAP16(v)  mem_bswap16x4(v)
+#define MEM_VEC_BSWAP32(v)  mem_bswap32x2(v)
+#define MEM_PREV_MOVE_SMALL move_tiny
+#define MEM_PREV_FILL_SMALL fill_tiny
+#define MEM_PREV_REVERSE_SMALL reverse_tiny
+#define MEM_PREV_BSWAP16    bswap16_tiny
+#define MEM_PREV_BSWAP32    bswap32_tiny
+/* At most one word, which reads the same either way */
+#define MEM_PREV_REVERSE_WORDS_COPY move_tiny
+/* SWAR: one flag bit at the top of each matching byte; bytes in memory order
+ * are least significant first on both x86 and the M4 */
+#define MEM_VEC_EQ_MASK(a, b) mem_zero_bytes((a) ^ (b))
+#define MEM_MASK_FIRST(m)   ((size_t)__builtin_ctzll(m) >> 3)
+#define MEM_MASK_LAST(m)    ((size_t)(63 - __builtin_clzll(m)) >> 3)
+#define MEM_MASK_ALL        (0x8080808080808080ULL)
+#define MEM_PREV_MEMCHR     memchr_tiny
+#define MEM_PREV_MEMRCHR    memrchr_tiny
+#define MEM_PREV_MEMCMP     memcmp_tiny
+#define MEM_PREV_MEMMEM     memmem_tiny
+#define MEM_VEC_LOAD_STRIDED(p, s) load_strided_word(p, s)
+#define MEM_VEC_STORE_STRIDED(p, s, v) store_strided_word(p, s, v)
+#define MEM_PREV_GET_STRIDED get_strided_tiny
+#define MEM_PREV_SET_STRIDED set_strided_tiny
+#define MEM_TRANSPOSE_ROWS  (8)
+#define MEM_TRANSPOSE_BLOCK transpose8x8_scalar
+#define MEM_PREV_TRANSPOSE  transpose_tiny
+#if defined(MEMORY_DISPATCH) && defined(__x86_64__)
+#define MEM_VEC_STREAM(p, v) _mm_stream_si64((long long*)(p), (long long)(v))
+#define MEM_SCALAR_FILL_STREAM fill_stream_scalar
+#else
+#define MEM_SCALAR_FILL_STREAM NULL
+#endif
+#include "memory_kernels.inc"
+
+#ifdef MEMORY_DISPATCH
+#pragma GCC push_options
+#pragma GCC target("sse2")
+/* SSE2 has no byte shuffle: swap the bytes of each 16-bit lane, then reverse
+ * the lanes. */
+static inline __m128i reverse_vec_sse2(__m128i v) {
+    v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+    v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+    v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+    return _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+}
+
+static inline __m128i bswap16_vec_sse2(__m128i v) {
+    return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+
+static inline __m128i bswap32_vec_sse2(__m128i v) {
+    v = bswap16_vec_sse2(v);
+    v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+    return _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+}
+
+/* Two and four channels: keep the low byte of each 16/32-bit lane and narrow.
+ * The saturating packs cannot clip values below 256. */
+static inline __m128i load_stride2_sse2(const uint8_t* src) {
+    const __m128i low = _mm_set1_epi16(0xFF);
+    __m128i a = _mm_loadu_si128((const __m128i*)src);
+    __m128i b = _mm_loadu_si128((const __m128i*)(src + 16));
+    return _mm_packus_epi16(_mm_and_si128(a, low), _mm_and_si128(b, low));
+}
+
+static inline __m128i load_stride4_sse2(const uint8_t* src) {
+    const __m128i low = _mm_set1_epi32(0xFF);
+    __m128i a = _mm_and_si128(_mm_loadu_si128((const __m128i*)src), low);
+    __m128i b = _mm_and_si128(_mm_loadu_si128((const __m128i*)(src + 16)), low);
+    __m128i c = _mm_and_si128(_mm_loadu_si128((const __m128i*)(src + 32)), low);
+    __m128i d = _mm_and_si128(_mm_loadu_si128((const __m128i*)(src + 48)), low);
+    return _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+}
+
+/* Three channels need a byte shuffle, so build the two halves as words */
+static inline __m128i load_stride3_sse2(const uint8_t* src) {
+    return _mm_set_epi64x((long long)load_strided_word(src + 24, 3),
+                          (long long)load_strided_word(src, 3));
+}
+
+/* Overwrites the bytes of dst selected by a zero in keep with those of v */
+static inline void merge_sse2(uint8_t* dst, __m128i keep, __m128i v) {
+    __m128i old = _mm_loadu_si128((const __m128i*)dst);
+    _mm_storeu_si128((__m128i*)dst, _mm_or_si128(_mm_and_si128(old, keep), v));
+}
+
+/* Interleaving widens with zero bytes and merges */
+static inline void store_stride2_sse2(uint8_t* dst, __m128i v) {
+    const __m128i keep = _mm_set1_epi16((short)0xFF00);
+    __m128i zero = _mm_setzero_si128();
+    merge_sse2(dst, keep, _mm_unpacklo_epi8(v, zero));
+    merge_sse2(dst + 16, keep, _mm_unpackhi_epi8(v, zero));
+}
+
+static inline void store_stride4_sse2(uint8_t* dst, __m128i v) {
+    const __m128i keep = _mm_set1_epi32((int)0xFFFFFF00);
+    __m128i zero = _mm_setzero_si128();
+    __m128i lo = _mm_unpacklo_epi8(v, zero);
+    __m128i hi = _mm_unpackhi_epi8(v, zero);
+    merge_sse2(dst, keep, _mm_unpacklo_epi16(lo, zero));
+    merge_sse2(dst + 16, keep, _mm_unpackhi_epi16(lo, zero));
+    merge_sse2(dst + 32, keep, _mm_unpacklo_epi16(hi, zero));
+    merge_sse2(dst + 48, keep, _mm_unpackhi_epi16(hi, zero));
+}
+
+static inline void store_stride3_sse2(uint8_t* dst, __m128i v) {
+    uint64_t words[2];
+    _mm_storeu_si128((__m128i*)words, v);
+    store_strided_word(dst, 3, words[0]);
+    store_strided_word(dst + 24, 3, words[1]);
+}
+
+#define MEM_ISA             sse2
+#define mem_vec_t           __m128i
+#define MEM_VEC_SIZE        (16)
+#define MEM_VEC_LOAD(p)     _mm_loadu_si128((const __m128i*)(p))
+#define MEM_VEC_STORE(p, v) _mm_store_si128((__m128i*)(p), (v))
+#define MEM_VEC_STOREU(p, v) _mm_storeu_si128((__m128i*)(p), (v))
+#define MEM_VEC_SET1(b)     _mm_set1_epi8((char)(b))
+#define MEM_VEC_SET1_64(w)  _mm_set1_epi64x((long long)(w))
+#define MEM_VEC_REVERSE(v)  reverse_vec_sse2(v)
+#define MEM_VEC_REVERSE32(v) _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3))
+#define MEM_VEC_BSWAP16(v)  bswap16_vec_sse2(v)
+#define MEM_VEC_BSWAP32(v)  bswap32_vec_sse2(v)
+#define MEM_PREV_MOVE_SMALL move_small_scalar
+#define MEM_PREV_FILL_SMALL fill_small_scalar
+#define MEM_PREV_REVERSE_SMALL reverse_small_scalar
+#define MEM_PREV_BSWAP16    bswap16_scalar
+#define MEM_PREV_BSWAP32    bswap32_scalar
+#define MEM_PREV_REVERSE_WORDS_COPY reverse_words_copy_scalar
+#define MEM_VEC_EQ_MASK(a, b) \
+    (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(a, b))
+#define MEM_MASK_FIRST(m)   ((size_t)__builtin_ctzll(m))
+#define MEM_MASK_LAST(m)    ((size_t)(63 - __builtin_clzll(m)))
+#define MEM_MASK_ALL        (0xFFFFULL)
+#define MEM_PREV_MEMCHR     memchr_scalar
+#define MEM_PREV_MEMRCHR    memrchr_scalar
+#define MEM_PREV_MEMCMP     memcmp_scalar
+#define MEM_PREV_MEMMEM     memmem_scalar
+#define MEM_VEC_LOAD_STRIDED(p, s) load_stride##s##_sse2(p)
+#define MEM_VEC_STORE_STRIDED(p, s, v) store_stride##s##_sse2(p, v)
+#define MEM_PREV_GET_STRIDED get_strided_scalar
+#define MEM_PREV_SET_STRIDED set_strided_scalar
+#define MEM_VEC_UNPACKLO8(a, b) _mm_unpacklo_epi8(a, b)
+#define MEM_VEC_UNPACKHI8(a, b) _mm_unpackhi_epi8(a, b)
+#define MEM_VEC_STORE_LANES(p, pitch, v) MEM_VEC_STOREU(p, v)
+#define MEM_PREV_TRANSPOSE  transpose_scalar
+#define MEM_VEC_STREAM(p, v) _mm_stream_si128((__m128i*)(p), (v))
+#include "memory_kernels.inc"
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx2")
+static inline __m128i reverse_vec_ssse3(__m128i v) {
+    return _mm_shuffle_epi8(v, _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8,
+                                             7, 6, 5, 4, 3, 2, 1, 0));
+}
+
+/* pshufb in both 128-bit lanes, then swap the lanes */
+static inline __m256i reverse_vec_avx2(__m256i v) {
+    v = _mm256_shuffle_epi8(v, _mm256_broadcastsi128_si256(
+            _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0)));
+    return _mm256_permute4x64_epi64(v, _MM_SHUFFLE(1, 0, 3, 2));
+}
+
+static inline __m256i bswap16_vec_avx2(__m256i v) {
+    return _mm256_shuffle_epi8(v, _mm256_broadcastsi128_si256(
+            _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14)));
+}
+
+static inline __m256i bswap32_vec_avx2(__m256i v) {
+    return _mm256_shuffle_epi8(v, _mm256_broadcastsi128_si256(
+            _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12)));
+}
+
+/* 16 to 32 bytes with one pshufb (or word shuffle) per end, shorter runs as
+ * scalar */
+static inline __attribute__((always_inline))
+void reverse_small_ssse3(uint8_t* src, size_t length, int words) {
+    if(length >= 16) {
+        __m128i head = _mm_loadu_si128((const __m128i*)src);
+        __m128i tail = _mm_loadu_si128((const __m128i*)(src + length - 16));
+        if(words) {
+            head = _mm_shuffle_epi32(head, _MM_SHUFFLE(0, 1, 2, 3));
+            tail = _mm_shuffle_epi32(tail, _MM_SHUFFLE(0, 1, 2, 3));
+        } else {
+            head = reverse_vec_ssse3(head);
+            tail = reverse_vec_ssse3(tail);
+        }
+        _mm_storeu_si128((__m128i*)src, tail);
+        _mm_storeu_si128((__m128i*)(src + length - 16), head);
+    } else {
+        reverse_small_scalar(src, length, words);
+    }
+}
+
+/* Three channels: one pshufb per 16 input bytes moves the bytes that belong
+ * to the output into place and zeroes the rest */
+static inline __m128i load_stride3_ssse3(const uint8_t* src) {
+    __m128i a = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)src),
+        _mm_setr_epi8(0, 3, 6, 9, 12, 15, -1, -1,
+                      -1, -1, -1, -1, -1, -1, -1, -1));
+    __m128i b = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src + 16)),
+        _mm_setr_epi8(-1, -1, -1, -1, -1, -1, 2, 5,
+                      8, 11, 14, -1, -1, -1, -1, -1));
+    __m128i c = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src + 32)),
+        _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1,
+                      -1, -1, -1, 1, 4, 7, 10, 13));
+    return _mm_or_si128(_mm_or_si128(a, b), c);
+}
+
+/* The inverse shuffles; their -1 entries also select the bytes to keep */
+static inline void merge_stride3_ssse3(uint8_t* dst, __m128i v, __m128i map) {
+    __m128i old = _mm_loadu_si128((const __m128i*)dst);
+    _mm_storeu_si128((__m128i*)dst,
+                     _mm_blendv_epi8(_mm_shuffle_epi8(v, map), old, map));
+}
+
+static inline void store_stride3_ssse3(uint8_t* dst, __m128i v) {
+    merge_stride3_ssse3(dst, v, _mm_setr_epi8(0, -1, -1, 1, -1, -1, 2, -1,
+                                              -1, 3, -1, -1, 4, -1, -1, 5));
+    merge_stride3_ssse3(dst + 16, v, _mm_setr_epi8(-1, -1, 6, -1, -1, 7, -1, -1,
+                                                   8, -1, -1, 9, -1, -1, 10, -1));
+    merge_stride3_ssse3(dst + 32, v, _mm_setr_epi8(-1, 11, -1, -1, 12, -1, -1, 13,
+                                                   -1, -1, 14, -1, -1, 15, -1, -1));
+}
+
+/* The packs work within 128-bit lanes; a cross-lane permute restores order */
+static inline __m256i load_stride2_avx2(const uint8_t* src) {
+    const __m256i low = _mm256_set1_epi16(0xFF);
+    __m256i a = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)src), low);
+    __m256i b = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)(src + 32)),
+                                 low);
+    return _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b),
+                                    _MM_SHUFFLE(3, 1, 2, 0));
+}
+
+static inline __m256i load_stride4_avx2(const uint8_t* src) {
+    const __m256i low = _mm256_set1_epi32(0xFF);
+    __m256i a = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)src), low);
+    __m256i b = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)(src + 32)),
+                                 low);
+    __m256i c = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)(src + 64)),
+                                 low);
+    __m256i d = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)(src + 96)),
+                                 low);
+    __m256i v = _mm256_packus_epi16(_mm256_packus_epi32(a, b),
+                                    _mm256_packus_epi32(c, d));
+    return _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(0, 4, 1, 5,
+                                                             2, 6, 3, 7));
+}
+
+static inline __m256i load_stride3_avx2(const uint8_t* src) {
+    return _mm256_inserti128_si256(
+        _mm256_castsi128_si256(load_stride3_ssse3(src)),
+        load_stride3_ssse3(src + 48), 1);
+}
+
+static inline void merge_avx2(uint8_t* dst, __m256i keep, __m256i v) {
+    __m256i old = _mm256_loadu_si256((const __m256i*)dst);
+    _mm256_storeu_si256((__m256i*)dst,
+                        _mm256_or_si256(_mm256_and_si256(old, keep), v));
+}
+
+static inline void store_stride2_avx2(uint8_t* dst, __m256i v) {
+    const __m256i keep = _mm256_set1_epi16((short)0xFF00);
+    merge_avx2(dst, keep, _mm256_cvtepu8_epi16(_mm256_castsi256_si128(v)));
+    merge_avx2(dst + 32, keep,
+               _mm256_cvtepu8_epi16(_mm256_extracti128_si256(v, 1)));
+}
+
+static inline void store_stride4_avx2(uint8_t* dst, __m256i v) {
+    const __m256i keep = _mm256_set1_epi32((int)0xFFFFFF00);
+    __m128i lo = _mm256_castsi256_si128(v);
+    __m128i hi = _mm256_extracti128_si256(v, 1);
+    merge_avx2(dst, keep, _mm256_cvtepu8_epi32(lo));
+    merge_avx2(dst + 32, keep, _mm256_cvtepu8_epi32(_mm_srli_si128(lo, 8)));
+    merge_avx2(dst + 64, keep, _mm256_cvtepu8_epi32(hi));
+    merge_avx2(dst + 96, keep, _mm256_cvtepu8_epi32(_mm_srli_si128(hi, 8)));
+}
+
+static inline void store_stride3_avx2(uint8_t* dst, __m256i v) {
+    store_stride3_ssse3(dst, _mm256_castsi256_si128(v));
+    store_stride3_ssse3(dst + 48, _mm256_extracti128_si256(v, 1));
+}
+
+#define MEM_ISA             avx2
+#define mem_vec_t           __m256i
+#define MEM_VEC_SIZE        (32)
+#define MEM_VEC_LOAD(p)     _mm256_loadu_si256((const __m256i*)(p))
+#define MEM_VEC_STORE(p, v) _mm256_store_si256((__m256i*)(p), (v))
+#define MEM_VEC_STOREU(p, v) _mm256_storeu_si256((__m256i*)(p), (v))
+#define MEM_VEC_SET1(b)     _mm256_set1_epi8((char)(b))
+#define MEM_VEC_SET1_64(w)  _mm256_set1_epi64x((long long)(w))
+#define MEM_VEC_REVERSE(v)  reverse_vec_avx2(v)
+#define MEM_VEC_REVERSE32(v) \
+    _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0))
+#define MEM_VEC_BSWAP16(v)  bswap16_vec_avx2(v)
+#define MEM_VEC_BSWAP32(v)  bswap32_vec_avx2(v)
+#define MEM_PREV_MOVE_SMALL move_small_sse2
+#define MEM_PREV_FILL_SMALL fill_small_sse2
+#define MEM_PREV_REVERSE_SMALL reverse_small_ssse3
+/* Handing off to SSE-encoded code with the upper vector halves dirty makes
+ * every SSE instruction stall on some CPUs. GCC can hoist a broadcast above
+ * the length check and then tail-call without vzeroupper, so clear the upper
+ * halves explicitly on the way to the SSE2 kernels. */
+#define MEM_PREV_BSWAP16(d, s, n) (_mm256_zeroupper(), bswap16_sse2(d, s, n))
+#define MEM_PREV_BSWAP32(d, s, n) (_mm256_zeroupper(), bswap32_sse2(d, s, n))
+#define MEM_PREV_REVERSE_WORDS_COPY(d, s, n) \
+    (_mm256_zeroupper(), reverse_words_copy_sse2(d, s, n))
+#define MEM_VEC_EQ_MASK(a, b) \
+    (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b))
+#define MEM_MASK_FIRST(m)   ((size_t)__builtin_ctzll(m))
+#define MEM_MASK_LAST(m)    ((size_t)(63 - __builtin_clzll(m)))
+#define MEM_MASK_ALL        (0xFFFFFFFFULL)
+#define MEM_PREV_MEMCHR(p, b, n) (_mm256_zeroupper(), memchr_sse2(p, b, n))
+#define MEM_PREV_MEMRCHR(p, b, n) (_mm256_zeroupper(), memrchr_sse2(p, b, n))
+#define MEM_PREV_MEMCMP(a, b, n) (_mm256_zeroupper(), memcmp_sse2(a, b, n))
+#define MEM_PREV_MEMMEM(h, hn, n, nn) \
+    (_mm256_zeroupper(), memmem_sse2(h, hn, n, nn))
+#define MEM_VEC_LOAD_STRIDED(p, s) load_stride##s##_avx2(p)
+#define MEM_VEC_STORE_STRIDED(p, s, v) store_stride##s##_avx2(p, v)
+#define MEM_PREV_GET_STRIDED(d, s, st, n) \
+    (_mm256_zeroupper(), get_strided_sse2(d, s, st, n))
+#define MEM_PREV_SET_STRIDED(d, s, st, n) \
+    (_mm256_zeroupper(), set_strided_sse2(d, s, st, n))
+#define MEM_VEC_UNPACKLO8(a, b) _mm256_unpacklo_epi8(a, b)
+#define MEM_VEC_UNPACKHI8(a, b) _mm256_unpackhi_epi8(a, b)
+#define MEM_VEC_STORE_LANES(p, pitch, v) \
+    _mm256_storeu2_m128i((__m128i*)((p) + (pitch)), (__m128i*)(p), v)
+#define MEM_PREV_TRANSPOSE(d, dp, s, sp, w, h) \
+    (_mm256_zeroupper(), transpose_sse2(d, dp, s, sp, w, h))
+#define MEM_VEC_STREAM(p, v) _mm256_stream_si256((__m256i*)(p), (v))
+#include "memory_kernels.inc"
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx512f,avx512bw")
+/* vpshufb in all four 128-bit lanes, then reverse the lanes */
+static inline __m512i reverse_vec_avx512(__m512i v) {
+    v = _mm512_shuffle_epi8(v, _mm512_broadcast_i32x4(
+            _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0)));
+    return _mm512_shuffle_i64x2(v, v, _MM_SHUFFLE(0, 1, 2, 3));
+}
+
+static inline __m512i bswap16_vec_avx512(__m512i v) {
+    return _mm512_shuffle_epi8(v, _mm512_broadcast_i32x4(
+            _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14)));
+}
+
+static inline __m512i bswap32_vec_avx512(__m512i v) {
+    return _mm512_shuffle_epi8(v, _mm512_broadcast_i32x4(
+            _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12)));
+}
+
+/* Two and four channels narrow with vpmovwb/vpmovdb. Interleaving reuses the
+ * AVX2 merges, which measured no slower than widening under a byte-masked
+ * store. */
+static inline __m512i load_stride2_avx512(const uint8_t* src) {
+    __m256i a = _mm512_cvtepi16_epi8(_mm512_loadu_si512((const void*)src));
+    __m256i b = _mm512_cvtepi16_epi8(_mm512_loadu_si512((const void*)(src + 64)));
+    return _mm512_inserti64x4(_mm512_castsi256_si512(a), b, 1);
+}
+
+static inline __m512i load_stride4_avx512(const uint8_t* src) {
+    __m512i v = _mm512_castsi128_si512(
+        _mm512_cvtepi32_epi8(_mm512_loadu_si512((const void*)src)));
+    v = _mm512_inserti32x4(v, _mm512_cvtepi32_epi8(
+            _mm512_loadu_si512((const void*)(src + 64))), 1);
+    v = _mm512_inserti32x4(v, _mm512_cvtepi32_epi8(
+            _mm512_loadu_si512((const void*)(src + 128))), 2);
+    return _mm512_inserti32x4(v, _mm512_cvtepi32_epi8(
+            _mm512_loadu_si512((const void*)(src + 192))), 3);
+}
+
+static inline __m512i load_stride3_avx512(const uint8_t* src) {
+    return _mm512_inserti64x4(_mm512_castsi256_si512(load_stride3_avx2(src)),
+                              load_stride3_avx2(src + 96), 1);
+}
+
+static inline void store_stride2_avx512(uint8_t* dst, __m512i v) {
+    store_stride2_avx2(dst, _mm512_castsi512_si256(v));
+    store_stride2_avx2(dst + 64, _mm512_extracti64x4_epi64(v, 1));
+}
+
+static inline void store_stride4_avx512(uint8_t* dst, __m512i v) {
+    store_stride4_avx2(dst, _mm512_castsi512_si256(v));
+    store_stride4_avx2(dst + 128, _mm512_extracti64x4_epi64(v, 1));
+}
+
+static inline void store_stride3_avx512(uint8_t* dst, __m512i v) {
+    store_stride3_avx2(dst, _mm512_castsi512_si256(v));
+    store_stride3_avx2(dst + 96, _mm512_extracti64x4_epi64(v, 1));
+}
+
+static inline void store_lanes_avx512(uint8_t* dst, size_t pitch, __m512i v) {
+    _mm_storeu_si128((__m128i*)dst, _mm512_castsi512_si128(v));
+    _mm_storeu_si128((__m128i*)(dst + pitch), _mm512_extracti32x4_epi32(v, 1));
+    _mm_storeu_si128((__m128i*)(dst + 2 * pitch),
+                     _mm512_extracti32x4_epi32(v, 2));
+    _mm_storeu_si128((__m128i*)(dst + 3 * pitch),
+                     _mm512_extracti32x4_epi32(v, 3));
+}
+
+/* Byte-masked load and store; masked-off bytes are never accessed */
+static inline void copy_partial_avx512(uint8_t* dst, const uint8_t* src,
+                                       size_t length) {
+    __mmask64 mask = length >= 64 ? ~0ULL : (1ULL << length) - 1;
+    _mm512_mask_storeu_epi8(dst, mask, _mm512_maskz_loadu_epi8(mask, src));
+}
+
+#define MEM_ISA             avx512
+#define mem_vec_t           __m512i
+#define MEM_VEC_SIZE        (64)
+#define MEM_VEC_LOAD(p)     _mm512_loadu_si512((const void*)(p))
+#define MEM_VEC_STORE(p, v) _mm512_store_si512((void*)(p), (v))
+#define MEM_VEC_STOREU(p, v) _mm512_storeu_si512((void*)(p), (v))
+#define MEM_VEC_SET1(b)     _mm512_set1_epi8((char)(b))
+#define MEM_VEC_SET1_64(w)  _mm512_set1_epi64((long long)(w))
+#define MEM_VEC_REVERSE(v)  reverse_vec_avx512(v)
+#define MEM_VEC_REVERSE32(v) _mm512_permutexvar_epi32(_mm512_setr_epi32( \
+    15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0), v)
+#define MEM_VEC_BSWAP16(v)  bswap16_vec_avx512(v)
+#define MEM_VEC_BSWAP32(v)  bswap32_vec_avx512(v)
+#define MEM_PREV_MOVE_SMALL move_small_avx2
+#define MEM_PREV_FILL_SMALL fill_small_avx2
+#define MEM_PREV_REVERSE_SMALL reverse_small_avx2
+#define MEM_PREV_BSWAP16    bswap16_avx2
+#define MEM_PREV_BSWAP32    bswap32_avx2
+#define MEM_PREV_REVERSE_WORDS_COPY reverse_words_copy_avx2
+#define MEM_VEC_EQ_MASK(a, b) \
+    (uint64_t)_mm512_cmpeq_epi8_mask(a, b)
+#define MEM_MASK_FIRST(m)   ((size_t)__builtin_ctzll(m))
+#define MEM_MASK_LAST(m)    ((size_t)(63 - __builtin_clzll(m)))
+#define MEM_MASK_ALL        (~0ULL)
+#define MEM_PREV_MEMCHR     memchr_avx2
+#define MEM_PREV_MEMRCHR    memrchr_avx2
+#define MEM_PREV_MEMCMP     memcmp_avx2
+#define MEM_PREV_MEMMEM     memmem_avx2
+#define MEM_VEC_LOAD_STRIDED(p, s) load_stride##s##_avx512(p)
+#define MEM_VEC_STORE_STRIDED(p, s, v) store_stride##s##_avx512(p, v)
+#define MEM_PREV_GET_STRIDED get_strided_avx2
+#define MEM_PREV_SET_STRIDED set_strided_avx2
+#define MEM_VEC_UNPACKLO8(a, b) _mm512_unpacklo_epi8(a, b)
+#define MEM_VEC_UNPACKHI8(a, b) _mm512_unpackhi_epi8(a, b)
+#define MEM_VEC_STORE_LANES(p, pitch, v) store_lanes_avx512(p, pitch, v)
+#define MEM_PREV_TRANSPOSE  transpose_avx2
+#define MEM_VEC_STREAM(p, v) _mm512_stream_si512((void*)(p), (v))
+#define MEM_VEC_COPY_PARTIAL(d, s, n) copy_partial_avx512(d, s, n)
+#include "memory_kernels.inc"
+#pragma GCC pop_options
+#endif /* MEMORY_DISPATCH */
+
+/***********************************************************
+ Dispatch
+***********************************************************/
+struct memory_kernels {
+    void (*copy)(uint8_t* dst, const uint8_t* src, size_t length);
+    void (*move)(uint8_t* dst, const uint8_t* src, size_t length);
+    void (*fill)(uint8_t* dst, uint64_t pattern, size_t length);
+    void (*reverse)(uint8_t* src, size_t length);
+    void (*reverse_words)(uint8_t* src, size_t length);
+    void (*reverse_words_copy)(uint8_t* dst, const uint8_t* src, size_t length);
+    void (*bswap16)(uint8_t* dst, const uint8_t* src, size_t length);
+    void (*bswap32)(uint8_t* dst, const uint8_t* src, size_t length);
+    const uint8_t* (*memchr)(const uint8_t* src, uint8_t value, size_t length);
+    const uint8_t* (*memrchr)(const uint8_t* src, uint8_t value, size_t length);
+    int (*memcmp)(const uint8_t* a, const uint8_t* b, size_t length);
+    /* needle_length >= 2 and <= haystack_length */
+    const uint8_t* (*memmem)(const uint8_t* haystack, size_t haystack_length,
+                             const uint8_t* needle, size_t needle_length);
+    void (*get_strided)(uint8_t* dst, const uint8_t* src, size_t stride,
+                        size_t count);
+    void (*set_strided)(uint8_t* dst, const uint8_t* src, size_t stride,
+                        size_t count);
+    void (*transpose)(uint8_t* dst, size_t dst_pitch, const uint8_t* src,
+                      size_t src_pitch, size_t width, size_t height);
+    void (*copy_v)(const struct copy_desc* descs, size_t count);
+    /* NULL where the tier has no non-temporal stores */
+    void (*fill_stream)(uint8_t* dst, uint64_t pattern, size_t length);
+};
+
+#define MEM_KERNEL_TABLE(isa, fill_stream) { \
+    MEM_KERNEL_(move_forward, isa), \
+    MEM_KERNEL_(move, isa), \
+    MEM_KERNEL_(fill, isa), \
+    MEM_KERNEL_(reverse, isa), \
+    MEM_KERNEL_(reverse_words, isa), \
+    MEM_KERNEL_(reverse_words_copy, isa), \
+    MEM_KERNEL_(bswap16, isa), \
+    MEM_KERNEL_(bswap32, isa), \
+    MEM_KERNEL_(memchr, isa), \
+    MEM_KERNEL_(memrchr, isa), \
+    MEM_KERNEL_(memcmp, isa), \
+    MEM_KERNEL_(memmem, isa), \
+    MEM_KERNEL_(get_strided, isa), \
+    MEM_KERNEL_(set_strided, isa), \
+    MEM_KERNEL_(transpose, isa), \
+    MEM_KERNEL_(copy_v, isa), \
+    fill_stream }
+
+static const struct memory_kernels kernel_tables[MEMORY_ISA_COUNT] = {
+    MEM_KERNEL_TABLE(scalar, MEM_SCALAR_FILL_STREAM),
+#ifdef MEMORY_DISPATCH
+    MEM_KERNEL_TABLE(sse2, fill_stream_sse2),
+    MEM_KERNEL_TABLE(avx2, fill_stream_avx2),
+    MEM_KERNEL_TABLE(avx512, fill_stream_avx512),
+#endif
+};
+
+/* Fills of at least this many bytes use non-temporal stores, if the active
+ * tier has them. */
+static size_t stream_threshold = MEMORY_STREAM_THRESHOLD;
+
+static const char* const isa_names[MEMORY_ISA_COUNT] = {
+    "scalar", "sse2", "avx2", "avx512"
+};
+
+/* Filled once at load time by memory_dispatch_init(). Until then (e.g. calls
+ * from other constructors) the scalar kernels are used. */
+static memory_isa_t active_isa = MEMORY_ISA_SCALAR;
+static const struct memory_kernels* kernels = &kernel_tables[MEMORY_ISA_SCALAR];
+
+memory_isa_t memory_best_isa(void) {
+#ifdef MEMORY_DISPATCH
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+        return MEMORY_ISA_AVX512;
+    if(__builtin_cpu_supports("avx2"))
+        return MEMORY_ISA_AVX2;
+    if(__builtin_cpu_supports("sse2"))
+        return MEMORY_ISA_SSE2;
+#endif
+    return MEMORY_ISA_SCALAR;
+}
+
+memory_isa_t memory_select_isa(memory_isa_t isa) {
+    memory_isa_t best = memory_best_isa();
+    if(isa > best)
+        isa = best;
+    active_isa = isa;
+    kernels = &kernel_tables[isa];
+    return isa;
+}
+
+memory_isa_t memory_active_isa(void) {
+    return active_isa;
+}
+
+size_t memory_set_stream_threshold(size_t bytes) {
+    size_t previous = stream_threshold;
+    stream_threshold = bytes ? bytes : SIZE_MAX;
+    return previous;
+}
+
+const char* memory_isa_name(memory_isa_t isa) {
+    return isa < MEMORY_ISA_COUNT ? isa_names[isa] : "unknown";
+}
+
+#ifdef MEMORY_DISPATCH
+/*
+ * Picks the best kernels for the running CPU before main(). The
+ * MEMORY_FORCE_ISA environment variable pins a lower (or equal) tier; an
+ * unknown name or a tier the CPU lacks falls back to the best available one.
+ */
+__attribute__((constructor))
+static void memory_dispatch_init(void) {
+    memory_isa_t isa = memory_best_isa();
+    const char* forced = getenv("MEMORY_FORCE_ISA");
+    if(forced) {
+        for(int i = 0; i < MEMORY_ISA_COUNT; i++)
+            if(strcmp(forced, isa_names[i]) == 0)
+                isa = (memory_isa_t)i;
+    }
+    memory_select_isa(isa);
+}
+#endif
+
+/***********************************************************
+ Heap
+***********************************************************/
+/*
+ * Variable-size requests that do not fit the pool are served by a TLSF heap.
+ * On MSP432 the region is an array placed in the .heap output section, which
+ * sizes that section so __heap_start__ and __HeapLimit from the linker script
+ * bound exactly this region. On HOST it is a static buffer.
+ */
+#if defined (MSP432)
+static uint8_t heap_region[MEMORY_HEAP_SIZE]
+    __attribute__((section(".heap"), used, aligned(8)));
+extern uint8_t __heap_start__[];
+extern uint8_t __HeapLimit[];
+#define HEAP_START (__heap_start__)
+#define HEAP_BYTES ((size_t)(__HeapLimit - __heap_start__))
+
+/*
+ * newlib's malloc, which stdio may pull in, grows through _sbrk(). It gets
+ * its own small region past the TLSF heap (.sbrk in the linker script), and
+ * unlike the libnosys version this one stops at the end of it.
+ */
+extern uint8_t end[];
+extern uint8_t __sbrk_limit__[];
+
+void* _sbrk(ptrdiff_t increment) {
+    static uint8_t* brk = end;
+    uint8_t* prev = brk;
+    if(increment > __sbrk_limit__ - brk || increment < end - brk) {
+        errno = ENOMEM;
+        return (void*)-1;
+    }
+    brk += increment;
+    return prev;
+}
+#else
+static uint8_t heap_region[MEMORY_HEAP_SIZE] __attribute__((aligned(16)));
+#define HEAP_START (heap_region)
+#define HEAP_BYTES (sizeof(heap_region))
+#endif
+
+static tlsf_t heap;
+static int heap_ready;
+static mem_lock_t heap_lock;
+
+static void* heap_alloc(size_t bytes, size_t align) {
+    void* block;
+    mem_lock(&heap_lock);
+    if(!heap_ready)
+        heap_ready = tlsf_init(&heap, HEAP_START, HEAP_BYTES) == 0;
+    block = heap_ready ? tlsf_memalign(&heap, align, bytes) : NULL;
+    mem_unlock(&heap_lock);
+    return block;
+}
+
+#ifdef MEMORY_MMAP
+/*
+ * Buffers from MEMORY_HUGE_THRESHOLD up are mapped on their own, rounded to
+ * whole huge pages. Explicit huge pages (MAP_HUGETLB) are only there when the
+ * administrator reserved some, so the usual outcome is a regular mapping
+ * trimmed to a huge page boundary and marked MADV_HUGEPAGE, which lets the
+ * kernel back it with transparent huge pages. The table of live mappings is
+ * how release_block() recognizes them.
+ */
+static struct {
+    uint8_t* start;
+    size_t bytes;
+} mappings[MEMORY_MAX_MAPPINGS];
+static mem_lock_t mapping_lock;
+
+/* NULL finds a free slot */
+static int mapping_find(const void* src) {
+    for(int i = 0; i < MEMORY_MAX_MAPPINGS; i++)
+        if(mappings[i].start == (const uint8_t*)src)
+            return i;
+    return -1;
+}
+
+/*
+ * NUMA placement goes through the raw system calls, so there is no libnuma to
+ * link. Node masks are one word, which covers MEMORY_MAX_NODES nodes. The
+ * kernel drops the last bit of maxnode, hence the + 1.
+ */
+#define MEMORY_MAX_NODES (8 * (int)sizeof(unsigned long))
+
+static int numa_nodes;
+
+int memory_node_count(void) {
+    if(!numa_nodes) {
+        unsigned long allowed = 0;
+        int count = 1;
+        if(syscall(SYS_get_mempolicy, NULL, &allowed, MEMORY_MAX_NODES + 1,
+                   NULL, MPOL_F_MEMS_ALLOWED) == 0 && allowed)
+            count = MEMORY_MAX_NODES - __builtin_clzl(allowed);
+        numa_nodes = count;
+    }
+    return numa_nodes;
+}
+
+int memory_node_of(const void* src) {
+    int node = -1;
+    if(syscall(SYS_get_mempolicy, &node, NULL, 0, src,
+               MPOL_F_NODE | MPOL_F_ADDR) != 0)
+        return -1;
+    return node;
+}
+
+/**
+ * @brief Sets the placement policy of a fresh mapping before it is touched
+ *
+ * Failures are ignored: without NUMA support, or for a node that is not
+ * there, the pages are placed on first touch as usual.
+ */
+static void map_place(void* start, size_t length, int node) {
+    unsigned long mask;
+    int mode;
+    if(node == MEMORY_NODE_INTERLEAVE) {
+        int nodes = memory_node_count();
+        if(nodes < 2)
+            return;
+        mask = nodes >= MEMORY_MAX_NODES ? ~0UL : (1UL << nodes) - 1;
+        mode = MPOL_INTERLEAVE;
+    } else if(node >= 0 && node < MEMORY_MAX_NODES) {
+        /* Preferred rather than bound, so a full node spills over instead of
+         * failing the faults */
+        mask = 1UL << node;
+        mode = MPOL_PREFERRED;
+    } else {
+        return;
+    }
+    syscall(SYS_mbind, start, length, mode, &mask, MEMORY_MAX_NODES + 1, 0);
+}
+
+static void* map_alloc(size_t bytes, size_t align, int node) {
+    size_t length = (bytes + MEMORY_HUGE_PAGE_SIZE - 1) &
+                    ~(MEMORY_HUGE_PAGE_SIZE - 1);
+    if(align > MEMORY_HUGE_PAGE_SIZE || length < bytes)
+        return NULL;
+    uint8_t* start = mmap(NULL, length, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if(start == MAP_FAILED) {
+        uint8_t* raw = mmap(NULL, length + MEMORY_HUGE_PAGE_SIZE,
+                            PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(raw == MAP_FAILED)
+            return NULL;
+        start = (uint8_t*)(((uintptr_t)raw + MEMORY_HUGE_PAGE_SIZE - 1) &
+                           ~(uintptr_t)(MEMORY_HUGE_PAGE_SIZE - 1));
+        size_t head = (size_t)(start - raw);
+        if(head)
+            munmap(raw, head);
+        munmap(start + length, MEMORY_HUGE_PAGE_SIZE - head);
+        /* Only advice: without THP this is a regular mapping */
+        madvise(start, length, MADV_HUGEPAGE);
+    }
+    if(node != MEMORY_NODE_LOCAL)
+        map_place(start, length, node);
+
+    mem_lock(&mapping_lock);
+    int slot = mapping_find(NULL);
+    if(slot >= 0) {
+        mappings[slot].start = start;
+        mappings[slot].bytes = length;
+    }
+    mem_unlock(&mapping_lock);
+    if(slot < 0) {
+        munmap(start, length);
+        return NULL;
+    }
+    return start;
+}
+
+/**
+ * @brief Unmaps src if it came from map_alloc(); returns 0 if it did not
+ */
+static int map_free(void* src) {
+    if(!src)
+        return 0;
+    mem_lock(&mapping_lock);
+    int slot = mapping_find(src);
+    size_t bytes = 0;
+    if(slot >= 0) {
+        bytes = mappings[slot].bytes;
+        mappings[slot].start = NULL;
+    }
+    mem_unlock(&mapping_lock);
+    if(slot < 0)
+        return 0;
+    munmap(src, bytes);
+    return 1;
+}
+#else
+int memory_node_count(void) {
+    return 1;
+}
+
+int memory_node_of(const void* src) {
+    (void)src;
+    return -1;
+}
+#endif
+
+/*
+ * align is 0 for the natural alignment of each allocator. Pool blocks are
+ * aligned to their size, so a class at least as large as align serves an
+ * aligned request directly. Placing a block on a node takes pages of its own,
+ * so those always come from a mapping where there is one.
+ */
+static void* reserve_block(size_t bytes, size_t align, int node) {
+    void* block = NULL;
+#ifdef MEMORY_MMAP
+    if(node != MEMORY_NODE_LOCAL || (align && bytes >= MEMORY_HUGE_THRESHOLD))
+        block = map_alloc(bytes, align, node);
+#else
+    (void)node;
+#endif
+    if(!block && align <= MEM_POOL_MAX_BLOCK)
+        block = mem_pool_alloc(bytes > align ? bytes : align);
+    if(!block)
+        block = heap_alloc(bytes, align);
+#if defined (HOST)
+    /* The C library is only a last resort once the static heap is full */
+    if(!block) {
+        if(align <= sizeof(void*))
+            block = malloc(bytes);
+        else if(posix_memalign(&block, align, bytes) != 0)
+            block = NULL;
+    }
+#endif
+    return block;
+}
+
+static void release_block(void* src) {
+    if(mem_pool_owns(src)) {
+        mem_pool_free(src);
+    } else if(heap_ready && tlsf_owns(&heap, src)) {
+        mem_lock(&heap_lock);
+        tlsf_free(&heap, src);
+        mem_unlock(&heap_lock);
+#ifdef MEMORY_MMAP
+    } else if(map_free(src)) {
+        return;
+#endif
+    } else {
+#if defined (HOST)
+        free(src);
+#endif
+    }
+}
+
+/***********************************************************
+ Telemetry
+***********************************************************/
+#ifdef MEMORY_TELEMETRY
+#if defined (HOST) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#endif
+#if defined (HOST) && defined (__GLIBC__)
+#include <malloc.h>
+#endif
+
+/* One bucket per pool class, then the TLSF heap, the direct mappings and the
+ * C library */
+#define TELEMETRY_HEAP      (MEM_POOL_CLASS_COUNT)
+#define TELEMETRY_MAP       (MEM_POOL_CLASS_COUNT + 1)
+#define TELEMETRY_LIBC      (MEM_POOL_CLASS_COUNT + 2)
+#define TELEMETRY_BUCKETS   (MEM_POOL_CLASS_COUNT + 3)
+
+static struct {
+    uint64_t live_bytes;
+    uint64_t peak_bytes;
+    uint32_t reserves[TELEMETRY_BUCKETS];
+    uint32_t frees[TELEMETRY_BUCKETS];
+    uint32_t failures;
+    uint64_t reserve_cycles;
+    uint64_t free_cycles;
+    uint64_t max_reserve_cycles;
+    uint64_t max_free_cycles;
+} telemetry;
+
+/*
+ * Cycle counter: the TSC on x86 hosts, the DWT cycle counter on the M4 (which
+ * has to be switched on once). Other hosts report zero cycles.
+ */
+static inline uint64_t telemetry_cycles(void) {
+#if defined (HOST) && (defined(__x86_64__) || defined(__i386__))
+    return __rdtsc();
+#elif defined (MSP432)
+    if(!(DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk)) {
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CYCCNT = 0;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    }
+    return DWT->CYCCNT;
+#else
+    return 0;
+#endif
+}
+
+/* Counters are shared between threads on HOST, so they are updated with
+ * relaxed atomics; MSP432 has a single thread of execution. */
+#if defined (HOST)
+#define TELEMETRY_ADD(field, v) __atomic_fetch_add(&(field), (v), __ATOMIC_RELAXED)
+#define TELEMETRY_SUB(field, v) __atomic_fetch_sub(&(field), (v), __ATOMIC_RELAXED)
+#else
+#define TELEMETRY_ADD(field, v) ((field) += (v))
+#define TELEMETRY_SUB(field, v) ((field) -= (v))
+#endif
+
+static inline void telemetry_max(uint64_t* field, uint64_t value) {
+#if defined (HOST)
+    uint64_t seen = __atomic_load_n(field, __ATOMIC_RELAXED);
+    while(value > seen &&
+          !__atomic_compare_exchange_n(field, &seen, value, 1,
+                                       __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+#else
+    if(value > *field)
+        *field = value;
+#endif
+}
+
+/**
+ * @brief Bucket and footprint of a live block
+ */
+static int telemetry_block(const void* block, size_t* size) {
+    if(mem_pool_owns(block)) {
+        *size = mem_pool_usable_size(block);
+        return __builtin_ctzl((unsigned long)*size) - MEM_POOL_MIN_SHIFT;
+    }
+    if(heap_ready && tlsf_owns(&heap, block)) {
+        *size = tlsf_block_size(block);
+        return TELEMETRY_HEAP;
+    }
+#ifdef MEMORY_MMAP
+    mem_lock(&mapping_lock);
+    int slot = mapping_find(block);
+    *size = slot >= 0 ? mappings[slot].bytes : 0;
+    mem_unlock(&mapping_lock);
+    if(slot >= 0)
+        return TELEMETRY_MAP;
+#endif
+#if defined (HOST) && defined (__GLIBC__)
+    *size = malloc_usable_size((void*)block);
+#else
+    *size = 0;
+#endif
+    return TELEMETRY_LIBC;
+}
+
+static void telemetry_reserved(const void* block, uint64_t cycles) {
+    size_t size;
+    TELEMETRY_ADD(telemetry.reserve_cycles, cycles);
+    telemetry_max(&telemetry.max_reserve_cycles, cycles);
+    if(!block) {
+        TELEMETRY_ADD(telemetry.failures, 1);
+        return;
+    }
+    TELEMETRY_ADD(telemetry.reserves[telemetry_block(block, &size)], 1);
+    uint64_t live = TELEMETRY_ADD(telemetry.live_bytes, (uint64_t)size) + size;
+    telemetry_max(&telemetry.peak_bytes, live);
+}
+
+void memory_stats_dump(void) {
+    uint32_t reserves = 0;
+    uint32_t frees = 0;
+    PRINTF("Memory telemetry:\n");
+    PRINTF("  live bytes: %lu, high-water mark: %lu bytes\n",
+           (unsigned long)telemetry.live_bytes,
+           (unsigned long)telemetry.peak_bytes);
+    PRINTF("  %8s | %10s %10s\n", "class", "reserves", "frees");
+    for(int i = 0; i < TELEMETRY_BUCKETS; i++) {
+        reserves += telemetry.reserves[i];
+        frees += telemetry.frees[i];
+        if(!telemetry.reserves[i] && !telemetry.frees[i])
+            continue;
+        if(i < MEM_POOL_CLASS_COUNT)
+            PRINTF("  %6lu B | %10lu %10lu\n",
+                   (unsigned long)(MEM_POOL_MIN_BLOCK << i),
+                   (unsigned long)telemetry.reserves[i],
+                   (unsigned long)telemetry.frees[i]);
+        else
+            PRINTF("  %8s | %10lu %10lu\n",
+                   i == TELEMETRY_HEAP ? "heap" :
+                   i == TELEMETRY_MAP ? "mmap" : "libc",
+                   (unsigned long)telemetry.reserves[i],
+                   (unsigned long)telemetry.frees[i]);
+    }
+    PRINTF("  failed reserves: %lu\n", (unsigned long)telemetry.failures);
+    /* Failed reserves are timed too, so they count towards the average */
+    reserves += telemetry.failures;
+    PRINTF("  reserve cycles: avg %lu, max %lu\n",
+           (unsigned long)(reserves ? telemetry.reserve_cycles / reserves : 0),
+           (unsigned long)telemetry.max_reserve_cycles);
+    PRINTF("  free cycles: avg %lu, max %lu\n",
+           (unsigned long)(frees ? telemetry.free_cycles / frees : 0),
+           (unsigned long)telemetry.max_free_cycles);
+}
+#endif /* MEMORY_TELEMETRY */
 
 /***********************************************************
  Function Definitions
@@ -50,50 +1353,354 @@ void clear_all(char * ptr, unsigned int size){
   set_all(ptr, 0, size);
 }
 
-#include<stdio.h>
+void get_strided(char * ptr, unsigned int stride, char * dst,
+                 unsigned int count){
+  kernels->get_strided((uint8_t*)dst, (const uint8_t*)ptr, stride, count);
+}
+
+void set_strided(char * ptr, unsigned int stride, char * src,
+                 unsigned int count){
+  kernels->set_strided((uint8_t*)ptr, (const uint8_t*)src, stride, count);
+}
+
+/* Random indices defeat vector loads; four independent loads in flight hide
+ * some of the latency instead */
+void gather(char * ptr, const unsigned int * indices, char * dst,
+            unsigned int count){
+  unsigned int i;
+  for(i = 0; i + 4 <= count; i += 4) {
+    char b0 = ptr[indices[i]];
+    char b1 = ptr[indices[i + 1]];
+    char b2 = ptr[indices[i + 2]];
+    char b3 = ptr[indices[i + 3]];
+    dst[i] = b0;
+    dst[i + 1] = b1;
+    dst[i + 2] = b2;
+    dst[i + 3] = b3;
+  }
+  for(; i < count; i++) {
+    dst[i] = ptr[indices[i]];
+  }
+}
+
+void scatter(char * ptr, const unsigned int * indices, char * src,
+             unsigned int count){
+  unsigned int i;
+  for(i = 0; i + 4 <= count; i += 4) {
+    char b0 = src[i];
+    char b1 = src[i + 1];
+    char b2 = src[i + 2];
+    char b3 = src[i + 3];
+    ptr[indices[i]] = b0;
+    ptr[indices[i + 1]] = b1;
+    ptr[indices[i + 2]] = b2;
+    ptr[indices[i + 3]] = b3;
+  }
+  for(; i < count; i++) {
+    ptr[indices[i]] = src[i];
+  }
+}
+
 uint8_t* my_memmove(uint8_t* src, uint8_t* dst, size_t length) {
-    for(size_t i = 0; i < length; i++)
-        if(dst > src)
-            *(dst + length - 1 - i) = *(src + length - 1 - i);
-        else if (dst < src)
-            *(dst + i) = *(src + i);
+    kernels->move(dst, src, length);
     return dst;
 }
 
 uint8_t* my_memcopy(uint8_t* src, uint8_t* dst, size_t length) {
-    for(size_t i = 0; i < length; i++)
-        if(dst > src)
-            *(dst + length - 1 - i) = *(src + length - 1 - i);
-        else if (dst < src)
-            *(dst + i) = *(src + i);
+    kernels->copy(dst, src, length);
     return dst;
 }
 
+void my_memcopy_v(const struct copy_desc* descs, size_t count) {
+    kernels->copy_v(descs, count);
+}
+
+uint8_t* my_memcopy_2d(uint8_t* src, size_t src_pitch, uint8_t* dst,
+                       size_t dst_pitch, size_t width, size_t height) {
+    /* Rows that follow each other without a gap are one copy */
+    if(src_pitch == width && dst_pitch == width) {
+        width *= height;
+        height = 1;
+    }
+    for(size_t r = 0; r < height; r++)
+        kernels->copy(dst + r * dst_pitch, src + r * src_pitch, width);
+    return dst;
+}
+
+uint8_t* my_transpose_u8(uint8_t* src, size_t src_pitch, uint8_t* dst,
+                         size_t dst_pitch, size_t width, size_t height) {
+    kernels->transpose(dst, dst_pitch, src, src_pitch, width, height);
+    return dst;
+}
+
+static void memory_fill(uint8_t* dst, uint64_t pattern, size_t length) {
+    if(length >= stream_threshold && kernels->fill_stream)
+        kernels->fill_stream(dst, pattern, length);
+    else
+        kernels->fill(dst, pattern, length);
+}
+
 uint8_t* my_memset(uint8_t* src, size_t length, uint8_t value) {
-    for(size_t i = 0; i < length; i++)
-        *(src + i) = value;
+    memory_fill(src, MEM_WORD_BROADCAST(value), length);
+    return src;
+}
+
+uint16_t* my_memset16(uint16_t* src, size_t count, uint16_t value) {
+    memory_fill((uint8_t*)src, value * 0x0001000100010001ULL,
+                count * sizeof(*src));
+    return src;
+}
+
+uint32_t* my_memset32(uint32_t* src, size_t count, uint32_t value) {
+    memory_fill((uint8_t*)src, value * 0x0000000100000001ULL,
+                count * sizeof(*src));
+    return src;
+}
+
+uint64_t* my_memset64(uint64_t* src, size_t count, uint64_t value) {
+    memory_fill((uint8_t*)src, value, count * sizeof(*src));
     return src;
 }
 
 uint8_t* my_memzero(uint8_t* src, size_t length) {
-    for(size_t i = 0; i < length; i++)
-        *(src + i) = 0;
+    return my_memset(src, length, 0);
+}
+
+#if defined (HOST)
+#define MEMORY_MAX_THREADS (64)
+
+struct zero_part {
+    uint8_t* start;
+    size_t length;
+    int node;
+};
+
+static void* zero_worker(void* arg) {
+    struct zero_part* part = arg;
+#ifdef MEMORY_MMAP
+    /* The policy of this short-lived thread only; an mbind() on the buffer
+     * itself takes precedence */
+    if(part->node >= 0) {
+        unsigned long mask = 1UL << part->node;
+        syscall(SYS_set_mempolicy, MPOL_PREFERRED, &mask,
+                MEMORY_MAX_NODES + 1);
+    }
+#endif
+    my_memzero(part->start, part->length);
+    return NULL;
+}
+#endif
+
+uint8_t* my_memzero_parallel(uint8_t* src, size_t length, unsigned threads) {
+#if defined (HOST)
+    struct zero_part parts[MEMORY_MAX_THREADS];
+    pthread_t ids[MEMORY_MAX_THREADS];
+    int started[MEMORY_MAX_THREADS];
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    if(threads > MEMORY_MAX_THREADS)
+        threads = MEMORY_MAX_THREADS;
+    if(threads < 2 || length < 2 * page)
+        return my_memzero(src, length);
+    /* A transparent huge page goes wherever its first byte is touched */
+    if(length / threads >= MEMORY_HUGE_PAGE_SIZE)
+        page = MEMORY_HUGE_PAGE_SIZE;
+
+    /* Cut on page boundaries so each page is first touched by one thread */
+    int nodes = memory_node_count();
+    uintptr_t base = (uintptr_t)src;
+    size_t offset = 0;
+    for(unsigned i = 0; i < threads; i++) {
+        size_t end = length;
+        if(i + 1 < threads) {
+            uintptr_t cut = (base + length / threads * (i + 1) + page - 1) &
+                            ~(uintptr_t)(page - 1);
+            if(cut - base < length)
+                end = cut - base;
+        }
+        if(end < offset)
+            end = offset;
+        parts[i].start = src + offset;
+        parts[i].length = end - offset;
+        parts[i].node = nodes > 1 ? (int)(i * (unsigned)nodes / threads) : -1;
+        offset = end;
+        started[i] = parts[i].length &&
+                     pthread_create(&ids[i], NULL, zero_worker, &parts[i]) == 0;
+    }
+    /* A thread that could not be started leaves its part to the caller */
+    for(unsigned i = 0; i < threads; i++) {
+        if(started[i])
+            pthread_join(ids[i], NULL);
+        else
+            my_memzero(parts[i].start, parts[i].length);
+    }
+#else
+    (void)threads;
+    my_memzero(src, length);
+#endif
     return src;
 }
 
 uint8_t* my_reverse(uint8_t* src, size_t length) {
-    for(size_t i = 0; i < length / 2; i++) {
-        uint8_t temp = *(src + i);
-        *(src + i) = *(src + length - 1 - i);
-        *(src + length - 1 - i) = temp;
-    }
+    kernels->reverse(src, length);
     return src;
 }
 
+uint8_t* my_reverse_words(uint8_t* src, size_t count) {
+    kernels->reverse_words(src, count * sizeof(uint32_t));
+    return src;
+}
+
+uint8_t* my_reverse_words_copy(uint8_t* src, uint8_t* dst, size_t count) {
+    kernels->reverse_words_copy(dst, src, count * sizeof(uint32_t));
+    return dst;
+}
+
+uint8_t* my_bswap16_array(uint8_t* src, size_t count) {
+    kernels->bswap16(src, src, count * sizeof(uint16_t));
+    return src;
+}
+
+uint8_t* my_bswap16_array_copy(uint8_t* src, uint8_t* dst, size_t count) {
+    kernels->bswap16(dst, src, count * sizeof(uint16_t));
+    return dst;
+}
+
+uint8_t* my_bswap32_array(uint8_t* src, size_t count) {
+    kernels->bswap32(src, src, count * sizeof(uint32_t));
+    return src;
+}
+
+uint8_t* my_bswap32_array_copy(uint8_t* src, uint8_t* dst, size_t count) {
+    kernels->bswap32(dst, src, count * sizeof(uint32_t));
+    return dst;
+}
+
+int my_memcmp(const uint8_t* a, const uint8_t* b, size_t length) {
+    return kernels->memcmp(a, b, length);
+}
+
+uint8_t* my_memchr(const uint8_t* src, uint8_t value, size_t length) {
+    return (uint8_t*)kernels->memchr(src, value, length);
+}
+
+uint8_t* my_memrchr(const uint8_t* src, uint8_t value, size_t length) {
+    return (uint8_t*)kernels->memrchr(src, value, length);
+}
+
+uint8_t* my_memmem(const uint8_t* haystack, size_t haystack_length,
+                   const uint8_t* needle, size_t needle_length) {
+    if(needle_length == 0)
+        return (uint8_t*)haystack;
+    if(needle_length > haystack_length)
+        return NULL;
+    if(needle_length == 1)
+        return (uint8_t*)kernels->memchr(haystack, needle[0], haystack_length);
+    return (uint8_t*)kernels->memmem(haystack, haystack_length, needle,
+                                     needle_length);
+}
+
+byte_span_t my_memmove_span(byte_span_t src, byte_span_t dst) {
+    dst = span_sub(dst, 0, src.length);
+    my_memmove(src.data, dst.data, dst.length);
+    return dst;
+}
+
+byte_span_t my_memcopy_span(byte_span_t src, byte_span_t dst) {
+    dst = span_sub(dst, 0, src.length);
+    my_memcopy(src.data, dst.data, dst.length);
+    return dst;
+}
+
+byte_span_t my_memset_span(byte_span_t span, uint8_t value) {
+    my_memset(span.data, span.length, value);
+    return span;
+}
+
+byte_span_t my_memzero_span(byte_span_t span) {
+    my_memzero(span.data, span.length);
+    return span;
+}
+
+byte_span_t my_reverse_span(byte_span_t span) {
+    my_reverse(span.data, span.length);
+    return span;
+}
+
+int my_memcmp_span(byte_span_t a, byte_span_t b) {
+    int diff = my_memcmp(a.data, b.data,
+                         a.length < b.length ? a.length : b.length);
+    if(diff)
+        return diff;
+    return (a.length > b.length) - (a.length < b.length);
+}
+
+byte_span_t my_memchr_span(byte_span_t span, uint8_t value) {
+    uint8_t* found = my_memchr(span.data, value, span.length);
+    return found ? span_sub(span, (size_t)(found - span.data), SIZE_MAX)
+                 : span_make(NULL, 0);
+}
+
+byte_span_t my_memmem_span(byte_span_t haystack, byte_span_t needle) {
+    uint8_t* found = my_memmem(haystack.data, haystack.length, needle.data,
+                               needle.length);
+    return found ? span_sub(haystack, (size_t)(found - haystack.data), SIZE_MAX)
+                 : span_make(NULL, 0);
+}
+
+static void* reserve_measured(size_t bytes, size_t align, int node) {
+#ifdef MEMORY_TELEMETRY
+    uint64_t start = telemetry_cycles();
+    void* block = reserve_block(bytes, align, node);
+    telemetry_reserved(block, telemetry_cycles() - start);
+    return block;
+#else
+    return reserve_block(bytes, align, node);
+#endif
+}
+
+void* reserve_bytes(size_t bytes) {
+    return reserve_measured(bytes, 0, MEMORY_NODE_LOCAL);
+}
+
+void free_bytes(void* src) {
+#ifdef MEMORY_TELEMETRY
+    size_t size;
+    if(!src)
+        return;
+    /* Measure the block first; the allocators may merge it away */
+    int bucket = telemetry_block(src, &size);
+    uint64_t start = telemetry_cycles();
+    release_block(src);
+    uint64_t cycles = telemetry_cycles() - start;
+    TELEMETRY_ADD(telemetry.frees[bucket], 1);
+    TELEMETRY_SUB(telemetry.live_bytes, (uint64_t)size);
+    TELEMETRY_ADD(telemetry.free_cycles, cycles);
+    telemetry_max(&telemetry.max_free_cycles, cycles);
+#else
+    release_block(src);
+#endif
+}
+
 int32_t* reserve_words(size_t length) {
-  return (int32_t *) malloc(length * sizeof(int32_t));
+    return (int32_t *) reserve_bytes(length * sizeof(int32_t));
+}
+
+int32_t* reserve_words_aligned(size_t length, size_t alignment) {
+    if(!alignment)
+        alignment = MEMORY_CACHE_LINE;
+    if(alignment & (alignment - 1) || length > SIZE_MAX / sizeof(int32_t))
+        return NULL;
+    return (int32_t *) reserve_measured(length * sizeof(int32_t), alignment,
+                                        MEMORY_NODE_LOCAL);
+}
+
+int32_t* reserve_words_node(size_t length, int node) {
+    if(length > SIZE_MAX / sizeof(int32_t))
+        return NULL;
+    return (int32_t *) reserve_measured(length * sizeof(int32_t),
+                                        MEMORY_CACHE_LINE, node);
 }
 
 void free_words(uint32_t * src) {
-    free(src);
+    free_bytes(src);
 }
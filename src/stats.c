@@ -14,7 +14,7 @@
  * This file contains implementation of all statistical function defined in
  * stats.h.  Most functions process an array of unsigned chars with size passed
  * as unsigned int. The main output function prints different statistics to the
- * standard output.
+ * standard output, all read off one histogram of the array.
  *
  * @author Hatem Alamir
  * @date 11/21/2024
@@ -24,47 +24,124 @@
 
 
 #include <stdio.h>
+#include <stdint.h>
 #include <errno.h>
+#include <limits.h>
 #include "stats.h"
+#include "memory.h"
 #include "platform.h"
 
+/* The summary kernels use SSE2 and AVX2, picked by the memory module's tier */
+#if defined(HOST) && defined(__GNUC__) && defined(__x86_64__)
+#define STATS_X86
+#include <immintrin.h>
+#endif
+
+/* Partial histograms filled round-robin, so runs of the same value do not
+ * wait on one counter. Each costs 1 KiB of stack. The counting loop is
+ * written out for four. */
+#if defined (MSP432)
+#define STATS_HISTOGRAMS (1)
+#else
+#define STATS_HISTOGRAMS (4)
+#endif
+
+static void print_histogram(const stats_histogram_t* hist);
+
 void print_statistics(unsigned char* arr, const unsigned int length) {
+  print_statistics_ex(arr, length, NULL);
+}
+
+void print_statistics_ex(unsigned char* arr, const unsigned int length,
+                         arena_t* scratch) {
+  arena_mark_t mark = 0;
+  stats_histogram_t local;
+  stats_histogram_t* hist = &local;
   PRINTF(">> Original Array: ");
   print_array(arr, length);
   PRINTF("\n");
 
+  if(scratch) {
+      mark = arena_mark(scratch);
+      hist = arena_alloc(scratch, sizeof(*hist), 0);
+      if(!hist) {
+          PRINTF("Error: scratch arena too small for a histogram\n");
+          return;
+      }
+  }
+  stats_histogram_build(hist, arr, length);
+
   PRINTF(">> Sorted Array: ");
-  sort_array(arr, length);
-  print_array(arr, length);
+  print_histogram(hist);
   PRINTF("\n");
 
   errno = 0;
-  unsigned char temp = find_median(arr, length);
+  unsigned char temp = stats_histogram_median(hist);
   if(errno == EINVAL) {
       perror("Error calculating median. Possible empty array!");
   }
   PRINTF(">> Median: %d\n", temp);
 
   errno = 0;
-  temp = find_mean(arr, length);
+  temp = stats_histogram_mean(hist);
   if(errno == EINVAL) {
       perror("Error calculating mean. Possible empty array!");
   }
   PRINTF(">> Mean: %d\n", temp);
 
   errno = 0;
-  temp = find_maximum(arr, length);
+  temp = stats_histogram_maximum(hist);
   if(errno == EINVAL) {
       perror("Error calculating maximum. Possible empty array!");
   }
   PRINTF(">> Maximum: %d\n", temp);
 
   errno = 0;
-  temp = find_minimum(arr, length);
+  temp = stats_histogram_minimum(hist);
   if(errno == EINVAL) {
       perror("Error calculating minimum. Possible empty array!");
   }
   PRINTF(">> Minimum: %d\n", temp);
+
+  if(scratch)
+      arena_rewind(scratch, mark);
+}
+
+/*
+ * The legacy entry points count in unsigned int. A longer span is refused
+ * rather than cut short; find_mean_span() has no such limit since
+ * stats_summary() takes a size_t.
+ */
+void print_statistics_span(byte_span_t samples, arena_t* scratch) {
+  if(samples.length > UINT_MAX) {
+      PRINTF("Error: span too long for print_statistics()\n");
+      return;
+  }
+  print_statistics_ex(samples.data, samples.length, scratch);
+}
+
+void print_array_span(byte_span_t samples) {
+  if(samples.length > UINT_MAX) {
+      PRINTF("Error: span too long for print_array()\n");
+      return;
+  }
+  print_array(samples.data, samples.length);
+}
+
+unsigned char find_mean_span(byte_span_t samples) {
+  struct stats_result result;
+  if(stats_summary(samples.data, samples.length, &result)) {
+      errno = EINVAL;
+      return 0;
+  }
+  return (unsigned char)(result.sum / result.count);
+}
+
+int sort_array_span(byte_span_t samples) {
+  if(samples.length > UINT_MAX)
+      return -1;
+  sort_array(samples.data, samples.length);
+  return 0;
 }
 
 void print_array(const unsigned char* arr, const unsigned int length) {
@@ -77,6 +154,24 @@ void print_array(const unsigned char* arr, const unsigned int length) {
 #endif
 }
 
+/*
+ * Same format as print_array() for the samples in descending order, read off
+ * the histogram instead of a sorted copy
+ */
+static void print_histogram(const stats_histogram_t* hist) {
+#ifdef VERBOSE
+    size_t left = hist->length;
+    PRINTF("[");
+    for(int v = 255; v >= 0; v--)
+        for(uint32_t c = 0; c < hist->counts[v]; c++)
+            PRINTF(--left ? "%d, " : "%d]\n", v);
+    /* PRINTF may expand to nothing, as it does on MSP432 */
+    (void)left;
+#else
+    (void)hist;
+#endif
+}
+
 /**
  * @brief Given an array of data and two indices, swap the data at those indices 
  *
@@ -96,47 +191,616 @@ void swap(unsigned char* arr, const int i1, const int i2) {
     arr[i2] = temp;
 }
 
+/*
+ * Keys of 1, 2 or 4 bytes, so the insertion and radix sorts serve every
+ * element type. The width is a constant wherever these are inlined.
+ */
+static inline uint32_t sort_key(const void* keys, size_t i, size_t width) {
+    if(width == 1)
+        return ((const uint8_t*)keys)[i];
+    if(width == 2)
+        return ((const uint16_t*)keys)[i];
+    return ((const uint32_t*)keys)[i];
+}
+
+static inline void sort_put(void* keys, size_t i, size_t width, uint32_t key) {
+    if(width == 1)
+        ((uint8_t*)keys)[i] = (uint8_t)key;
+    else if(width == 2)
+        ((uint16_t*)keys)[i] = (uint16_t)key;
+    else
+        ((uint32_t*)keys)[i] = key;
+}
+
+static inline void insertion_sort(void* keys, size_t length, size_t width) {
+    for(size_t i = 1; i < length; i++) {
+        uint32_t key = sort_key(keys, i, width);
+        size_t j = i;
+        for(; j > 0 && sort_key(keys, j - 1, width) < key; j--)
+            sort_put(keys, j, width, sort_key(keys, j - 1, width));
+        sort_put(keys, j, width, key);
+    }
+}
+
+/*
+ * LSD radix sort, one byte of the key per pass, each pass a stable scatter
+ * to offsets from a descending prefix sum of the digit counts. The counts of
+ * every digit come from one read of the keys, and a pass whose digit is the
+ * same for all keys is skipped.
+ */
+static inline void radix_sort(void* arr, size_t length, void* scratch,
+                              size_t width) {
+    size_t counts[sizeof(uint32_t)][256];
+    size_t offsets[256];
+    void* own = NULL;
+    if(length < STATS_SORT_CUTOFF) {
+        insertion_sort(arr, length, width);
+        return;
+    }
+    if(!scratch) {
+        scratch = own = reserve_bytes(length * width);
+        if(!own) {
+            errno = ENOMEM;
+            return;
+        }
+    }
+
+    my_memzero((uint8_t*)counts, sizeof(counts));
+    for(size_t i = 0; i < length; i++) {
+        uint32_t key = sort_key(arr, i, width);
+        for(size_t d = 0; d < width; d++)
+            counts[d][(key >> (8 * d)) & 0xFF]++;
+    }
+    void* src = arr;
+    void* dst = scratch;
+    for(size_t d = 0; d < width; d++) {
+        if(counts[d][(sort_key(arr, 0, width) >> (8 * d)) & 0xFF] == length)
+            continue;
+        size_t at = 0;
+        for(int v = 255; v >= 0; v--) {
+            offsets[v] = at;
+            at += counts[d][v];
+        }
+        for(size_t i = 0; i < length; i++) {
+            uint32_t key = sort_key(src, i, width);
+            sort_put(dst, offsets[(key >> (8 * d)) & 0xFF]++, width, key);
+        }
+        void* t = src;
+        src = dst;
+        dst = t;
+    }
+    if(src != arr)
+        my_memcopy(src, arr, length * width);
+    free_bytes(own);
+}
+
+/*
+ * Adds the samples to counts. Long inputs are counted into partial
+ * histograms first, round-robin, so a run of one value is not a chain of
+ * increments of the same counter; short ones would spend more clearing and
+ * merging those than counting.
+ */
+static void histogram_count(const unsigned char* arr, size_t length,
+                            uint32_t* counts) {
+    size_t i = 0;
+#if STATS_HISTOGRAMS == 4
+    if(length >= STATS_HISTOGRAMS * 256) {
+        uint32_t parts[STATS_HISTOGRAMS][256];
+        my_memzero((uint8_t*)parts, sizeof(parts));
+        for(; i + STATS_HISTOGRAMS <= length; i += STATS_HISTOGRAMS) {
+            /* Four loads, then four counts: a store to parts could alias
+             * arr, so interleaving them would reload each byte */
+            unsigned char b0 = arr[i], b1 = arr[i + 1];
+            unsigned char b2 = arr[i + 2], b3 = arr[i + 3];
+            parts[0][b0]++;
+            parts[1][b1]++;
+            parts[2][b2]++;
+            parts[3][b3]++;
+        }
+        for(int v = 0; v < 256; v++)
+            for(int h = 0; h < STATS_HISTOGRAMS; h++)
+                counts[v] += parts[h][v];
+    }
+#endif
+    for(; i < length; i++)
+        counts[arr[i]]++;
+}
+
+/*
+ * Counting sort: with byte keys the counts say everything, so the sorted
+ * array is written back as one fill per value.
+ */
 void sort_array(unsigned char* arr, const unsigned int length) {
-    for(int i = 0; i < length; i++)
-        for(int j = length - 1; j > i; j--)
-            if(arr[j] > arr[j - 1])
-                swap(arr, j, j - 1);
+    uint32_t counts[256];
+    if(length < STATS_SORT_CUTOFF) {
+        insertion_sort(arr, length, 1);
+        return;
+    }
+    my_memzero((uint8_t*)counts, sizeof(counts));
+    histogram_count(arr, length, counts);
+
+    unsigned char* out = arr;
+    for(int v = 255; v >= 0; v--) {
+        my_memset(out, counts[v], (uint8_t)v);
+        out += counts[v];
+    }
 }
 
-unsigned char find_median(unsigned char* arr, const unsigned int length) {
-    if(length < 1) {
+void sort_array_u16(uint16_t* arr, size_t length, uint16_t* scratch) {
+    radix_sort(arr, length, scratch, sizeof(uint16_t));
+}
+
+void sort_array_u32(uint32_t* arr, size_t length, uint32_t* scratch) {
+    radix_sort(arr, length, scratch, sizeof(uint32_t));
+}
+
+static inline void sort_swap(void* keys, size_t i, size_t j, size_t width) {
+    uint32_t key = sort_key(keys, i, width);
+    sort_put(keys, i, width, sort_key(keys, j, width));
+    sort_put(keys, j, width, key);
+}
+
+static void select_rank(void* keys, size_t lo, size_t hi, size_t k,
+                        size_t width);
+
+/*
+ * Median of the medians of groups of five of keys[lo, hi). The group medians
+ * are gathered at lo and their median selected there, recursively. At least
+ * 3/10 of the keys are then on each side of it, which is what bounds the
+ * fallback to linear time.
+ *
+ * Returns the index of the pivot
+ */
+static inline __attribute__((always_inline))
+size_t select_pivot(void* keys, size_t lo, size_t hi, size_t width) {
+    size_t groups = 0;
+    for(size_t g = lo; g < hi; g += 5) {
+        size_t n = hi - g < 5 ? hi - g : 5;
+        insertion_sort((uint8_t*)keys + g * width, n, width);
+        sort_swap(keys, lo + groups++, g + n / 2, width);
+    }
+    select_rank(keys, lo, lo + groups, lo + groups / 2, width);
+    return lo + groups / 2;
+}
+
+/* Index of the median of the keys at a, b and c */
+static inline size_t select_median3(const void* keys, size_t a, size_t b,
+                                    size_t c, size_t width) {
+    if(sort_key(keys, a, width) < sort_key(keys, b, width)) {
+        size_t t = a;
+        a = b;
+        b = t;
+    }
+    /* now key a >= key b, and the median is key c clamped between them */
+    return sort_key(keys, c, width) > sort_key(keys, a, width) ? a :
+           sort_key(keys, c, width) < sort_key(keys, b, width) ? b : c;
+}
+
+/*
+ * Introselect: quickselect with the median of three medians of three keys,
+ * spread over the range, as pivot, as long as every two partitions cut at
+ * least a quarter off the range. When they do not, the input is taken to be
+ * adversarial and the next pivot is a median of medians. Partitioning is
+ * Lomuto's without branches: every key is swapped to the end of the ones
+ * larger than the pivot, and that end only moves when the key belongs there,
+ * so random keys cost no mispredictions. When few keys turn out larger than
+ * the pivot, many may equal it, and a second pass gathers those, so they
+ * leave the range all at once. Afterwards keys[k] is the key sort_array()
+ * would put there, with larger or equal keys before it and smaller or equal
+ * after.
+ */
+static inline __attribute__((always_inline))
+void select_loop(void* keys, size_t lo, size_t hi, size_t k, size_t width) {
+    size_t checked = hi - lo;
+    unsigned steps = 0;
+    int fallback = 0;
+    while(hi - lo > STATS_SORT_CUTOFF) {
+        size_t p;
+        if(!fallback) {
+            size_t step = (hi - lo) / 8;
+            size_t mid = lo + (hi - lo) / 2;
+            p = select_median3(keys,
+                    select_median3(keys, lo, lo + step, lo + 2 * step, width),
+                    select_median3(keys, mid - step, mid, mid + step, width),
+                    select_median3(keys, hi - 1 - 2 * step, hi - 1 - step,
+                                   hi - 1, width),
+                    width);
+        } else {
+            p = select_pivot(keys, lo, hi, width);
+        }
+
+        sort_swap(keys, lo, p, width);
+        uint32_t pivot = sort_key(keys, lo, width);
+        size_t j = lo + 1;
+        for(size_t i = lo + 1; i < hi; i++) {
+            uint32_t key = sort_key(keys, i, width);
+            sort_put(keys, i, width, sort_key(keys, j, width));
+            sort_put(keys, j, width, key);
+            j += key > pivot;
+        }
+        sort_swap(keys, lo, --j, width);
+
+        if(k < j) {
+            hi = j;
+        } else if(k == j) {
+            return;
+        } else if(j - lo >= (hi - lo) / 8) {
+            lo = j + 1;
+        } else {
+            /* Everything after j is at most the pivot */
+            size_t e = j + 1;
+            for(size_t i = j + 1; i < hi; i++) {
+                uint32_t key = sort_key(keys, i, width);
+                sort_put(keys, i, width, sort_key(keys, e, width));
+                sort_put(keys, e, width, key);
+                e += key == pivot;
+            }
+            if(k < e)
+                return;
+            lo = e;
+        }
+        if(fallback || ++steps == 2) {
+            fallback = !fallback && hi - lo > checked - checked / 4;
+            checked = hi - lo;
+            steps = 0;
+        }
+    }
+    insertion_sort((uint8_t*)keys + lo * width, hi - lo, width);
+}
+
+static void select_rank(void* keys, size_t lo, size_t hi, size_t k,
+                        size_t width) {
+    if(width == 1)
+        select_loop(keys, lo, hi, k, 1);
+    else if(width == 2)
+        select_loop(keys, lo, hi, k, 2);
+    else
+        select_loop(keys, lo, hi, k, 4);
+}
+
+int find_kth(void* arr, size_t length, size_t width, size_t k, void* scratch,
+             uint32_t* value) {
+    if(!arr || !value || k >= length ||
+       (width != 1 && width != 2 && width != 4))
+        return -1;
+    if(scratch) {
+        my_memcopy(arr, scratch, length * width);
+        arr = scratch;
+    }
+    select_rank(arr, 0, length, k, width);
+    *value = sort_key(arr, k, width);
+    return 0;
+}
+
+int find_median_select(void* arr, size_t length, size_t width, void* scratch,
+                       uint32_t* value) {
+    size_t k = length / 2;
+    if(find_kth(arr, length, width, k, scratch, value))
+        return -1;
+    if(length % 2 == 0) {
+        /* The other middle key is the smallest of the ones before k */
+        void* keys = scratch ? scratch : arr;
+        uint32_t upper = sort_key(keys, 0, width);
+        for(size_t i = 1; i < k; i++)
+            if(sort_key(keys, i, width) < upper)
+                upper = sort_key(keys, i, width);
+        *value = (uint32_t)(((uint64_t)*value + upper) / 2);
+    }
+    return 0;
+}
+
+void stats_histogram_reset(stats_histogram_t* hist) {
+    my_memzero((uint8_t*)hist->counts, sizeof(hist->counts));
+    hist->length = 0;
+}
+
+int stats_histogram_add(stats_histogram_t* hist, const unsigned char* arr,
+                        size_t length) {
+    /* Past UINT32_MAX samples in all, a bin could wrap */
+    if(length > UINT32_MAX - hist->length)
+        return -1;
+    histogram_count(arr, length, hist->counts);
+    hist->length += length;
+    return 0;
+}
+
+int stats_histogram_build(stats_histogram_t* hist, const unsigned char* arr,
+                          size_t length) {
+    stats_histogram_reset(hist);
+    return stats_histogram_add(hist, arr, length);
+}
+
+/* Value of the sample at 1-based rank in ascending order */
+static unsigned char histogram_rank(const stats_histogram_t* hist,
+                                    size_t rank) {
+    size_t seen = 0;
+    int v = 0;
+    for(; v < 255; v++) {
+        seen += hist->counts[v];
+        if(seen >= rank)
+            break;
+    }
+    return (unsigned char)v;
+}
+
+unsigned char stats_histogram_minimum(const stats_histogram_t* hist) {
+    if(hist->length < 1) {
         errno = EINVAL;
         return 0;
     }
-    if(length % 2 == 0)
-        return (arr[length / 2] + arr[length / 2 + 1]) / 2;
-    else 
-        return arr[length / 2];
+    return histogram_rank(hist, 1);
 }
 
-unsigned char find_mean(unsigned char* arr, const unsigned int length) {
-    if(length < 1) {
+unsigned char stats_histogram_maximum(const stats_histogram_t* hist) {
+    if(hist->length < 1) {
+        errno = EINVAL;
+        return 0;
+    }
+    return histogram_rank(hist, hist->length);
+}
+
+unsigned char stats_histogram_mean(const stats_histogram_t* hist) {
+    if(hist->length < 1) {
+        errno = EINVAL;
+        return 0;
+    }
+    uint64_t sum = 0;
+    for(int v = 1; v < 256; v++)
+        sum += (uint64_t)v * hist->counts[v];
+    return (unsigned char)(sum / hist->length);
+}
+
+unsigned char stats_histogram_median(const stats_histogram_t* hist) {
+    if(hist->length < 1) {
         errno = EINVAL;
         return 0;
     }
-    unsigned int sum = 0;
-    for(unsigned int i = 0; i < length; i++)
+    size_t half = hist->length / 2;
+    if(hist->length % 2)
+        return histogram_rank(hist, half + 1);
+    return (histogram_rank(hist, half) + histogram_rank(hist, half + 1)) / 2;
+}
+
+unsigned char stats_histogram_mode(const stats_histogram_t* hist) {
+    if(hist->length < 1) {
+        errno = EINVAL;
+        return 0;
+    }
+    int mode = 0;
+    for(int v = 1; v < 256; v++)
+        if(hist->counts[v] > hist->counts[mode])
+            mode = v;
+    return (unsigned char)mode;
+}
+
+unsigned char stats_histogram_percentile(const stats_histogram_t* hist,
+                                         unsigned int percent) {
+    if(hist->length < 1 || percent > 100) {
+        errno = EINVAL;
+        return 0;
+    }
+    /* Nearest rank, ceil(percent * length / 100), at least 1 */
+    size_t rank = (size_t)(((uint64_t)percent * hist->length + 99) / 100);
+    return histogram_rank(hist, rank ? rank : 1);
+}
+
+unsigned char find_median(unsigned char* arr, const unsigned int length) {
+    stats_histogram_t hist;
+    stats_histogram_build(&hist, arr, length);
+    return stats_histogram_median(&hist);
+}
+
+#ifdef STATS_X86
+#pragma GCC push_options
+#pragma GCC target("sse2")
+
+/* Folds vector partials into the result: lowest and highest byte of lo and
+ * hi, and both 64-bit halves of sum */
+static inline void summary_fold_sse2(struct stats_result* result, __m128i lo,
+                                     __m128i hi, __m128i sum) {
+    lo = _mm_min_epu8(lo, _mm_srli_si128(lo, 8));
+    hi = _mm_max_epu8(hi, _mm_srli_si128(hi, 8));
+    lo = _mm_min_epu8(lo, _mm_srli_si128(lo, 4));
+    hi = _mm_max_epu8(hi, _mm_srli_si128(hi, 4));
+    lo = _mm_min_epu8(lo, _mm_srli_si128(lo, 2));
+    hi = _mm_max_epu8(hi, _mm_srli_si128(hi, 2));
+    lo = _mm_min_epu8(lo, _mm_srli_si128(lo, 1));
+    hi = _mm_max_epu8(hi, _mm_srli_si128(hi, 1));
+    sum = _mm_add_epi64(sum, _mm_unpackhi_epi64(sum, sum));
+    uint8_t min = (uint8_t)_mm_cvtsi128_si32(lo);
+    uint8_t max = (uint8_t)_mm_cvtsi128_si32(hi);
+    if(min < result->minimum)
+        result->minimum = min;
+    if(max > result->maximum)
+        result->maximum = max;
+    result->sum += (uint64_t)_mm_cvtsi128_si64(sum);
+}
+
+/* psadbw against zero sums each 8 bytes into a 64-bit lane, so the sum can
+ * not overflow */
+static size_t summary_sse2(const uint8_t* src, size_t length,
+                           struct stats_result* result) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i lo = _mm_set1_epi8((char)0xFF);
+    __m128i hi = zero;
+    __m128i sum = zero;
+    size_t i = 0;
+    for(; i + 32 <= length; i += 32) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(src + i + 16));
+        lo = _mm_min_epu8(lo, _mm_min_epu8(a, b));
+        hi = _mm_max_epu8(hi, _mm_max_epu8(a, b));
+        sum = _mm_add_epi64(sum, _mm_add_epi64(_mm_sad_epu8(a, zero),
+                                               _mm_sad_epu8(b, zero)));
+    }
+    summary_fold_sse2(result, lo, hi, sum);
+    return i;
+}
+
+#pragma GCC pop_options
+#pragma GCC push_options
+#pragma GCC target("avx2")
+
+static size_t summary_avx2(const uint8_t* src, size_t length,
+                           struct stats_result* result) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i lo = _mm256_set1_epi8((char)0xFF);
+    __m256i hi = zero;
+    __m256i sum = zero;
+    size_t i = 0;
+    for(; i + 64 <= length; i += 64) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(src + i));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(src + i + 32));
+        lo = _mm256_min_epu8(lo, _mm256_min_epu8(a, b));
+        hi = _mm256_max_epu8(hi, _mm256_max_epu8(a, b));
+        sum = _mm256_add_epi64(sum, _mm256_add_epi64(_mm256_sad_epu8(a, zero),
+                                                     _mm256_sad_epu8(b, zero)));
+    }
+    summary_fold_sse2(result,
+                      _mm_min_epu8(_mm256_castsi256_si128(lo),
+                                   _mm256_extracti128_si256(lo, 1)),
+                      _mm_max_epu8(_mm256_castsi256_si128(hi),
+                                   _mm256_extracti128_si256(hi, 1)),
+                      _mm_add_epi64(_mm256_castsi256_si128(sum),
+                                    _mm256_extracti128_si256(sum, 1)));
+    return i;
+}
+
+#pragma GCC pop_options
+#endif
+
+#if defined (MSP432)
+/* Words summed with USADA8 before the 32-bit total is folded into the
+ * result: each adds at most 4 * 255 */
+#define STATS_M4_BLOCK (1UL << 20)
+
+/* Word view of the samples. may_alias keeps the byte buffer legal to read
+ * through it; the head loop of summary_m4() aligns the address first. */
+typedef uint32_t __attribute__((__may_alias__)) stats_u32_t;
+
+/*
+ * Minimum and maximum of four byte lanes in two instructions. USUB8 sets a GE
+ * flag for each byte of the first operand at or above the second, and SEL
+ * takes the bytes of its first operand where the flag is set. The pair is one
+ * asm statement: between two, the compiler would be free to schedule
+ * something that sets the flags again.
+ */
+static inline uint32_t m4_min8(uint32_t a, uint32_t b) {
+    uint32_t r;
+    __asm__("usub8 %0, %1, %2\n\tsel %0, %2, %1"
+            : "=&r" (r) : "r" (a), "r" (b) : "cc");
+    return r;
+}
+
+static inline uint32_t m4_max8(uint32_t a, uint32_t b) {
+    uint32_t r;
+    __asm__("usub8 %0, %1, %2\n\tsel %0, %1, %2"
+            : "=&r" (r) : "r" (a), "r" (b) : "cc");
+    return r;
+}
+
+/* M4 DSP extension, four samples per instruction */
+static size_t summary_m4(const uint8_t* src, size_t length,
+                         struct stats_result* result) {
+    uint32_t lo = 0xFFFFFFFF;
+    uint32_t hi = 0;
+    size_t i = 0;
+    /* Up to a word boundary first, unaligned word loads cost a cycle more */
+    for(; i < length && ((uintptr_t)(src + i) & 3); i++) {
+        result->sum += src[i];
+        if(src[i] < result->minimum)
+            result->minimum = src[i];
+        if(src[i] > result->maximum)
+            result->maximum = src[i];
+    }
+    while(i + 4 <= length) {
+        size_t end = length - (length - i) % 4;
+        uint32_t sum = 0;
+        if(end - i > 4 * STATS_M4_BLOCK)
+            end = i + 4 * STATS_M4_BLOCK;
+        for(; i < end; i += 4) {
+            uint32_t w = *(const stats_u32_t*)(src + i);
+            lo = m4_min8(w, lo);
+            hi = m4_max8(w, hi);
+            sum = __USADA8(w, 0, sum);
+        }
+        result->sum += sum;
+    }
+    for(int k = 0; k < 32; k += 8) {
+        uint8_t min = (uint8_t)(lo >> k);
+        uint8_t max = (uint8_t)(hi >> k);
+        if(min < result->minimum)
+            result->minimum = min;
+        if(max > result->maximum)
+            result->maximum = max;
+    }
+    return i;
+}
+#endif
+
+int stats_summary(const uint8_t* arr, size_t length,
+                  struct stats_result* result) {
+    size_t i = 0;
+    if(!result)
+        return -1;
+    result->minimum = 255;
+    result->maximum = 0;
+    result->sum = 0;
+    result->count = length;
+    if(length < 1 || !arr) {
+        result->minimum = 0;
+        result->count = 0;
+        return -1;
+    }
+#ifdef STATS_X86
+    memory_isa_t isa = memory_active_isa();
+    if(isa >= MEMORY_ISA_AVX2 && length >= 64)
+        i = summary_avx2(arr, length, result);
+    else if(isa >= MEMORY_ISA_SSE2 && length >= 32)
+        i = summary_sse2(arr, length, result);
+#elif defined (MSP432)
+    if(length >= 8)
+        i = summary_m4(arr, length, result);
+#endif
+    /* In locals: result->minimum is a byte too, so stores to it could alias
+     * arr and the loop would go through memory */
+    uint8_t min = result->minimum;
+    uint8_t max = result->maximum;
+    uint64_t sum = result->sum;
+    for(; i < length; i++) {
+        min = arr[i] < min ? arr[i] : min;
+        max = arr[i] > max ? arr[i] : max;
         sum += arr[i];
-    return sum / length;
+    }
+    result->minimum = min;
+    result->maximum = max;
+    result->sum = sum;
+    return 0;
+}
+
+unsigned char find_mean(unsigned char* arr, const unsigned int length) {
+    struct stats_result result;
+    if(stats_summary(arr, length, &result)) {
+        errno = EINVAL;
+        return 0;
+    }
+    return (unsigned char)(result.sum / result.count);
 }
 
 unsigned char find_maximum(unsigned char* arr, const unsigned int length) {
-    if(length < 1) {
+    struct stats_result result;
+    if(stats_summary(arr, length, &result)) {
         errno = EINVAL;
         return 0;
     }
-    return arr[0];
+    return result.maximum;
 }
 
 unsigned char find_minimum(unsigned char* arr, const unsigned int length) {
-    if(length < 1) {
+    struct stats_result result;
+    if(stats_summary(arr, length, &result)) {
         errno = EINVAL;
         return 0;
     }
-    return arr[length - 1];
+    return result.minimum;
 }
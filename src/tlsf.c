@@ -0,0 +1,296 @@
+/******************************************************************************
+ * Copyright (C) 2024 by Hatem Alamir
+ *
+ * Redistribution, modification or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of embedded
+ * software. Hatem Alamir is not liable for any misuse of this material.
+ *
+ *****************************************************************************/
+/**
+ * @file tlsf.c
+ * @brief Two-Level Segregated Fit allocator
+ *
+ * Every block starts with a two-word header: a pointer to the physically
+ * previous block and the payload size, whose lowest bit marks the block free.
+ * Free blocks reuse the first two payload words as free list links. The region
+ * ends with a zero-sized, permanently used sentinel so the last real block
+ * never needs a bounds check when merging.
+ *
+ * @author Hatem Alamir
+ * @date December 14 2024
+ *
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include "tlsf.h"
+
+#define BLOCK_FREE      ((size_t)1)
+#define BLOCK_HEADER    (offsetof(struct tlsf_block, next_free))
+/* Free blocks must be able to hold the two list links */
+#define BLOCK_MIN       (2 * sizeof(void*))
+/* First level 0 spans [0, 2^FL_SHIFT) in SL_COUNT lists */
+#define SMALL_BLOCK     ((size_t)1 << TLSF_FL_SHIFT)
+#define BLOCK_MAX       (((size_t)1 << TLSF_FL_MAX) - TLSF_ALIGN)
+
+struct tlsf_block {
+    struct tlsf_block* prev_phys;
+    size_t size;
+    /* Only valid while the block is free */
+    struct tlsf_block* next_free;
+    struct tlsf_block* prev_free;
+};
+
+/**
+ * @brief Index of the most significant set bit, x must not be zero
+ */
+static inline int tlsf_fls(size_t x) {
+    return (int)(sizeof(unsigned long) * 8 - 1) - __builtin_clzl((unsigned long)x);
+}
+
+static inline size_t align_up(size_t x, size_t align) {
+    return (x + align - 1) & ~(align - 1);
+}
+
+static inline size_t block_size(const struct tlsf_block* block) {
+    return block->size & ~BLOCK_FREE;
+}
+
+static inline int block_is_free(const struct tlsf_block* block) {
+    return (int)(block->size & BLOCK_FREE);
+}
+
+static inline void* block_payload(struct tlsf_block* block) {
+    return (uint8_t*)block + BLOCK_HEADER;
+}
+
+static inline struct tlsf_block* block_from_payload(const void* ptr) {
+    return (struct tlsf_block*)((uint8_t*)ptr - BLOCK_HEADER);
+}
+
+static inline struct tlsf_block* block_next(struct tlsf_block* block) {
+    return (struct tlsf_block*)((uint8_t*)block_payload(block) +
+                                block_size(block));
+}
+
+/**
+ * @brief First and second level lists a block of this size is filed under
+ */
+static inline void mapping_insert(size_t size, int* fl, int* sl) {
+    if(size < SMALL_BLOCK) {
+        *fl = 0;
+        *sl = (int)(size / (SMALL_BLOCK / TLSF_SL_COUNT));
+    } else {
+        int bit = tlsf_fls(size);
+        *sl = (int)(size >> (bit - TLSF_SL_SHIFT)) ^ (int)TLSF_SL_COUNT;
+        *fl = bit - (TLSF_FL_SHIFT - 1);
+    }
+}
+
+/**
+ * @brief Lists whose every block is at least this size. Rounding the request
+ * up to the next list boundary is what makes a good fit O(1).
+ */
+static inline void mapping_search(size_t size, int* fl, int* sl) {
+    if(size >= SMALL_BLOCK)
+        size += ((size_t)1 << (tlsf_fls(size) - TLSF_SL_SHIFT)) - 1;
+    mapping_insert(size, fl, sl);
+}
+
+static struct tlsf_block* find_suitable(tlsf_t* tlsf, int* fl, int* sl) {
+    uint32_t sl_map = tlsf->sl_bitmap[*fl] & (~0U << *sl);
+    if(!sl_map) {
+        uint32_t fl_map = *fl + 1 < 32 ? tlsf->fl_bitmap & (~0U << (*fl + 1))
+                                       : 0;
+        if(!fl_map)
+            return NULL;
+        *fl = __builtin_ctz(fl_map);
+        sl_map = tlsf->sl_bitmap[*fl];
+    }
+    *sl = __builtin_ctz(sl_map);
+    return tlsf->free_lists[*fl][*sl];
+}
+
+static void remove_free(tlsf_t* tlsf, struct tlsf_block* block) {
+    int fl;
+    int sl;
+    mapping_insert(block_size(block), &fl, &sl);
+    if(block->next_free)
+        block->next_free->prev_free = block->prev_free;
+    if(block->prev_free)
+        block->prev_free->next_free = block->next_free;
+    if(tlsf->free_lists[fl][sl] == block) {
+        tlsf->free_lists[fl][sl] = block->next_free;
+        if(!block->next_free) {
+            tlsf->sl_bitmap[fl] &= ~(1U << sl);
+            if(!tlsf->sl_bitmap[fl])
+                tlsf->fl_bitmap &= ~(1U << fl);
+        }
+    }
+}
+
+static void insert_free(tlsf_t* tlsf, struct tlsf_block* block) {
+    int fl;
+    int sl;
+    mapping_insert(block_size(block), &fl, &sl);
+    struct tlsf_block* head = tlsf->free_lists[fl][sl];
+    block->next_free = head;
+    block->prev_free = NULL;
+    if(head)
+        head->prev_free = block;
+    tlsf->free_lists[fl][sl] = block;
+    tlsf->fl_bitmap |= 1U << fl;
+    tlsf->sl_bitmap[fl] |= 1U << sl;
+}
+
+int tlsf_init(tlsf_t* tlsf, void* mem, size_t bytes) {
+    uint8_t* start = (uint8_t*)align_up((uintptr_t)mem, TLSF_ALIGN);
+    uint8_t* end = (uint8_t*)mem + bytes;
+    uint8_t* p = (uint8_t*)tlsf;
+    for(size_t i = 0; i < sizeof(*tlsf); i++)
+        p[i] = 0;
+    if(end < start + 2 * BLOCK_HEADER + BLOCK_MIN)
+        return -1;
+
+    size_t size = ((size_t)(end - start) - 2 * BLOCK_HEADER) & ~(TLSF_ALIGN - 1);
+    if(size > BLOCK_MAX)
+        size = BLOCK_MAX;
+    struct tlsf_block* block = (struct tlsf_block*)start;
+    block->prev_phys = NULL;
+    block->size = size | BLOCK_FREE;
+    struct tlsf_block* sentinel = block_next(block);
+    sentinel->prev_phys = block;
+    sentinel->size = 0;
+
+    tlsf->start = start;
+    tlsf->end = (uint8_t*)sentinel + BLOCK_HEADER;
+    insert_free(tlsf, block);
+    return 0;
+}
+
+/**
+ * @brief Marks a block taken off the free lists as used, giving back the
+ * tail past size if it can stand as a block of its own
+ */
+static void* block_use(tlsf_t* tlsf, struct tlsf_block* block, size_t size) {
+    size_t available = block_size(block);
+    if(available >= size + BLOCK_HEADER + BLOCK_MIN) {
+        struct tlsf_block* rest =
+            (struct tlsf_block*)((uint8_t*)block_payload(block) + size);
+        rest->prev_phys = block;
+        rest->size = (available - size - BLOCK_HEADER) | BLOCK_FREE;
+        block_next(rest)->prev_phys = rest;
+        insert_free(tlsf, rest);
+        available = size;
+    }
+    block->size = available;
+    return block_payload(block);
+}
+
+void* tlsf_malloc(tlsf_t* tlsf, size_t bytes) {
+    if(bytes > BLOCK_MAX)
+        return NULL;
+    size_t size = bytes < BLOCK_MIN ? BLOCK_MIN : align_up(bytes, TLSF_ALIGN);
+    int fl;
+    int sl;
+    mapping_search(size, &fl, &sl);
+    if(fl >= TLSF_FL_COUNT)
+        return NULL;
+    struct tlsf_block* block = find_suitable(tlsf, &fl, &sl);
+    if(!block)
+        return NULL;
+    remove_free(tlsf, block);
+    return block_use(tlsf, block, size);
+}
+
+void* tlsf_memalign(tlsf_t* tlsf, size_t align, size_t bytes) {
+    if(align <= TLSF_ALIGN)
+        return tlsf_malloc(tlsf, bytes);
+    /* Room to move the payload up to the boundary, leaving a gap in front
+     * that can stand as a free block of its own */
+    size_t gap_min = BLOCK_HEADER + BLOCK_MIN;
+    if(align > BLOCK_MAX - gap_min || bytes > BLOCK_MAX - align - gap_min)
+        return NULL;
+    size_t size = bytes < BLOCK_MIN ? BLOCK_MIN : align_up(bytes, TLSF_ALIGN);
+    int fl;
+    int sl;
+    mapping_search(size + align + gap_min, &fl, &sl);
+    if(fl >= TLSF_FL_COUNT)
+        return NULL;
+    struct tlsf_block* block = find_suitable(tlsf, &fl, &sl);
+    if(!block)
+        return NULL;
+    remove_free(tlsf, block);
+
+    uint8_t* payload = block_payload(block);
+    uint8_t* aligned = (uint8_t*)align_up((uintptr_t)payload, align);
+    if(aligned != payload && aligned < payload + gap_min)
+        aligned = (uint8_t*)align_up((uintptr_t)(payload + gap_min), align);
+    if(aligned != payload) {
+        /* A free block's physical predecessor is never free, so the gap
+         * needs no merging */
+        size_t gap = (size_t)(aligned - payload);
+        struct tlsf_block* moved = block_from_payload(aligned);
+        moved->prev_phys = block;
+        moved->size = block_size(block) - gap;
+        block_next(moved)->prev_phys = moved;
+        block->size = (gap - BLOCK_HEADER) | BLOCK_FREE;
+        insert_free(tlsf, block);
+        block = moved;
+    }
+    return block_use(tlsf, block, size);
+}
+
+void tlsf_free(tlsf_t* tlsf, void* ptr) {
+    if(!ptr)
+        return;
+    struct tlsf_block* block = block_from_payload(ptr);
+    struct tlsf_block* prev = block->prev_phys;
+    struct tlsf_block* next = block_next(block);
+
+    if(prev && block_is_free(prev)) {
+        remove_free(tlsf, prev);
+        prev->size = block_size(prev) + BLOCK_HEADER + block_size(block);
+        block = prev;
+    }
+    if(block_is_free(next)) {
+        remove_free(tlsf, next);
+        block->size = block_size(block) + BLOCK_HEADER + block_size(next);
+    }
+    block->size |= BLOCK_FREE;
+    block_next(block)->prev_phys = block;
+    insert_free(tlsf, block);
+}
+
+int tlsf_owns(const tlsf_t* tlsf, const void* ptr) {
+    return (const uint8_t*)ptr >= tlsf->start &&
+           (const uint8_t*)ptr < tlsf->end;
+}
+
+size_t tlsf_block_size(const void* ptr) {
+    return block_size(block_from_payload(ptr));
+}
+
+void tlsf_stats(const tlsf_t* tlsf, struct tlsf_stats* stats) {
+    struct tlsf_block* block = (struct tlsf_block*)tlsf->start;
+    stats->used_bytes = 0;
+    stats->free_bytes = 0;
+    stats->largest_free = 0;
+    stats->used_blocks = 0;
+    stats->free_blocks = 0;
+    if(!block)
+        return;
+    for(; block_size(block) > 0; block = block_next(block)) {
+        size_t size = block_size(block);
+        if(block_is_free(block)) {
+            stats->free_bytes += size;
+            stats->free_blocks++;
+            if(size > stats->largest_free)
+                stats->largest_free = size;
+        } else {
+            stats->used_bytes += size;
+            stats->used_blocks++;
+        }
+    }
+}